@@ -0,0 +1,38 @@
+(* Throughput of the Bytes based pread/pwrite against the BA variants
+
+   dune exec bench/bench_io.exe [total_mib] *)
+
+open Printf
+open ExtUnix.All
+
+let total = 1024 * 1024 * (try int_of_string Sys.argv.(1) with _ -> 256)
+
+let sizes = [ 4096; 65536; 1024 * 1024; 16 * 1024 * 1024 ]
+
+let time f =
+  let t0 = Unix.gettimeofday () in
+  f ();
+  Unix.gettimeofday () -. t0
+
+let report name size dt =
+  printf "%-12s %9d bytes  %8.1f MiB/s\n%!" name size
+    (float_of_int total /. dt /. 1024. /. 1024.)
+
+(* transfer [total] bytes in requests of [size] bytes *)
+let run f size =
+  let n = max 1 (total / size) in
+  time (fun () -> for i = 0 to n - 1 do f ((i * size) mod (total - size + 1)) done)
+
+let () =
+  let name = Filename.temp_file "extunix" "bench" in
+  let fd = Unix.openfile name [Unix.O_RDWR] 0 in
+  Fun.protect ~finally:(fun () -> Unix.close fd; Unix.unlink name) @@ fun () ->
+  ignore (pwrite fd 0 (String.make total 'x') 0 total);
+  List.iter begin fun size ->
+    let bytes = Bytes.create size in
+    let ba = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout size in
+    report "pread" size (run (fun off -> ignore (pread fd off bytes 0 size)) size);
+    report "BA.pread" size (run (fun off -> ignore (BA.pread fd off ba)) size);
+    report "pwrite" size (run (fun off -> ignore (pwrite fd off (Bytes.unsafe_to_string bytes) 0 size)) size);
+    report "BA.pwrite" size (run (fun off -> ignore (BA.pwrite fd off ba)) size)
+  end sizes
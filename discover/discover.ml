@@ -346,6 +346,24 @@ let features =
       V "PRIO_PROCESS"; V "RLIMIT_NOFILE"; V "RLIM_INFINITY";
       ];
     "MLOCKALL", L[ I "sys/mman.h"; S "mlockall"; S "munlockall"; V "MCL_CURRENT"; V "MCL_FUTURE"; ];
+    "MMAP", L[ I "sys/mman.h"; I "unistd.h"; S "mmap"; S "mremap"; S "munmap"; D "MREMAP_MAYMOVE"; D "MAP_ANONYMOUS";
+      Z "MAP_SHARED_VALIDATE"; Z "MAP_POPULATE"; Z "MAP_HUGETLB"; Z "MAP_NORESERVE"; Z "MAP_LOCKED"; ];
+    "MADVISE", L[ I "sys/mman.h"; I "unistd.h"; S "madvise"; D "MADV_NORMAL"; D "MADV_RANDOM"; D "MADV_SEQUENTIAL";
+      D "MADV_WILLNEED"; D "MADV_DONTNEED"; ];
+    "MINCORE", L[ I "sys/mman.h"; I "unistd.h"; S "mincore"; ];
+    "MLOCK2", L[ I "sys/mman.h"; I "unistd.h"; S "mlock2"; S "munlock"; D "MLOCK_ONFAULT"; ];
+    "MSYNC", L[ I "sys/mman.h"; I "unistd.h"; S "msync"; D "MS_ASYNC"; D "MS_SYNC"; D "MS_INVALIDATE"; ];
+    "MEMFD", L[ fd_int; I "sys/mman.h"; I "sys/stat.h"; I "fcntl.h"; S "memfd_create"; S "mmap"; D "MFD_CLOEXEC"; D "MFD_ALLOW_SEALING";
+      D "F_ADD_SEALS"; D "F_GET_SEALS"; D "F_SEAL_SEAL"; D "F_SEAL_SHRINK"; D "F_SEAL_GROW"; D "F_SEAL_WRITE";
+      Z "F_SEAL_FUTURE_WRITE"; Z "MFD_HUGETLB"; ];
+    "RING", L[ fd_int; I "stdint.h"; I "poll.h"; I "sys/eventfd.h"; S "eventfd_write"; S "eventfd_read"; S "poll";
+      D "__ATOMIC_ACQUIRE"; ];
+    "ATOMIC", L[ I "stdint.h"; D "__ATOMIC_ACQUIRE"; ];
+    "MEMSEARCH", L[ I "string.h"; S "memchr"; S "memrchr"; S "memmem"; ];
+    "FUTEX", L[ I "stdint.h"; I "unistd.h"; I "sys/syscall.h"; I "linux/futex.h"; I "time.h";
+      D "SYS_futex"; D "FUTEX_WAIT"; D "FUTEX_WAKE"; D "FUTEX_PRIVATE_FLAG"; D "__ATOMIC_ACQUIRE"; ];
+    "FUTEX_WAITV", L[ I "stdint.h"; I "unistd.h"; I "sys/syscall.h"; I "linux/futex.h"; I "time.h";
+      D "SYS_futex"; D "SYS_futex_waitv"; D "FUTEX_32"; D "FUTEX_WAITV_MAX"; T "struct futex_waitv"; S "clock_gettime"; ];
     "STRPTIME", L[ I "time.h"; S "strptime"; ];
     "STRTIME", ANY[
       [ I "time.h"; S"strftime"; S"asctime_r"; S"tzset"; S"tzname"; ];
@@ -409,10 +427,24 @@ let features =
       [ fd_int; I"sys/types.h"; I"sys/socket.h"; S"sendmsg"; S"recvmsg"; D"CMSG_SPACE"; ];
       [ fd_int; I"sys/types.h"; I"sys/socket.h"; S"sendmsg"; S"recvmsg"; F("msghdr","msg_accrights"); ];
     ];
+    "SENDFDS", L[ fd_int; I"sys/types.h"; I"sys/socket.h"; I"fcntl.h"; I"unistd.h"; S"sendmsg"; S"recvmsg"; D"CMSG_SPACE"; D"SCM_RIGHTS";
+      Z"MSG_CMSG_CLOEXEC"; ];
+    "MMSG", L[ fd_int; I"stddef.h"; I"sys/types.h"; I"sys/socket.h"; I"sys/un.h"; I"netinet/in.h";
+      S"recvmmsg"; S"sendmmsg"; D"MSG_WAITFORONE"; ];
     "PREAD", L[ fd_int; I "unistd.h"; S"pread"; ];
     "PWRITE", L[ fd_int; I "unistd.h"; S"pwrite"; ];
     "READ", L[ fd_int; I "unistd.h"; S"read"; ];
     "WRITE", L[ fd_int; I "unistd.h"; S"write"; ];
+    "PTHREAD_KEY", ANY[
+      [ I "pthread.h"; S"pthread_once"; S"pthread_key_create"; S"pthread_getspecific"; S"pthread_setspecific"; ];
+      [ I "pthread.h"; S"pthread_once"; S"pthread_key_create"; S"pthread_getspecific"; S"pthread_setspecific"; Ldlib ("cc", "-lpthread") ];
+    ];
+    "PREADV", L[ fd_int; I "sys/uio.h"; I "limits.h"; S"preadv"; ];
+    "PWRITEV", L[ fd_int; I "sys/uio.h"; I "limits.h"; S"pwritev"; ];
+    "PREADV2", L[
+      fd_int; I "sys/uio.h"; I "limits.h"; S"preadv2"; S"pwritev2";
+      D"RWF_HIPRI"; D"RWF_DSYNC"; D"RWF_SYNC"; D"RWF_NOWAIT"; D"RWF_APPEND";
+    ];
     "MKSTEMPS", L[ fd_int; I "stdlib.h"; I "unistd.h"; S"mkstemps"; ];
     "MKOSTEMPS", L[ fd_int; I "stdlib.h"; I "unistd.h"; S"mkostemps"; ];
     "SETRESUID", L[ I"sys/types.h"; I"unistd.h"; S"setresuid"; S"setresgid" ];
@@ -422,9 +454,38 @@ let features =
       (* check for standard values and extensions *)
       D "_SC_VERSION"; D "_SC_2_VERSION";
     ];
+    "COPY_FILE_RANGE", L[ fd_int; I "unistd.h"; S"copy_file_range"; ];
+    "SENDFILE", L[ fd_int; I "sys/sendfile.h"; S"sendfile"; ];
+    "COPY_RANGE", L[
+      fd_int;
+      I "unistd.h"; I "fcntl.h"; I "stdint.h"; I "stdlib.h"; I "sys/ioctl.h"; I "sys/sendfile.h"; I "linux/fs.h";
+      S"sendfile"; S"splice"; S"pipe2"; S"pread"; S"pwrite";
+    ];
     "SPLICE", L[ fd_int; I "fcntl.h"; S"splice"; ];
     "TEE", L[ fd_int; I "fcntl.h"; S"tee"; ];
+    "SPLICE_PUMP", L[ fd_int; I "fcntl.h"; I "poll.h"; I "unistd.h"; I "stdint.h"; I "sys/socket.h"; S"splice"; S"pipe2"; S"poll"; D"F_SETPIPE_SZ"; ];
     "VMSPLICE", L[ fd_int; I "fcntl.h"; S"vmsplice"; ];
+    "URING", L[
+      fd_int;
+      I "linux/io_uring.h"; I "sys/syscall.h"; I "sys/mman.h"; I "sys/stat.h";
+      I "fcntl.h"; I "unistd.h"; I "limits.h"; I "stdint.h"; I "sys/uio.h";
+      V "__NR_io_uring_setup"; V "__NR_io_uring_enter"; V "__NR_io_uring_register";
+      V "IORING_OP_STATX"; V "IORING_OP_FALLOCATE"; V "IORING_OP_ASYNC_CANCEL"; D "IORING_SETUP_CLAMP"; D "IORING_FEAT_SINGLE_MMAP";
+      D "STATX_BASIC_STATS"; T "struct statx";
+    ];
+    "AIO", L[
+      fd_int;
+      I "linux/aio_abi.h"; I "sys/syscall.h"; I "sys/stat.h"; I "sys/ioctl.h"; I "linux/fs.h";
+      I "fcntl.h"; I "unistd.h"; I "stdint.h"; I "time.h";
+      V "__NR_io_setup"; V "__NR_io_submit"; V "__NR_io_getevents"; V "__NR_io_destroy";
+      D "IOCB_FLAG_RESFD"; D "BLKSSZGET"; T "struct iocb";
+    ];
+    "URING_NET", L[
+      fd_int;
+      I "linux/io_uring.h"; I "sys/syscall.h"; I "sys/socket.h"; I "sys/mman.h";
+      V "IORING_OP_LINK_TIMEOUT"; V "IORING_REGISTER_PBUF_RING"; T "struct io_uring_buf_reg";
+      D "IORING_ACCEPT_MULTISHOT"; D "IORING_RECV_MULTISHOT"; D "IOSQE_BUFFER_SELECT";
+    ];
     "SOCKOPT", ANY[
       [
         fd_int;
@@ -449,6 +510,12 @@ let features =
       [ I "netinet/in.h"; I "netinet/tcp.h"; V "TCP_KEEPINTVL" ];
       [ I "winsock2.h"; I "ws2tcpip.h"; IF ("!defined(TCP_KEEPINTVL) && defined(__MINGW32__)", "TCP_KEEPINTVL", "0x11") ];
     ];
+    "UDP_SEGMENT", L[ I "netinet/in.h"; I "netinet/udp.h"; V "UDP_SEGMENT" ];
+    "UDP_GRO", L[ I "netinet/in.h"; I "netinet/udp.h"; V "UDP_GRO" ];
+    "UDP_GSO", L[ fd_int; I"sys/types.h"; I"sys/socket.h"; I "netinet/in.h"; I "netinet/udp.h";
+      S"sendmsg"; S"recvmsg"; D"CMSG_SPACE"; D"SOL_UDP"; D"UDP_SEGMENT"; D"UDP_GRO"; ];
+    "ZEROCOPY", L[ fd_int; I"sys/types.h"; I"sys/socket.h"; I "netinet/in.h"; I"linux/errqueue.h";
+      S"sendmsg"; S"recvmsg"; D"MSG_ZEROCOPY"; D"MSG_ERRQUEUE"; D"SO_ZEROCOPY"; D"SO_EE_ORIGIN_ZEROCOPY"; ];
     "SO_REUSEPORT", L[I"sys/socket.h"; V"SO_REUSEPORT"];
     "POLL", L[ fd_int; I "poll.h"; S "poll"; D "POLLIN"; D "POLLOUT"; Z "POLLRDHUP" ];
     "SYSINFO", L[ I"sys/sysinfo.h"; S"sysinfo"; F ("sysinfo","mem_unit")];
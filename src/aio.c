@@ -0,0 +1,272 @@
+
+#define EXTUNIX_WANT_AIO
+#include "config.h"
+
+#if defined(EXTUNIX_HAVE_AIO)
+
+/*
+ * Linux native AIO (io_setup/io_submit/io_getevents) through the raw
+ * system calls, libaio is not required.
+ *
+ * As with Uring every iocb carries a slot number in aio_data, the
+ * OCaml side maps slots to user ids and keeps the buffers alive.
+ */
+
+struct aio {
+  aio_context_t ctx;
+  unsigned nr;
+  unsigned queued;
+  struct iocb *iocbs;
+  struct iocb **queue;
+};
+
+#define Aio_val(v) (*((struct aio **) Data_custom_val(v)))
+
+static void aio_free(struct aio *a)
+{
+  if (a->ctx != 0) syscall(__NR_io_destroy, a->ctx);
+  caml_stat_free(a->iocbs);
+  caml_stat_free(a->queue);
+  caml_stat_free(a);
+}
+
+static void aio_finalize(value v_ctx)
+{
+  if (Aio_val(v_ctx) != NULL)
+  {
+    aio_free(Aio_val(v_ctx));
+    Aio_val(v_ctx) = NULL;
+  }
+}
+
+static struct custom_operations aio_ops = {
+  "extunix.aio",
+  aio_finalize,
+  custom_compare_default, custom_hash_default,
+  custom_serialize_default, custom_deserialize_default,
+#if defined(custom_compare_ext_default)
+  custom_compare_ext_default,
+#endif
+#if defined(custom_fixed_length_default)
+  custom_fixed_length_default,
+#endif
+};
+
+static struct aio *aio_of_value(value v_ctx)
+{
+  struct aio *a = Aio_val(v_ctx);
+  if (a == NULL)
+    caml_unix_error(EBADF, "io_submit", Nothing);
+  return a;
+}
+
+CAMLprim value caml_extunix_aio_create(value v_nr)
+{
+  CAMLparam1(v_nr);
+  CAMLlocal1(v_ctx);
+  struct aio *a;
+  int nr = Int_val(v_nr);
+
+  if (nr <= 0)
+    caml_invalid_argument("Aio.create");
+  a = caml_stat_alloc(sizeof *a);
+  a->ctx = 0;
+  a->nr = nr;
+  a->queued = 0;
+  if (syscall(__NR_io_setup, nr, &a->ctx) < 0)
+  {
+    int err = errno;
+    caml_stat_free(a);
+    caml_unix_error(err, "io_setup", Nothing);
+  }
+  a->iocbs = caml_stat_alloc(nr * sizeof(struct iocb));
+  a->queue = caml_stat_alloc(nr * sizeof(struct iocb *));
+
+  v_ctx = caml_alloc_custom(&aio_ops, sizeof(struct aio *), 0, 1);
+  Aio_val(v_ctx) = a;
+  CAMLreturn(v_ctx);
+}
+
+CAMLprim value caml_extunix_aio_destroy(value v_ctx)
+{
+  aio_finalize(v_ctx);
+  return Val_unit;
+}
+
+CAMLprim value caml_extunix_aio_nr(value v_ctx)
+{
+  return Val_int(aio_of_value(v_ctx)->nr);
+}
+
+/* Queues a pread ([v_write] false) or pwrite of the slice [v_iov] at
+   offset [v_off]. Buffer address, length and offset must be multiples
+   of [v_align], so that O_DIRECT requests do not fail with EINVAL. */
+CAMLprim value caml_extunix_aio_prep(value v_ctx, value v_slot, value v_write, value v_fd, value v_iov, value v_off, value v_align, value v_resfd)
+{
+  struct aio *a = aio_of_value(v_ctx);
+  value v_buf = Field(v_iov, 0);
+  intnat ofs = Long_val(Field(v_iov, 1));
+  intnat len = Long_val(Field(v_iov, 2));
+  uintptr_t align = Long_val(v_align);
+  char *buf;
+  struct iocb *cb;
+
+  if (ofs < 0 || len < 0 || ofs > Caml_ba_array_val(v_buf)->dim[0] - len || Long_val(v_off) < 0)
+    caml_invalid_argument(Bool_val(v_write) ? "Aio.prep_pwrite" : "Aio.prep_pread");
+  buf = (char *) Caml_ba_data_val(v_buf) + ofs;
+  if (align == 0 || (align & (align - 1)) != 0
+      || (((uintptr_t) buf | (uintptr_t) len | (uintptr_t) Long_val(v_off)) & (align - 1)) != 0)
+    caml_invalid_argument(Bool_val(v_write) ? "Aio.prep_pwrite: misaligned" : "Aio.prep_pread: misaligned");
+  if ((unsigned) Long_val(v_slot) >= a->nr)
+    caml_invalid_argument("Aio: invalid slot");
+  if (a->queued >= a->nr)
+    return Val_false;
+
+  cb = &a->iocbs[a->queued];
+  memset(cb, 0, sizeof *cb);
+  cb->aio_data = Long_val(v_slot);
+  cb->aio_lio_opcode = Bool_val(v_write) ? IOCB_CMD_PWRITE : IOCB_CMD_PREAD;
+  cb->aio_fildes = Int_val(v_fd);
+  cb->aio_buf = (uintptr_t) buf;
+  cb->aio_nbytes = len;
+  cb->aio_offset = Long_val(v_off);
+  if (Is_some(v_resfd))
+  {
+    cb->aio_flags = IOCB_FLAG_RESFD;
+    cb->aio_resfd = Int_val(Some_val(v_resfd));
+  }
+  a->queue[a->queued] = cb;
+  a->queued++;
+  return Val_true;
+}
+
+CAMLprim value caml_extunix_aio_prep_bytecode(value *argv, int argn)
+{
+  (void)argn;
+  return caml_extunix_aio_prep(argv[0], argv[1], argv[2], argv[3], argv[4], argv[5], argv[6], argv[7]);
+}
+
+/* Submits the queued iocbs, those not accepted by the kernel stay queued.
+   Raises if the first one is rejected. */
+CAMLprim value caml_extunix_aio_submit(value v_ctx)
+{
+  CAMLparam1(v_ctx);
+  struct aio *a = aio_of_value(v_ctx);
+  long ret;
+  int err;
+
+  if (a->queued == 0)
+    CAMLreturn(Val_int(0));
+
+  /* may block on the block layer queue */
+  caml_enter_blocking_section();
+  ret = syscall(__NR_io_submit, a->ctx, (long) a->queued, a->queue);
+  err = errno;
+  caml_leave_blocking_section();
+
+  if (ret < 0)
+    caml_unix_error(err, "io_submit", Nothing);
+  if (ret < (long) a->queued)
+    memmove(a->iocbs, a->iocbs + ret, (a->queued - ret) * sizeof(struct iocb));
+  a->queued -= ret;
+
+  CAMLreturn(Val_long(ret));
+}
+
+CAMLprim value caml_extunix_aio_queued(value v_ctx)
+{
+  return Val_int(aio_of_value(v_ctx)->queued);
+}
+
+/* Waits for at least [v_min] events (with an optional timeout in
+   seconds) and stores (slot, res) pairs into the int array [v_res] */
+CAMLprim value caml_extunix_aio_getevents(value v_ctx, value v_min, value v_res, value v_timeout)
+{
+  CAMLparam4(v_ctx, v_min, v_res, v_timeout);
+  struct aio *a = aio_of_value(v_ctx);
+  long max = Wosize_val(v_res) / 2;
+  long min = Long_val(v_min);
+  struct io_event *events;
+  struct timespec ts, *pts = NULL;
+  long ret, i;
+  int err;
+
+  if (max > (long) a->nr) max = a->nr;
+  if (min < 0 || min > max)
+    caml_invalid_argument("Aio.reap");
+  if (Is_some(v_timeout))
+  {
+    double t = Double_val(Some_val(v_timeout));
+    if (!(t >= 0.))
+      caml_invalid_argument("Aio.reap");
+    ts.tv_sec = (time_t) t;
+    ts.tv_nsec = (long) ((t - (double) ts.tv_sec) * 1e9);
+    pts = &ts;
+  }
+  if (max == 0)
+    CAMLreturn(Val_int(0));
+
+  events = caml_stat_alloc(max * sizeof(struct io_event));
+  if (min == 0 && pts == NULL)
+    ret = syscall(__NR_io_getevents, a->ctx, 0L, max, events, NULL);
+  else
+  {
+    caml_enter_blocking_section();
+    ret = syscall(__NR_io_getevents, a->ctx, min, max, events, pts);
+    err = errno;
+    caml_leave_blocking_section();
+    errno = err;
+  }
+  if (ret < 0)
+  {
+    err = errno;
+    caml_stat_free(events);
+    if (err == EINTR)
+      CAMLreturn(Val_int(0));
+    caml_unix_error(err, "io_getevents", Nothing);
+  }
+
+  for (i = 0; i < ret; i++)
+  {
+    Store_field(v_res, 2 * i, Val_long(events[i].data));
+    Store_field(v_res, 2 * i + 1, Val_long(events[i].res));
+  }
+  caml_stat_free(events);
+
+  CAMLreturn(Val_long(ret));
+}
+
+CAMLprim value caml_extunix_aio_dio_alignment(value v_fd)
+{
+  CAMLparam1(v_fd);
+  int fd = Int_val(v_fd);
+  struct stat st;
+  int align = 512;
+
+  if (fstat(fd, &st) < 0)
+    caml_uerror("fstat", Nothing);
+
+  if (S_ISBLK(st.st_mode))
+  {
+    int ssz;
+    if (ioctl(fd, BLKSSZGET, &ssz) < 0)
+      caml_uerror("ioctl", Nothing);
+    align = ssz;
+  }
+#if defined(STATX_DIOALIGN)
+  else
+  {
+    struct statx stx;
+    if (statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 && (stx.stx_mask & STATX_DIOALIGN))
+    {
+      if (stx.stx_dio_offset_align == 0)
+        caml_unix_error(EINVAL, "dio_alignment", Nothing); /* O_DIRECT not supported */
+      align = stx.stx_dio_mem_align > stx.stx_dio_offset_align ? stx.stx_dio_mem_align : stx.stx_dio_offset_align;
+    }
+  }
+#endif
+
+  CAMLreturn(Val_int(align));
+}
+
+#endif
@@ -0,0 +1,89 @@
+#define EXTUNIX_WANT_ATOMIC
+#include "config.h"
+
+#if defined(EXTUNIX_HAVE_ATOMIC)
+
+/*
+ * Atomic operations on naturally aligned 32 and 64-bit cells of a
+ * bigarray, usable across processes sharing a mapping. 32-bit values are
+ * OCaml ints, 64-bit ones are int64 (unboxed in native code); bounds and
+ * alignment are checked on the OCaml side, so that the stubs can be
+ * [@@noalloc].
+ */
+
+#define CELL_AT(v_buf, off, type) ((type *) ((char *) Caml_ba_data_val(v_buf) + (off)))
+#define CELL(v_buf, v_off, type) CELL_AT(v_buf, Long_val(v_off), type)
+
+#define ATOMIC(bits, type)						\
+CAMLprim value caml_extunixba_atomic_load##bits(value v_buf, value v_off) { \
+  return Val_long(__atomic_load_n(CELL(v_buf, v_off, type), __ATOMIC_ACQUIRE)); \
+}									\
+CAMLprim value caml_extunixba_atomic_store##bits(value v_buf, value v_off, value v_x) { \
+  __atomic_store_n(CELL(v_buf, v_off, type), (type) Long_val(v_x), __ATOMIC_RELEASE); \
+  return Val_unit;							\
+}									\
+CAMLprim value caml_extunixba_atomic_cas##bits(value v_buf, value v_off, value v_old, value v_new) { \
+  type old = Long_val(v_old);						\
+  return Val_bool(__atomic_compare_exchange_n(CELL(v_buf, v_off, type), &old, (type) Long_val(v_new), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)); \
+}									\
+CAMLprim value caml_extunixba_atomic_fetch_add##bits(value v_buf, value v_off, value v_x) { \
+  return Val_long(__atomic_fetch_add(CELL(v_buf, v_off, type), (type) Long_val(v_x), __ATOMIC_SEQ_CST)); \
+}									\
+CAMLprim value caml_extunixba_atomic_fetch_or##bits(value v_buf, value v_off, value v_x) { \
+  return Val_long(__atomic_fetch_or(CELL(v_buf, v_off, type), (type) Long_val(v_x), __ATOMIC_SEQ_CST)); \
+}									\
+CAMLprim value caml_extunixba_atomic_exchange##bits(value v_buf, value v_off, value v_x) { \
+  return Val_long(__atomic_exchange_n(CELL(v_buf, v_off, type), (type) Long_val(v_x), __ATOMIC_SEQ_CST)); \
+}
+
+/* The native stubs take an untagged offset and unboxed values, the
+   bytecode ones box around them */
+#define ATOMIC_UNBOXED(bits, type, Val_type, Type_val)			\
+CAMLprim type caml_extunixba_atomic_load##bits##_unboxed(value v_buf, intnat off) { \
+  return __atomic_load_n(CELL_AT(v_buf, off, type), __ATOMIC_ACQUIRE);	\
+}									\
+CAMLprim value caml_extunixba_atomic_load##bits(value v_buf, value v_off) { \
+  return Val_type(caml_extunixba_atomic_load##bits##_unboxed(v_buf, Long_val(v_off))); \
+}									\
+CAMLprim value caml_extunixba_atomic_store##bits##_unboxed(value v_buf, intnat off, type x) { \
+  __atomic_store_n(CELL_AT(v_buf, off, type), x, __ATOMIC_RELEASE);	\
+  return Val_unit;							\
+}									\
+CAMLprim value caml_extunixba_atomic_store##bits(value v_buf, value v_off, value v_x) { \
+  return caml_extunixba_atomic_store##bits##_unboxed(v_buf, Long_val(v_off), Type_val(v_x)); \
+}									\
+CAMLprim value caml_extunixba_atomic_cas##bits##_unboxed(value v_buf, intnat off, type old, type x) { \
+  return Val_bool(__atomic_compare_exchange_n(CELL_AT(v_buf, off, type), &old, x, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)); \
+}									\
+CAMLprim value caml_extunixba_atomic_cas##bits(value v_buf, value v_off, value v_old, value v_new) { \
+  return caml_extunixba_atomic_cas##bits##_unboxed(v_buf, Long_val(v_off), Type_val(v_old), Type_val(v_new)); \
+}									\
+CAMLprim type caml_extunixba_atomic_fetch_add##bits##_unboxed(value v_buf, intnat off, type x) { \
+  return __atomic_fetch_add(CELL_AT(v_buf, off, type), x, __ATOMIC_SEQ_CST); \
+}									\
+CAMLprim value caml_extunixba_atomic_fetch_add##bits(value v_buf, value v_off, value v_x) { \
+  return Val_type(caml_extunixba_atomic_fetch_add##bits##_unboxed(v_buf, Long_val(v_off), Type_val(v_x))); \
+}									\
+CAMLprim type caml_extunixba_atomic_fetch_or##bits##_unboxed(value v_buf, intnat off, type x) { \
+  return __atomic_fetch_or(CELL_AT(v_buf, off, type), x, __ATOMIC_SEQ_CST); \
+}									\
+CAMLprim value caml_extunixba_atomic_fetch_or##bits(value v_buf, value v_off, value v_x) { \
+  return Val_type(caml_extunixba_atomic_fetch_or##bits##_unboxed(v_buf, Long_val(v_off), Type_val(v_x))); \
+}									\
+CAMLprim type caml_extunixba_atomic_exchange##bits##_unboxed(value v_buf, intnat off, type x) { \
+  return __atomic_exchange_n(CELL_AT(v_buf, off, type), x, __ATOMIC_SEQ_CST); \
+}									\
+CAMLprim value caml_extunixba_atomic_exchange##bits(value v_buf, value v_off, value v_x) { \
+  return Val_type(caml_extunixba_atomic_exchange##bits##_unboxed(v_buf, Long_val(v_off), Type_val(v_x))); \
+}
+
+ATOMIC(32, int32_t)
+ATOMIC_UNBOXED(64, int64_t, caml_copy_int64, Int64_val)
+
+/* Misalignment of the data of [v_buf], to check the alignment of cells */
+CAMLprim value caml_extunixba_atomic_misalign(value v_buf)
+{
+  return Val_long((uintptr_t) Caml_ba_data_val(v_buf) & 7);
+}
+
+#endif
@@ -1,3 +1,4 @@
+#define EXTUNIX_WANT_MEMSEARCH
 #include "config.h"
 
 /*  Copyright © 2012 Goswin von Brederlow <goswin-v-b@web.de>   */
@@ -23,3 +24,133 @@ CAMLprim value caml_extunixba_set_substr(value v_buf, value v_off, value v_str)
     memcpy(buf + off, str, len);
     CAMLreturn(Val_unit);
 }
+
+#if defined(EXTUNIX_HAVE_MEMSEARCH)
+
+/*
+ * Searching slices of bigarrays. Bounds are checked on the OCaml side,
+ * results are offsets in the bigarray or -1.
+ */
+
+CAMLprim value caml_extunixba_index_byte(value v_buf, value v_off, value v_len, value v_c)
+{
+  const char *buf = (const char *) Caml_ba_data_val(v_buf);
+  const char *p = memchr(buf + Long_val(v_off), Int_val(v_c), Long_val(v_len));
+  return Val_long(p == NULL ? -1 : p - buf);
+}
+
+CAMLprim value caml_extunixba_rindex_byte(value v_buf, value v_off, value v_len, value v_c)
+{
+  const char *buf = (const char *) Caml_ba_data_val(v_buf);
+  const char *p = memrchr(buf + Long_val(v_off), Int_val(v_c), Long_val(v_len));
+  return Val_long(p == NULL ? -1 : p - buf);
+}
+
+CAMLprim value caml_extunixba_index_sub(value v_buf, value v_off, value v_len, value v_sub)
+{
+  const char *buf = (const char *) Caml_ba_data_val(v_buf);
+  const char *p = memmem(buf + Long_val(v_off), Long_val(v_len), String_val(v_sub), caml_string_length(v_sub));
+  return Val_long(p == NULL ? -1 : p - buf);
+}
+
+/*
+ * A byte set is 32 bytes: byte b is in the set when bit (b >> 4) & 7 of
+ * entry b & 15 of the first (b < 128) or second (b >= 128) half is set.
+ * With this layout both halves are pshufb lookup tables indexed by the
+ * low nibble, and the bit is selected by a third lookup on the high one.
+ */
+
+static const unsigned char *byteset_scalar(const unsigned char *p, const unsigned char *end, const unsigned char *set)
+{
+  for (; p < end; p++)
+    if (set[(*p >> 7) * 16 + (*p & 15)] & (1 << ((*p >> 4) & 7)))
+      return p;
+  return NULL;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BYTESET_X86
+#include <immintrin.h>
+
+/* Each stops at the first block containing a match or before the last
+   partial block, the rest is left to byteset_scalar */
+
+__attribute__((target("ssse3")))
+static const unsigned char *byteset_ssse3(const unsigned char *p, const unsigned char *end, const unsigned char *set)
+{
+  const __m128i lo_tbl = _mm_loadu_si128((const __m128i *) set);
+  const __m128i hi_tbl = _mm_loadu_si128((const __m128i *) (set + 16));
+  const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char) 128, 1, 2, 4, 8, 16, 32, 64, (char) 128);
+  const __m128i nibble = _mm_set1_epi8(15);
+  const __m128i zero = _mm_setzero_si128();
+
+  for (; end - p >= 16; p += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i *) p);
+    __m128i lo = _mm_and_si128(x, nibble);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), nibble);
+    __m128i upper = _mm_cmplt_epi8(x, zero);
+    __m128i row = _mm_or_si128(_mm_andnot_si128(upper, _mm_shuffle_epi8(lo_tbl, lo)),
+                               _mm_and_si128(upper, _mm_shuffle_epi8(hi_tbl, lo)));
+    __m128i hit = _mm_and_si128(row, _mm_shuffle_epi8(bits, hi));
+    int m = _mm_movemask_epi8(_mm_cmpeq_epi8(hit, zero)) ^ 0xffff;
+    if (m != 0)
+      return p + __builtin_ctz(m);
+  }
+  return p;
+}
+
+__attribute__((target("avx2")))
+static const unsigned char *byteset_avx2(const unsigned char *p, const unsigned char *end, const unsigned char *set)
+{
+  const __m256i lo_tbl = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) set));
+  const __m256i hi_tbl = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (set + 16)));
+  const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char) 128, 1, 2, 4, 8, 16, 32, 64, (char) 128,
+                                        1, 2, 4, 8, 16, 32, 64, (char) 128, 1, 2, 4, 8, 16, 32, 64, (char) 128);
+  const __m256i nibble = _mm256_set1_epi8(15);
+  const __m256i zero = _mm256_setzero_si256();
+
+  for (; end - p >= 32; p += 32)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i *) p);
+    __m256i lo = _mm256_and_si256(x, nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+    __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(lo_tbl, lo), _mm256_shuffle_epi8(hi_tbl, lo), x);
+    __m256i hit = _mm256_and_si256(row, _mm256_shuffle_epi8(bits, hi));
+    unsigned m = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hit, zero));
+    if (m != 0)
+      return p + __builtin_ctz(m);
+  }
+  return p;
+}
+
+static const unsigned char *(*byteset_simd)(const unsigned char *, const unsigned char *, const unsigned char *) = NULL;
+static int byteset_simd_checked = 0;
+
+#endif /* BYTESET_X86 */
+
+CAMLprim value caml_extunixba_index_any_of_set(value v_buf, value v_off, value v_len, value v_set)
+{
+  const unsigned char *buf = (const unsigned char *) Caml_ba_data_val(v_buf);
+  const unsigned char *p = buf + Long_val(v_off);
+  const unsigned char *end = p + Long_val(v_len);
+  const unsigned char *set = (const unsigned char *) String_val(v_set);
+
+#if defined(BYTESET_X86)
+  if (!byteset_simd_checked)
+  {
+    /* racing threads compute the same value */
+    if (__builtin_cpu_supports("avx2"))
+      byteset_simd = byteset_avx2;
+    else if (__builtin_cpu_supports("ssse3"))
+      byteset_simd = byteset_ssse3;
+    byteset_simd_checked = 1;
+  }
+  if (byteset_simd != NULL)
+    p = byteset_simd(p, end, set);
+#endif
+  p = byteset_scalar(p, end, set);
+  return Val_long(p == NULL ? -1 : p - buf);
+}
+
+#endif /* EXTUNIX_HAVE_MEMSEARCH */
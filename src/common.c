@@ -47,3 +47,42 @@ int extunix_open_flags(value list)
   }
   return res;
 }
+
+#if !defined(_WIN32)
+#include <sys/uio.h>
+
+/* Builds the struct iovec array described by the 'a iov array [v_iov],
+   checking that every slice lies within its bigarray. The result is
+   allocated with caml_stat_alloc and must be released by the caller. */
+struct iovec* extunix_iovec_of_array(value v_iov, const char *name, size_t *count)
+{
+  size_t i, size = Wosize_val(v_iov);
+  struct iovec *iov;
+  value tmp;
+  struct caml_ba_array *ba;
+  intnat offset, length;
+
+  for (i = 0; i < size; i++)
+  {
+    tmp = Field(v_iov, i);
+    /* field 0 is a 'a carray8 (bigarray of 8-bit elements)
+       field 1 is the offset in the bigarray
+       field 2 is the length */
+    ba = Caml_ba_array_val(Field(tmp, 0));
+    offset = Long_val(Field(tmp, 1));
+    length = Long_val(Field(tmp, 2));
+    if (offset < 0 || length < 0 || offset > ba->dim[0] - length)
+      caml_invalid_argument(name);
+  }
+
+  iov = caml_stat_alloc(sizeof(struct iovec) * (size > 0 ? size : 1));
+  for (i = 0; i < size; i++)
+  {
+    tmp = Field(v_iov, i);
+    iov[i].iov_base = (char *) Caml_ba_data_val(Field(tmp, 0)) + Long_val(Field(tmp, 1));
+    iov[i].iov_len = Long_val(Field(tmp, 2));
+  }
+  *count = size;
+  return iov;
+}
+#endif
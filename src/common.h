@@ -11,3 +11,12 @@
 #endif
 
 int extunix_open_flags(value);
+
+struct iovec;
+struct iovec* extunix_iovec_of_array(value, const char *, size_t *);
+
+/* maximum number of slices per vectored I/O call */
+#include <limits.h>
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
@@ -0,0 +1,315 @@
+#define EXTUNIX_WANT_COPY_FILE_RANGE
+#define EXTUNIX_WANT_SENDFILE
+#define EXTUNIX_WANT_COPY_RANGE
+#include "config.h"
+
+#if defined(EXTUNIX_HAVE_COPY_FILE_RANGE)
+
+CAMLprim value caml_extunix_copy_file_range(value v_fd_in, value v_off_in, value v_fd_out, value v_off_out, value v_len)
+{
+  CAMLparam5(v_fd_in, v_off_in, v_fd_out, v_off_out, v_len);
+  loff_t off_in, off_out;
+  loff_t *off_in_p = NULL, *off_out_p = NULL;
+  size_t len = Long_val(v_len);
+  ssize_t ret;
+
+  if (Is_some(v_off_in)) { off_in = Int64_val(Some_val(v_off_in)); off_in_p = &off_in; }
+  if (Is_some(v_off_out)) { off_out = Int64_val(Some_val(v_off_out)); off_out_p = &off_out; }
+
+  caml_enter_blocking_section();
+  ret = copy_file_range(Int_val(v_fd_in), off_in_p, Int_val(v_fd_out), off_out_p, len, 0);
+  caml_leave_blocking_section();
+
+  if (ret == -1)
+    caml_uerror("copy_file_range", Nothing);
+
+  CAMLreturn(Val_long(ret));
+}
+
+#endif
+
+#if defined(EXTUNIX_HAVE_SENDFILE)
+
+CAMLprim value caml_extunix_sendfile(value v_fd_out, value v_fd_in, value v_off, value v_count)
+{
+  CAMLparam4(v_fd_out, v_fd_in, v_off, v_count);
+  off_t off;
+  off_t *off_p = NULL;
+  size_t count = Long_val(v_count);
+  ssize_t ret;
+
+  if (Is_some(v_off)) { off = Int64_val(Some_val(v_off)); off_p = &off; }
+
+  caml_enter_blocking_section();
+  ret = sendfile(Int_val(v_fd_out), Int_val(v_fd_in), off_p, count);
+  caml_leave_blocking_section();
+
+  if (ret == -1)
+    caml_uerror("sendfile", Nothing);
+
+  CAMLreturn(Val_long(ret));
+}
+
+#endif
+
+#if defined(EXTUNIX_HAVE_COPY_RANGE)
+
+/* Same order as ExtUnix.copy_strategy */
+enum copy_strategy {
+  COPY_REFLINK,
+  COPY_COPY_FILE_RANGE,
+  COPY_SENDFILE,
+  COPY_SPLICE,
+  COPY_READ_WRITE
+};
+
+struct copy_state {
+  int fd_in, fd_out;
+  loff_t off_in, off_out;
+  loff_t *off_in_p, *off_out_p; /* NULL: use (and advance) the file position */
+  uint64_t remaining;
+  uint64_t done;
+  int append; /* fd_out has O_APPEND, copy_file_range fails with EBADF */
+  int lost; /* data was taken out of the input but could not be written */
+};
+
+/* Maximum size of a single request, copy_file_range and friends
+   silently truncate larger ones anyway */
+#define COPY_CHUNK ((size_t) 1 << 30)
+#define COPY_BUFFER_SIZE (1024 * 1024)
+
+/* errors telling that a strategy does not apply to these descriptors:
+   EXDEV, EINVAL, ENOSYS, EOPNOTSUPP (ENOTSUP), ESPIPE (offset given for
+   a pipe or socket) and EBADF only for an O_APPEND output */
+static int copy_unsupported(struct copy_state *st, int err)
+{
+  return err == EXDEV || err == EINVAL || err == ENOSYS || err == EOPNOTSUPP
+#if defined(ENOTSUP) && ENOTSUP != EOPNOTSUPP
+    || err == ENOTSUP
+#endif
+    || err == ESPIPE || (err == EBADF && st->append);
+}
+
+static void copy_advance(struct copy_state *st, size_t n)
+{
+  st->remaining -= n;
+  st->done += n;
+}
+
+static size_t copy_chunk(struct copy_state *st)
+{
+  return st->remaining > COPY_CHUNK ? COPY_CHUNK : (size_t) st->remaining;
+}
+
+/* Each strategy returns 0 when the copy is finished (or hit the end of
+   the input), 1 when the next strategy should be tried and -1 with
+   errno set on failure. */
+
+static int copy_reflink(struct copy_state *st)
+{
+#if defined(FICLONERANGE)
+  struct file_clone_range r;
+
+  /* cloning needs explicit offsets and works on whole blocks only, a
+     misaligned range fails with EINVAL and falls through, as do files
+     being executed (ETXTBSY) or immutable (EPERM) */
+  if (st->off_in_p == NULL || st->off_out_p == NULL || st->remaining == 0)
+    return 1;
+  r.src_fd = st->fd_in;
+  r.src_offset = st->off_in;
+  r.src_length = st->remaining;
+  r.dest_offset = st->off_out;
+  if (ioctl(st->fd_out, FICLONERANGE, &r) == -1)
+    return (copy_unsupported(st, errno) || errno == ETXTBSY || errno == EPERM) ? 1 : -1;
+  st->off_in += st->remaining;
+  st->off_out += st->remaining;
+  copy_advance(st, st->remaining);
+  return 0;
+#else
+  (void)st;
+  return 1;
+#endif
+}
+
+static int copy_with_copy_file_range(struct copy_state *st)
+{
+#if defined(EXTUNIX_HAVE_COPY_FILE_RANGE)
+  ssize_t n;
+
+  while (st->remaining > 0)
+  {
+    n = copy_file_range(st->fd_in, st->off_in_p, st->fd_out, st->off_out_p, copy_chunk(st), 0);
+    if (n == -1)
+    {
+      if (errno == EINTR) continue;
+      return copy_unsupported(st, errno) ? 1 : -1;
+    }
+    if (n == 0) break; /* end of input */
+    copy_advance(st, n);
+  }
+  return 0;
+#else
+  (void)st;
+  return 1;
+#endif
+}
+
+static int copy_with_sendfile(struct copy_state *st)
+{
+  ssize_t n;
+  off_t off;
+
+  /* sendfile writes at the current position of the output */
+  if (st->off_out_p != NULL)
+    return 1;
+  while (st->remaining > 0)
+  {
+    off = st->off_in;
+    n = sendfile(st->fd_out, st->fd_in, st->off_in_p ? &off : NULL, copy_chunk(st));
+    if (st->off_in_p) st->off_in = off;
+    if (n == -1)
+    {
+      if (errno == EINTR) continue;
+      return copy_unsupported(st, errno) ? 1 : -1;
+    }
+    if (n == 0) break; /* end of input */
+    copy_advance(st, n);
+  }
+  return 0;
+}
+
+static int copy_with_splice(struct copy_state *st)
+{
+  int p[2];
+  ssize_t n, m;
+  int ret = 0, err;
+
+  /* splicing to an O_APPEND file fails only once the data is in the pipe */
+  if (st->append)
+    return 1;
+  if (pipe2(p, O_CLOEXEC) == -1)
+    return 1;
+  while (st->remaining > 0)
+  {
+    n = splice(st->fd_in, st->off_in_p, p[1], NULL, copy_chunk(st), SPLICE_F_MOVE);
+    if (n == -1)
+    {
+      if (errno == EINTR) continue;
+      ret = copy_unsupported(st, errno) ? 1 : -1;
+      break;
+    }
+    if (n == 0) break; /* end of input */
+    while (n > 0)
+    {
+      m = splice(p[0], NULL, st->fd_out, st->off_out_p, n, SPLICE_F_MOVE);
+      if (m == -1)
+      {
+        if (errno == EINTR) continue;
+        /* can not fall back, and without an input offset the data in
+           the pipe can not be read again */
+        if (st->off_in_p == NULL) st->lost = 1;
+        ret = -1;
+        break;
+      }
+      n -= m;
+      copy_advance(st, m);
+    }
+    if (ret != 0) break;
+  }
+  err = errno;
+  close(p[0]);
+  close(p[1]);
+  errno = err;
+  return ret;
+}
+
+static int copy_with_read_write(struct copy_state *st)
+{
+  char *buf = malloc(COPY_BUFFER_SIZE);
+  ssize_t n, m;
+  size_t pos;
+  int ret = 0, err;
+
+  if (buf == NULL)
+  {
+    errno = ENOMEM;
+    return -1;
+  }
+  while (st->remaining > 0 && ret == 0)
+  {
+    size_t chunk = st->remaining > COPY_BUFFER_SIZE ? COPY_BUFFER_SIZE : (size_t) st->remaining;
+    n = st->off_in_p ? pread(st->fd_in, buf, chunk, st->off_in) : read(st->fd_in, buf, chunk);
+    if (n == -1)
+    {
+      if (errno == EINTR) continue;
+      ret = -1;
+      break;
+    }
+    if (n == 0) break; /* end of input */
+    if (st->off_in_p) st->off_in += n;
+    for (pos = 0; pos < (size_t) n; )
+    {
+      m = st->off_out_p ? pwrite(st->fd_out, buf + pos, n - pos, st->off_out) : write(st->fd_out, buf + pos, n - pos);
+      if (m == -1)
+      {
+        if (errno == EINTR) continue;
+        /* the input file position already moved past the data */
+        if (st->off_in_p == NULL) st->lost = 1;
+        ret = -1;
+        break;
+      }
+      if (st->off_out_p) st->off_out += m;
+      pos += m;
+      copy_advance(st, m);
+    }
+  }
+  err = errno;
+  free(buf);
+  errno = err;
+  return ret;
+}
+
+static int (* const copy_strategies[])(struct copy_state *) = {
+  [COPY_REFLINK] = copy_reflink,
+  [COPY_COPY_FILE_RANGE] = copy_with_copy_file_range,
+  [COPY_SENDFILE] = copy_with_sendfile,
+  [COPY_SPLICE] = copy_with_splice,
+  [COPY_READ_WRITE] = copy_with_read_write,
+};
+
+CAMLprim value caml_extunix_copy_range(value v_fd_in, value v_off_in, value v_fd_out, value v_off_out, value v_len)
+{
+  CAMLparam5(v_fd_in, v_off_in, v_fd_out, v_off_out, v_len);
+  CAMLlocal1(v_ret);
+  struct copy_state st;
+  int i, r = 1, err = 0;
+
+  memset(&st, 0, sizeof st);
+  st.fd_in = Int_val(v_fd_in);
+  st.fd_out = Int_val(v_fd_out);
+  if (Is_some(v_off_in)) { st.off_in = Int64_val(Some_val(v_off_in)); st.off_in_p = &st.off_in; }
+  if (Is_some(v_off_out)) { st.off_out = Int64_val(Some_val(v_off_out)); st.off_out_p = &st.off_out; }
+  st.remaining = Int64_val(v_len);
+  st.append = (fcntl(st.fd_out, F_GETFL) & O_APPEND) != 0;
+
+  caml_enter_blocking_section();
+  for (i = 0; i < (int) (sizeof copy_strategies / sizeof copy_strategies[0]); i++)
+  {
+    r = copy_strategies[i](&st);
+    if (r != 1) break;
+  }
+  err = errno;
+  caml_leave_blocking_section();
+
+  /* a partial count is only meaningful if the input was not consumed
+     beyond it */
+  if (r == -1 && (st.done == 0 || st.lost))
+    caml_unix_error(err, "copy_range", Nothing);
+
+  v_ret = caml_alloc_tuple(2);
+  Store_field(v_ret, 0, Val_int(i));
+  Store_field(v_ret, 1, caml_copy_int64(st.done));
+  CAMLreturn(v_ret);
+}
+
+#endif
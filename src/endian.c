@@ -1,8 +1,7 @@
 #define EXTUNIX_WANT_ENDIAN
 #include "config.h"
-#include "endian_helper.h"
-
 #include <stdint.h>
+#include "endian_helper.h"
 
 /*  Copyright © 2012 Goswin von Brederlow <goswin-v-b@web.de>   */
 
@@ -37,6 +36,63 @@ CAMLprim value caml_extunix_set_##name(value v_str, value v_off, value v_x) { \
   return Val_unit;							\
 }
 
+/* GET/SET of boxed types, with an unboxed entry point for native code */
+#define GET_UNBOXED(name, type, conv, Val_type)				\
+CAMLprim type caml_extunix_get_##name##_unboxed(value v_str, intnat off) { \
+  type x;								\
+  memcpy(&x, String_val(v_str) + off, sizeof(x));			\
+  return conv(x);							\
+}									\
+CAMLprim value caml_extunix_get_##name(value v_str, value v_off) {	\
+  return (Val_type(caml_extunix_get_##name##_unboxed(v_str, Long_val(v_off)))); \
+}
+
+#define SET_UNBOXED(name, type, conv, Type_val)				\
+CAMLprim value caml_extunix_set_##name##_unboxed(value v_str, intnat off, type x) { \
+  x = conv(x);								\
+  memcpy(Bytes_val(v_str) + off, &x, sizeof(x));			\
+  return Val_unit;							\
+}									\
+CAMLprim value caml_extunix_set_##name(value v_str, value v_off, value v_x) { \
+  return caml_extunix_set_##name##_unboxed(v_str, Long_val(v_off), Type_val(v_x)); \
+}
+
+/* 24bit integers, 3 bytes assembled by [get] / split by [set] */
+#define GET24(name, get, conv)						\
+CAMLprim value caml_extunix_get_##name(value v_str, value v_off) {	\
+  const unsigned char *p = (const unsigned char *) String_val(v_str) + Long_val(v_off); \
+  return Val_long(conv(get(p)));					\
+}
+
+#define SET24(name, set)						\
+CAMLprim value caml_extunix_set_##name(value v_str, value v_off, value v_x) { \
+  unsigned char *p = (unsigned char *) Bytes_val(v_str) + Long_val(v_off);	\
+  uint32_t x = Long_val(v_x);						\
+  set(p, x);								\
+  return Val_unit;							\
+}
+
+/* IEEE floats, converted through the integer of the same width */
+#define GET_FLOAT(name, type, conv, of_bits)				\
+CAMLprim double caml_extunix_get_##name##_unboxed(value v_str, intnat off) { \
+  type x;								\
+  memcpy(&x, String_val(v_str) + off, sizeof(x));			\
+  return of_bits(conv(x));						\
+}									\
+CAMLprim value caml_extunix_get_##name(value v_str, value v_off) {	\
+  return caml_copy_double(caml_extunix_get_##name##_unboxed(v_str, Long_val(v_off))); \
+}
+
+#define SET_FLOAT(name, type, conv, to_bits)				\
+CAMLprim value caml_extunix_set_##name##_unboxed(value v_str, intnat off, double d) { \
+  type x = conv(to_bits(d));						\
+  memcpy(Bytes_val(v_str) + off, &x, sizeof(x));			\
+  return Val_unit;							\
+}									\
+CAMLprim value caml_extunix_set_##name(value v_str, value v_off, value v_d) { \
+  return caml_extunix_set_##name##_unboxed(v_str, Long_val(v_off), Double_val(v_d)); \
+}
+
 #if defined(EXTUNIX_HAVE_ENDIAN)
 
 /* Big endian */
@@ -57,16 +113,25 @@ GET(bu16, uint16_t, be16toh, Val_long)
 GET(bs16,  int16_t, be16toh, Val_long)
 GET(bu31, uint32_t, be32toh, Val_long)
 GET(bs31,  int32_t, be32toh, Val_long)
-GET(bs32,  int32_t, be32toh, caml_copy_int32)
+GET_UNBOXED(bs32,  int32_t, be32toh, caml_copy_int32)
 GET(bu63, uint64_t, be64toh, Val_long)
 GET(bs63,  int64_t, be64toh, Val_long)
-GET(bs64,  int64_t, be64toh, caml_copy_int64)
+GET_UNBOXED(bs64,  int64_t, be64toh, caml_copy_int64)
 
 SET(b16, uint16_t, htobe16, Long_val)
 SET(b31, uint32_t, htobe32, Long_val)
-SET(b32, uint32_t, htobe32, Int32_val)
+SET_UNBOXED(b32, int32_t, htobe32, Int32_val)
 SET(b63, uint64_t, htobe64, Long_val)
-SET(b64, uint64_t, htobe64, Int64_val)
+SET_UNBOXED(b64, int64_t, htobe64, Int64_val)
+
+GET24(bu24, extunix_get_be24, (uint32_t))
+GET24(bs24, extunix_get_be24, extunix_sign24)
+SET24(b24, extunix_set_be24)
+
+GET_FLOAT(bf32, uint32_t, be32toh, extunix_float32_of_bits)
+GET_FLOAT(bf64, uint64_t, be64toh, extunix_float64_of_bits)
+SET_FLOAT(bf32, uint32_t, htobe32, extunix_bits_of_float32)
+SET_FLOAT(bf64, uint64_t, htobe64, extunix_bits_of_float64)
 
 /* Little endian */
 CONV(htole16,        uint16_t, htole16, Long_val, Val_long)
@@ -86,16 +151,25 @@ GET(lu16, uint16_t, le16toh, Val_long)
 GET(ls16,  int16_t, le16toh, Val_long)
 GET(lu31, uint32_t, le32toh, Val_long)
 GET(ls31,  int32_t, le32toh, Val_long)
-GET(ls32,  int32_t, le32toh, caml_copy_int32)
+GET_UNBOXED(ls32,  int32_t, le32toh, caml_copy_int32)
 GET(lu63, uint64_t, le64toh, Val_long)
 GET(ls63,  int64_t, le64toh, Val_long)
-GET(ls64,  int64_t, le64toh, caml_copy_int64)
+GET_UNBOXED(ls64,  int64_t, le64toh, caml_copy_int64)
 
 SET(l16, uint16_t, htole16, Long_val)
 SET(l31, uint32_t, htole32, Long_val)
-SET(l32, uint32_t, htole32, Int32_val)
+SET_UNBOXED(l32, int32_t, htole32, Int32_val)
 SET(l63, uint64_t, htole64, Long_val)
-SET(l64, uint64_t, htole64, Int64_val)
+SET_UNBOXED(l64, int64_t, htole64, Int64_val)
+
+GET24(lu24, extunix_get_le24, (uint32_t))
+GET24(ls24, extunix_get_le24, extunix_sign24)
+SET24(l24, extunix_set_le24)
+
+GET_FLOAT(lf32, uint32_t, le32toh, extunix_float32_of_bits)
+GET_FLOAT(lf64, uint64_t, le64toh, extunix_float64_of_bits)
+SET_FLOAT(lf32, uint32_t, htole32, extunix_bits_of_float32)
+SET_FLOAT(lf64, uint64_t, htole64, extunix_bits_of_float64)
 
 #endif /* EXTUNIX_HAVE_ENDIAN */
 
@@ -107,14 +181,23 @@ GET(hu16, uint16_t, id, Val_long)
 GET(hs16,  int16_t, id, Val_long)
 GET(hu31, uint32_t, id, Val_long)
 GET(hs31,  int32_t, id, Val_long)
-GET(hs32,  int32_t, id, caml_copy_int32)
+GET_UNBOXED(hs32,  int32_t, id, caml_copy_int32)
 GET(hu63, uint64_t, id, Val_long)
 GET(hs63,  int64_t, id, Val_long)
-GET(hs64,  int64_t, id, caml_copy_int64)
+GET_UNBOXED(hs64,  int64_t, id, caml_copy_int64)
 
 SET(8,    uint8_t, id, Long_val)
 SET(h16, uint16_t, id, Long_val)
 SET(h31, uint32_t, id, Long_val)
-SET(h32, uint32_t, id, Int32_val)
+SET_UNBOXED(h32, int32_t, id, Int32_val)
 SET(h63, uint64_t, id, Long_val)
-SET(h64, uint64_t, id, Int64_val)
+SET_UNBOXED(h64, int64_t, id, Int64_val)
+
+GET24(hu24, extunix_get_he24, (uint32_t))
+GET24(hs24, extunix_get_he24, extunix_sign24)
+SET24(h24, extunix_set_he24)
+
+GET_FLOAT(hf32, uint32_t, id, extunix_float32_of_bits)
+GET_FLOAT(hf64, uint64_t, id, extunix_float64_of_bits)
+SET_FLOAT(hf32, uint32_t, id, extunix_bits_of_float32)
+SET_FLOAT(hf64, uint64_t, id, extunix_bits_of_float64)
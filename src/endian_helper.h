@@ -105,3 +105,57 @@ From https://gist.github.com/panzi/6856583
 #ifndef le64toh
 # define le64toh(x) letoh64(x)
 #endif
+
+/* 24bit integers, stored in 3 bytes at [p] */
+
+static inline int extunix_host_big_endian(void)
+{
+  const uint16_t one = 1;
+  return *(const unsigned char *) &one == 0;
+}
+
+#define extunix_get_be24(p) \
+  (((uint32_t) (p)[0] << 16) | ((uint32_t) (p)[1] << 8) | (uint32_t) (p)[2])
+#define extunix_get_le24(p) \
+  (((uint32_t) (p)[2] << 16) | ((uint32_t) (p)[1] << 8) | (uint32_t) (p)[0])
+#define extunix_set_be24(p, x) \
+  ((p)[0] = (unsigned char) ((x) >> 16), (p)[1] = (unsigned char) ((x) >> 8), (p)[2] = (unsigned char) (x))
+#define extunix_set_le24(p, x) \
+  ((p)[2] = (unsigned char) ((x) >> 16), (p)[1] = (unsigned char) ((x) >> 8), (p)[0] = (unsigned char) (x))
+#define extunix_get_he24(p) \
+  (extunix_host_big_endian() ? extunix_get_be24(p) : extunix_get_le24(p))
+#define extunix_set_he24(p, x) \
+  (extunix_host_big_endian() ? extunix_set_be24(p, x) : extunix_set_le24(p, x))
+#define extunix_sign24(x) ((int32_t) ((uint32_t) (x) << 8) >> 8)
+
+/* IEEE floats travel as integers of the same width, converted with the
+   macros above */
+
+static inline double extunix_float32_of_bits(uint32_t x)
+{
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+static inline uint32_t extunix_bits_of_float32(double d)
+{
+  float f = (float) d;
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  return x;
+}
+
+static inline double extunix_float64_of_bits(uint64_t x)
+{
+  double d;
+  memcpy(&d, &x, sizeof(d));
+  return d;
+}
+
+static inline uint64_t extunix_bits_of_float64(double d)
+{
+  uint64_t x;
+  memcpy(&x, &d, sizeof(x));
+  return x;
+}
@@ -1,8 +1,7 @@
 #define EXTUNIX_WANT_ENDIAN
 #include "config.h"
-#include "endian_helper.h"
-
 #include <stdint.h>
+#include "endian_helper.h"
 
 /*  Copyright © 2012 Goswin von Brederlow <goswin-v-b@web.de>   */
 
@@ -28,6 +27,63 @@ CAMLprim value caml_extunixba_set_##name(value v_buf, value v_off, value v_x) {
   return Val_unit;							\
 }
 
+/* GET/SET of boxed types, with an unboxed entry point for native code */
+#define GET_UNBOXED(name, type, conv, Val_type)				\
+CAMLprim type caml_extunixba_get_##name##_unboxed(value v_buf, intnat off) { \
+  type x;								\
+  memcpy(&x, (int8_t*)Caml_ba_data_val(v_buf) + off, sizeof(x));			\
+  return conv(x);							\
+}									\
+CAMLprim value caml_extunixba_get_##name(value v_buf, value v_off) {	\
+  return (Val_type(caml_extunixba_get_##name##_unboxed(v_buf, Long_val(v_off)))); \
+}
+
+#define SET_UNBOXED(name, type, conv, Type_val)				\
+CAMLprim value caml_extunixba_set_##name##_unboxed(value v_buf, intnat off, type x) { \
+  x = conv(x);								\
+  memcpy((int8_t*)Caml_ba_data_val(v_buf) + off, &x, sizeof(x));			\
+  return Val_unit;							\
+}									\
+CAMLprim value caml_extunixba_set_##name(value v_buf, value v_off, value v_x) { \
+  return caml_extunixba_set_##name##_unboxed(v_buf, Long_val(v_off), Type_val(v_x)); \
+}
+
+/* 24bit integers, 3 bytes assembled by [get] / split by [set] */
+#define GET24(name, get, conv)						\
+CAMLprim value caml_extunixba_get_##name(value v_buf, value v_off) {	\
+  const unsigned char *p = (const unsigned char *) (int8_t*)Caml_ba_data_val(v_buf) + Long_val(v_off); \
+  return Val_long(conv(get(p)));					\
+}
+
+#define SET24(name, set)						\
+CAMLprim value caml_extunixba_set_##name(value v_buf, value v_off, value v_x) { \
+  unsigned char *p = (unsigned char *) (int8_t*)Caml_ba_data_val(v_buf) + Long_val(v_off);	\
+  uint32_t x = Long_val(v_x);						\
+  set(p, x);								\
+  return Val_unit;							\
+}
+
+/* IEEE floats, converted through the integer of the same width */
+#define GET_FLOAT(name, type, conv, of_bits)				\
+CAMLprim double caml_extunixba_get_##name##_unboxed(value v_buf, intnat off) { \
+  type x;								\
+  memcpy(&x, (int8_t*)Caml_ba_data_val(v_buf) + off, sizeof(x));			\
+  return of_bits(conv(x));						\
+}									\
+CAMLprim value caml_extunixba_get_##name(value v_buf, value v_off) {	\
+  return caml_copy_double(caml_extunixba_get_##name##_unboxed(v_buf, Long_val(v_off))); \
+}
+
+#define SET_FLOAT(name, type, conv, to_bits)				\
+CAMLprim value caml_extunixba_set_##name##_unboxed(value v_buf, intnat off, double d) { \
+  type x = conv(to_bits(d));						\
+  memcpy((int8_t*)Caml_ba_data_val(v_buf) + off, &x, sizeof(x));			\
+  return Val_unit;							\
+}									\
+CAMLprim value caml_extunixba_set_##name(value v_buf, value v_off, value v_d) { \
+  return caml_extunixba_set_##name##_unboxed(v_buf, Long_val(v_off), Double_val(v_d)); \
+}
+
 #if defined(EXTUNIX_HAVE_ENDIAN)
 
 /* Big endian */
@@ -35,32 +91,50 @@ GET(bu16, uint16_t, be16toh, Val_long)
 GET(bs16,  int16_t, be16toh, Val_long)
 GET(bu31, uint32_t, be32toh, Val_long)
 GET(bs31,  int32_t, be32toh, Val_long)
-GET(bs32,  int32_t, be32toh, caml_copy_int32)
+GET_UNBOXED(bs32,  int32_t, be32toh, caml_copy_int32)
 GET(bu63, uint64_t, be64toh, Val_long)
 GET(bs63,  int64_t, be64toh, Val_long)
-GET(bs64,  int64_t, be64toh, caml_copy_int64)
+GET_UNBOXED(bs64,  int64_t, be64toh, caml_copy_int64)
 
 SET(b16, uint16_t, htobe16, Long_val)
 SET(b31, uint32_t, htobe32, Long_val)
-SET(b32, uint32_t, htobe32, Int32_val)
+SET_UNBOXED(b32, int32_t, htobe32, Int32_val)
 SET(b63, uint64_t, htobe64, Long_val)
-SET(b64, uint64_t, htobe64, Int64_val)
+SET_UNBOXED(b64, int64_t, htobe64, Int64_val)
+
+GET24(bu24, extunix_get_be24, (uint32_t))
+GET24(bs24, extunix_get_be24, extunix_sign24)
+SET24(b24, extunix_set_be24)
+
+GET_FLOAT(bf32, uint32_t, be32toh, extunix_float32_of_bits)
+GET_FLOAT(bf64, uint64_t, be64toh, extunix_float64_of_bits)
+SET_FLOAT(bf32, uint32_t, htobe32, extunix_bits_of_float32)
+SET_FLOAT(bf64, uint64_t, htobe64, extunix_bits_of_float64)
 
 /* Little endian */
 GET(lu16, uint16_t, le16toh, Val_long)
 GET(ls16,  int16_t, le16toh, Val_long)
 GET(lu31, uint32_t, le32toh, Val_long)
 GET(ls31,  int32_t, le32toh, Val_long)
-GET(ls32,  int32_t, le32toh, caml_copy_int32)
+GET_UNBOXED(ls32,  int32_t, le32toh, caml_copy_int32)
 GET(lu63, uint64_t, le64toh, Val_long)
 GET(ls63,  int64_t, le64toh, Val_long)
-GET(ls64,  int64_t, le64toh, caml_copy_int64)
+GET_UNBOXED(ls64,  int64_t, le64toh, caml_copy_int64)
 
 SET(l16, uint16_t, htole16, Long_val)
 SET(l31, uint32_t, htole32, Long_val)
-SET(l32, uint32_t, htole32, Int32_val)
+SET_UNBOXED(l32, int32_t, htole32, Int32_val)
 SET(l63, uint64_t, htole64, Long_val)
-SET(l64, uint64_t, htole64, Int64_val)
+SET_UNBOXED(l64, int64_t, htole64, Int64_val)
+
+GET24(lu24, extunix_get_le24, (uint32_t))
+GET24(ls24, extunix_get_le24, extunix_sign24)
+SET24(l24, extunix_set_le24)
+
+GET_FLOAT(lf32, uint32_t, le32toh, extunix_float32_of_bits)
+GET_FLOAT(lf64, uint64_t, le64toh, extunix_float64_of_bits)
+SET_FLOAT(lf32, uint32_t, htole32, extunix_bits_of_float32)
+SET_FLOAT(lf64, uint64_t, htole64, extunix_bits_of_float64)
 
 #endif /* EXTUNIX_HAVE_ENDIAN */
 
@@ -72,14 +146,419 @@ GET(hu16, uint16_t, id, Val_long)
 GET(hs16,  int16_t, id, Val_long)
 GET(hu31, uint32_t, id, Val_long)
 GET(hs31,  int32_t, id, Val_long)
-GET(hs32,  int32_t, id, caml_copy_int32)
+GET_UNBOXED(hs32,  int32_t, id, caml_copy_int32)
 GET(hu63, uint64_t, id, Val_long)
 GET(hs63,  int64_t, id, Val_long)
-GET(hs64,  int64_t, id, caml_copy_int64)
+GET_UNBOXED(hs64,  int64_t, id, caml_copy_int64)
 
 SET(  8,  uint8_t, id, Long_val)
 SET(h16, uint16_t, id, Long_val)
 SET(h31, uint32_t, id, Long_val)
-SET(h32, uint32_t, id, Int32_val)
+SET_UNBOXED(h32, int32_t, id, Int32_val)
 SET(h63, uint64_t, id, Long_val)
-SET(h64, uint64_t, id, Int64_val)
+SET_UNBOXED(h64, int64_t, id, Int64_val)
+
+GET24(hu24, extunix_get_he24, (uint32_t))
+GET24(hs24, extunix_get_he24, extunix_sign24)
+SET24(h24, extunix_set_he24)
+
+GET_FLOAT(hf32, uint32_t, id, extunix_float32_of_bits)
+GET_FLOAT(hf64, uint64_t, id, extunix_float64_of_bits)
+SET_FLOAT(hf32, uint32_t, id, extunix_bits_of_float32)
+SET_FLOAT(hf64, uint64_t, id, extunix_bits_of_float64)
+
+#if defined(EXTUNIX_HAVE_ENDIAN)
+
+/*
+ * Bulk conversion of a slice of big or little endian values into a
+ * typed bigarray, one call per slice instead of one per value.
+ * On x86 the byte swap and widening are done with SSSE3 or AVX2
+ * shuffles, chosen at run time, with a scalar loop for the remainder.
+ */
+
+enum bulk_kind { BULK_I16, BULK_I32, BULK_I64, BULK_F32, BULK_F64 };
+
+static uint16_t bulk_bswap16(uint16_t x)
+{
+  return (uint16_t) ((x >> 8) | (x << 8));
+}
+
+static uint32_t bulk_bswap32(uint32_t x)
+{
+  return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+}
+
+static uint64_t bulk_bswap64(uint64_t x)
+{
+  return ((uint64_t) bulk_bswap32((uint32_t) x) << 32) | bulk_bswap32((uint32_t) (x >> 32));
+}
+
+static void bulk_scalar(int kind, int swap, const uint8_t *src, void *dst, size_t n)
+{
+  size_t i;
+
+  switch (kind)
+  {
+  case BULK_I16:
+    for (i = 0; i < n; i++)
+    {
+      uint16_t x;
+      memcpy(&x, src + 2 * i, 2);
+      if (swap) x = bulk_bswap16(x);
+      ((int32_t *) dst)[i] = (int16_t) x;
+    }
+    break;
+  case BULK_I32:
+  case BULK_F32:
+    for (i = 0; i < n; i++)
+    {
+      uint32_t x;
+      float f;
+      memcpy(&x, src + 4 * i, 4);
+      if (swap) x = bulk_bswap32(x);
+      if (kind == BULK_I32)
+        ((int32_t *) dst)[i] = (int32_t) x;
+      else
+      {
+        memcpy(&f, &x, 4);
+        ((double *) dst)[i] = f;
+      }
+    }
+    break;
+  case BULK_I64:
+  case BULK_F64:
+    for (i = 0; i < n; i++)
+    {
+      uint64_t x;
+      memcpy(&x, src + 8 * i, 8);
+      if (swap) x = bulk_bswap64(x);
+      memcpy((char *) dst + 8 * i, &x, 8);
+    }
+    break;
+  }
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BULK_X86
+#include <immintrin.h>
+
+#define MASK16 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+#define MASK32 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+#define MASK64 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8
+
+/* Each returns the number of values converted, the rest is left to
+   bulk_scalar */
+
+__attribute__((target("ssse3")))
+static size_t bulk_ssse3(int kind, int swap, const uint8_t *src, void *dst, size_t n)
+{
+  size_t i = 0;
+  __m128i x, mask;
+
+  switch (kind)
+  {
+  case BULK_I16:
+    mask = _mm_setr_epi8(MASK16);
+    for (; i + 8 <= n; i += 8)
+    {
+      x = _mm_loadu_si128((const __m128i *) (src + 2 * i));
+      if (swap) x = _mm_shuffle_epi8(x, mask);
+      _mm_storeu_si128((__m128i *) ((int32_t *) dst + i), _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+      _mm_storeu_si128((__m128i *) ((int32_t *) dst + i + 4), _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+    }
+    break;
+  case BULK_I32:
+    mask = _mm_setr_epi8(MASK32);
+    for (; i + 4 <= n; i += 4)
+    {
+      x = _mm_loadu_si128((const __m128i *) (src + 4 * i));
+      if (swap) x = _mm_shuffle_epi8(x, mask);
+      _mm_storeu_si128((__m128i *) ((int32_t *) dst + i), x);
+    }
+    break;
+  case BULK_F32:
+    mask = _mm_setr_epi8(MASK32);
+    for (; i + 4 <= n; i += 4)
+    {
+      __m128 f;
+      x = _mm_loadu_si128((const __m128i *) (src + 4 * i));
+      if (swap) x = _mm_shuffle_epi8(x, mask);
+      f = _mm_castsi128_ps(x);
+      _mm_storeu_pd((double *) dst + i, _mm_cvtps_pd(f));
+      _mm_storeu_pd((double *) dst + i + 2, _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+    }
+    break;
+  case BULK_I64:
+  case BULK_F64:
+    mask = _mm_setr_epi8(MASK64);
+    for (; i + 2 <= n; i += 2)
+    {
+      x = _mm_loadu_si128((const __m128i *) (src + 8 * i));
+      if (swap) x = _mm_shuffle_epi8(x, mask);
+      _mm_storeu_si128((__m128i *) ((char *) dst + 8 * i), x);
+    }
+    break;
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static size_t bulk_avx2(int kind, int swap, const uint8_t *src, void *dst, size_t n)
+{
+  size_t i = 0;
+  __m256i x, mask;
+  __m128i y, mask128;
+
+  switch (kind)
+  {
+  case BULK_I16:
+    mask128 = _mm_setr_epi8(MASK16);
+    for (; i + 8 <= n; i += 8)
+    {
+      y = _mm_loadu_si128((const __m128i *) (src + 2 * i));
+      if (swap) y = _mm_shuffle_epi8(y, mask128);
+      _mm256_storeu_si256((__m256i *) ((int32_t *) dst + i), _mm256_cvtepi16_epi32(y));
+    }
+    break;
+  case BULK_I32:
+    mask = _mm256_setr_epi8(MASK32, MASK32);
+    for (; i + 8 <= n; i += 8)
+    {
+      x = _mm256_loadu_si256((const __m256i *) (src + 4 * i));
+      if (swap) x = _mm256_shuffle_epi8(x, mask);
+      _mm256_storeu_si256((__m256i *) ((int32_t *) dst + i), x);
+    }
+    break;
+  case BULK_F32:
+    mask128 = _mm_setr_epi8(MASK32);
+    for (; i + 4 <= n; i += 4)
+    {
+      y = _mm_loadu_si128((const __m128i *) (src + 4 * i));
+      if (swap) y = _mm_shuffle_epi8(y, mask128);
+      _mm256_storeu_pd((double *) dst + i, _mm256_cvtps_pd(_mm_castsi128_ps(y)));
+    }
+    break;
+  case BULK_I64:
+  case BULK_F64:
+    mask = _mm256_setr_epi8(MASK64, MASK64);
+    for (; i + 4 <= n; i += 4)
+    {
+      x = _mm256_loadu_si256((const __m256i *) (src + 8 * i));
+      if (swap) x = _mm256_shuffle_epi8(x, mask);
+      _mm256_storeu_si256((__m256i *) ((char *) dst + 8 * i), x);
+    }
+    break;
+  }
+  return i;
+}
+
+static size_t (*bulk_simd)(int, int, const uint8_t *, void *, size_t) = NULL;
+static int bulk_simd_checked = 0;
+
+#endif /* BULK_X86 */
+
+static void bulk_convert(int kind, int swap, const uint8_t *src, void *dst, size_t n)
+{
+  static const size_t src_size[] = { 2, 4, 8, 4, 8 };
+  static const size_t dst_size[] = { 4, 4, 8, 8, 8 };
+  size_t done = 0;
+
+#if defined(BULK_X86)
+  if (!bulk_simd_checked)
+  {
+    /* racing threads compute the same value */
+    if (__builtin_cpu_supports("avx2"))
+      bulk_simd = bulk_avx2;
+    else if (__builtin_cpu_supports("ssse3"))
+      bulk_simd = bulk_ssse3;
+    bulk_simd_checked = 1;
+  }
+  if (bulk_simd != NULL)
+    done = bulk_simd(kind, swap, src, dst, n);
+#endif
+  bulk_scalar(kind, swap, src + done * src_size[kind], (char *) dst + done * dst_size[kind], n - done);
+}
+
+/* Copy [v_len] values from offset [v_off] of [v_buf] to index [v_dst_off]
+   of [v_dst], bounds are checked on the OCaml side */
+#define BULK_GET(name, kind, swap, dst_type)				\
+CAMLprim value caml_extunixba_get_##name##_array(value v_buf, value v_off, value v_dst, value v_dst_off, value v_len) { \
+  bulk_convert(kind, swap, (uint8_t *) Caml_ba_data_val(v_buf) + Long_val(v_off), \
+               (dst_type *) Caml_ba_data_val(v_dst) + Long_val(v_dst_off), Long_val(v_len)); \
+  return Val_unit;							\
+}
+
+BULK_GET(bs16, BULK_I16, be16toh(1) != 1, int32_t)
+BULK_GET(bs32, BULK_I32, be32toh(1) != 1, int32_t)
+BULK_GET(bs64, BULK_I64, be64toh(1) != 1, int64_t)
+BULK_GET(bf32, BULK_F32, be32toh(1) != 1, double)
+BULK_GET(bf64, BULK_F64, be64toh(1) != 1, double)
+
+BULK_GET(ls16, BULK_I16, le16toh(1) != 1, int32_t)
+BULK_GET(ls32, BULK_I32, le32toh(1) != 1, int32_t)
+BULK_GET(ls64, BULK_I64, le64toh(1) != 1, int64_t)
+BULK_GET(lf32, BULK_F32, le32toh(1) != 1, double)
+BULK_GET(lf64, BULK_F64, le64toh(1) != 1, double)
+
+
+/*
+ * LEB128 varints for ExtUnix.Cursor, a record { buf; pos; limit; _ }.
+ * pos is only advanced once a whole value has been decoded or there is
+ * room for the whole encoding.
+ */
+
+#define Cursor_data(v) ((unsigned char *) Caml_ba_data_val(Field(v, 0)))
+#define Cursor_pos(v) Long_val(Field(v, 1))
+#define Cursor_limit(v) Long_val(Field(v, 2))
+#define Cursor_set_pos(v, p) (Field(v, 1) = Val_long(p))
+
+static uint64_t uvarint_decode(value v_cur, intnat *ppos)
+{
+  const unsigned char *p = Cursor_data(v_cur);
+  intnat pos = *ppos, limit = Cursor_limit(v_cur);
+  uint64_t x = 0;
+  unsigned shift = 0;
+  unsigned char b;
+
+  for (;;)
+  {
+    if (pos >= limit)
+      caml_invalid_argument("index out of bounds");
+    b = p[pos++];
+    /* the 10th byte only holds the top bit */
+    if (shift == 63 && b > 1)
+      caml_failwith("Cursor: varint overflow");
+    x |= (uint64_t) (b & 0x7f) << shift;
+    if ((b & 0x80) == 0)
+      break;
+    shift += 7;
+  }
+  *ppos = pos;
+  return x;
+}
+
+static void uvarint_encode(value v_cur, uint64_t x)
+{
+  unsigned char tmp[10];
+  intnat pos = Cursor_pos(v_cur), n = 0;
+
+  do
+  {
+    tmp[n] = (x & 0x7f) | (x >= 0x80 ? 0x80 : 0);
+    x >>= 7;
+    n++;
+  } while (x != 0);
+  if (n > Cursor_limit(v_cur) - pos)
+    caml_invalid_argument("index out of bounds");
+  memcpy(Cursor_data(v_cur) + pos, tmp, n);
+  Cursor_set_pos(v_cur, pos + n);
+}
+
+static int64_t zigzag_decode(uint64_t x)
+{
+  return (int64_t) (x >> 1) ^ -(int64_t) (x & 1);
+}
+
+static uint64_t zigzag_encode(int64_t x)
+{
+  return ((uint64_t) x << 1) ^ (uint64_t) (x >> 63);
+}
+
+CAMLprim value caml_extunix_cursor_read_uvarint(value v_cur)
+{
+  intnat pos = Cursor_pos(v_cur);
+  uint64_t x = uvarint_decode(v_cur, &pos);
+
+  if (x > (uint64_t) Max_long)
+    caml_failwith("Cursor: varint overflow");
+  Cursor_set_pos(v_cur, pos);
+  return Val_long(x);
+}
+
+CAMLprim value caml_extunix_cursor_read_varint(value v_cur)
+{
+  intnat pos = Cursor_pos(v_cur);
+  int64_t x = zigzag_decode(uvarint_decode(v_cur, &pos));
+
+  if (x > Max_long || x < Min_long)
+    caml_failwith("Cursor: varint overflow");
+  Cursor_set_pos(v_cur, pos);
+  return Val_long(x);
+}
+
+CAMLprim int64_t caml_extunix_cursor_read_uvarint64_unboxed(value v_cur)
+{
+  intnat pos = Cursor_pos(v_cur);
+  uint64_t x = uvarint_decode(v_cur, &pos);
+
+  Cursor_set_pos(v_cur, pos);
+  return x;
+}
+
+CAMLprim value caml_extunix_cursor_read_uvarint64(value v_cur)
+{
+  return caml_copy_int64(caml_extunix_cursor_read_uvarint64_unboxed(v_cur));
+}
+
+CAMLprim int64_t caml_extunix_cursor_read_varint64_unboxed(value v_cur)
+{
+  uint64_t x = caml_extunix_cursor_read_uvarint64_unboxed(v_cur);
+  return zigzag_decode(x);
+}
+
+CAMLprim value caml_extunix_cursor_read_varint64(value v_cur)
+{
+  return caml_copy_int64(caml_extunix_cursor_read_varint64_unboxed(v_cur));
+}
+
+CAMLprim value caml_extunix_cursor_write_uvarint(value v_cur, value v_x)
+{
+  if (Long_val(v_x) < 0)
+    caml_invalid_argument("Cursor.write_uvarint");
+  uvarint_encode(v_cur, Long_val(v_x));
+  return Val_unit;
+}
+
+CAMLprim value caml_extunix_cursor_write_varint(value v_cur, value v_x)
+{
+  int64_t x = Long_val(v_x);
+  uvarint_encode(v_cur, zigzag_encode(x));
+  return Val_unit;
+}
+
+CAMLprim value caml_extunix_cursor_write_uvarint64_unboxed(value v_cur, int64_t x)
+{
+  uvarint_encode(v_cur, x);
+  return Val_unit;
+}
+
+CAMLprim value caml_extunix_cursor_write_uvarint64(value v_cur, value v_x)
+{
+  return caml_extunix_cursor_write_uvarint64_unboxed(v_cur, Int64_val(v_x));
+}
+
+CAMLprim value caml_extunix_cursor_write_varint64_unboxed(value v_cur, int64_t x)
+{
+  uvarint_encode(v_cur, zigzag_encode(x));
+  return Val_unit;
+}
+
+CAMLprim value caml_extunix_cursor_write_varint64(value v_cur, value v_x)
+{
+  return caml_extunix_cursor_write_varint64_unboxed(v_cur, Int64_val(v_x));
+}
+
+/* Skips a slice prefixed with its length as a uvarint,
+   returns the offset of the slice */
+CAMLprim value caml_extunix_cursor_read_prefixed(value v_cur)
+{
+  intnat pos = Cursor_pos(v_cur);
+  uint64_t len = uvarint_decode(v_cur, &pos);
+
+  if (len > (uint64_t) (Cursor_limit(v_cur) - pos))
+    caml_invalid_argument("index out of bounds");
+  Cursor_set_pos(v_cur, pos + len);
+  return Val_long(pos);
+}
+
+#endif /* EXTUNIX_HAVE_ENDIAN */
@@ -32,6 +32,15 @@ type ('a, 'b) carray =
 type 'a carray8 =
     ('a, Bigarray.int8_unsigned_elt, Bigarray.c_layout) Bigarray.Array1.t
 
+(** I/O vector. Describes the slice of [iov_len] bytes starting at
+    offset [iov_off] in [iov_buf]. Used to transfer multiple buffers
+    using a single system call. *)
+type 'a iov = {
+  iov_buf : 'a carray8;
+  iov_off : int;
+  iov_len : int;
+}
+
 type open_flag = Unix.open_flag
 (*
   = O_RDONLY | O_WRONLY | O_RDWR | O_NONBLOCK | O_APPEND | O_CREAT
@@ -576,6 +585,90 @@ let intr_write fd buf ofs len =
   else unsafe_intr_write fd buf ofs len
 ]
 
+[%%have PREADV2
+
+(** {3 preadv2/pwritev2} *)
+
+(** Per-call flags for [preadv2] and [pwritev2] *)
+type rw_flag =
+  | RWF_HIPRI  (** High priority request, poll for completion if possible *)
+  | RWF_DSYNC  (** Per-call equivalent of [O_DSYNC] *)
+  | RWF_SYNC   (** Per-call equivalent of [O_SYNC] *)
+  | RWF_NOWAIT (** Do not wait for data which is not immediately available *)
+  | RWF_APPEND (** Per-call equivalent of [O_APPEND] *)
+
+(** [preadv2 fd off buf ofs len flags] reads up to [len] bytes from
+    file descriptor [fd] at offset [off] (from the start of the file)
+    into the string [buf] at offset [ofs], with the behaviour modified
+    by [flags]. The file offset is not changed.
+
+    Attempts to read only once. Returns [Some n] where [n] is the
+    number of characters read, or [None] if the data is not
+    immediately available (EAGAIN, only with [RWF_NOWAIT]). With
+    [RWF_NOWAIT] the runtime lock is not released. Otherwise at most
+    16 MiB are read by a single call. Raises an
+    Unix.Unix_error exception in all other cases, including EAGAIN
+    without [RWF_NOWAIT]. *)
+external unsafe_preadv2: Unix.file_descr -> int -> Bytes.t -> int -> int -> rw_flag list -> int option = "caml_extunix_preadv2_bytecode" "caml_extunix_preadv2"
+
+let preadv2 fd off buf ofs len flags =
+  if off < 0 || ofs < 0 || len < 0 || ofs > Bytes.length buf - len
+  then invalid_arg "ExtUnix.preadv2"
+  else unsafe_preadv2 fd off buf ofs len flags
+
+(** [pwritev2 fd off buf ofs len flags] writes up to [len] bytes from
+    string [buf] at offset [ofs] to file descriptor [fd] at offset
+    [off] (from the start of the file), with the behaviour modified by
+    [flags]. The file offset is not changed.
+
+    Attempts to write only once. Returns [Some n] where [n] is the
+    number of characters written, or [None] if the write would block
+    (EAGAIN, only with [RWF_NOWAIT]). With [RWF_NOWAIT] the runtime lock is
+    not released. Otherwise at most 16 MiB are written by a single
+    call. Raises an Unix.Unix_error exception in all other
+    cases, including EAGAIN without [RWF_NOWAIT]. *)
+external unsafe_pwritev2: Unix.file_descr -> int -> string -> int -> int -> rw_flag list -> int option = "caml_extunix_pwritev2_bytecode" "caml_extunix_pwritev2"
+
+let pwritev2 fd off buf ofs len flags =
+  if off < 0 || ofs < 0 || len < 0 || ofs > String.length buf - len
+  then invalid_arg "ExtUnix.pwritev2"
+  else unsafe_pwritev2 fd off buf ofs len flags
+]
+
+[%%have COPY_RANGE
+
+(** strategy used by {!LargeFile.copy_range} *)
+type copy_strategy =
+  | Reflink (** shared extents (FICLONERANGE), no data is copied *)
+  | Copy_file_range (** in-kernel copy with [copy_file_range] *)
+  | Sendfile (** in-kernel copy with [sendfile] *)
+  | Splice (** in-kernel copy with [splice] through a pipe *)
+  | Read_write (** user space [pread]/[pwrite] loop *)
+]
+
+[%%have (SPLICE, TEE, VMSPLICE)
+
+(** splice functions flags *)
+type splice_flag =
+  | SPLICE_F_MOVE     (** Attempt to move pages instead of copying. Only a hint
+                          to the kernel *)
+  | SPLICE_F_NONBLOCK (** Do not block on I/O *)
+  | SPLICE_F_MORE     (** Announce that more data will be coming. Hint used by
+                          sockets *)
+  | SPLICE_F_GIFT     (** The user pages are a gift to the kernel. The
+                          application may not modify this memory ever, or page
+                          cache and on-disk data may differ. Gifting pages to
+                          the kernel means that a subsequent splice(2)
+                          SPLICE_F_MOVE can successfully move the pages; if
+                          this flag is not specified, then a subsequent
+                          splice(2) SPLICE_F_MOVE must copy the pages. Data
+                          must also be properly page aligned, both in memory
+                          and length.
+
+                          Only use for [vmsplice]. *)
+
+]
+
 (** {2 File operations on large files} *)
 
 (** File operations on large files. This sub-module provides 64-bit
@@ -660,6 +753,67 @@ struct
     else unsafe_intr_pwrite fd off buf ofs len
   ]
 
+  [%%have COPY_FILE_RANGE
+  (** [copy_file_range fd_in off_in fd_out off_out len] copies up to
+      [len] bytes from [fd_in] to [fd_out] inside the kernel. If
+      [off_in] is [None] data is read from the current file offset of
+      [fd_in], which is adjusted accordingly, otherwise from the given
+      offset and the file offset is not changed. Likewise for [off_out].
+      @return the number of bytes copied, 0 at the end of the input *)
+  external unsafe_copy_file_range : Unix.file_descr -> int64 option -> Unix.file_descr -> int64 option -> int -> int = "caml_extunix_copy_file_range"
+
+  let copy_file_range fd_in off_in fd_out off_out len =
+    let neg = function Some off -> off < Int64.zero | None -> false in
+    if neg off_in || neg off_out || len < 0
+    then invalid_arg "ExtUnix.LargeFile.copy_file_range"
+    else unsafe_copy_file_range fd_in off_in fd_out off_out len
+  ]
+
+  [%%have SENDFILE
+  (** [sendfile fd_out fd_in off count] copies up to [count] bytes from
+      [fd_in] (at offset [off], or the current file offset if [None]) to
+      [fd_out] at its current file offset, inside the kernel.
+      @return the number of bytes copied *)
+  external unsafe_sendfile : Unix.file_descr -> Unix.file_descr -> int64 option -> int -> int = "caml_extunix_sendfile"
+
+  let sendfile fd_out fd_in off count =
+    if (match off with Some off -> off < Int64.zero | None -> false) || count < 0
+    then invalid_arg "ExtUnix.LargeFile.sendfile"
+    else unsafe_sendfile fd_out fd_in off count
+  ]
+
+  [%%have COPY_RANGE
+  external unsafe_copy_range : Unix.file_descr -> int64 option -> Unix.file_descr -> int64 option -> int64 -> copy_strategy * int64 = "caml_extunix_copy_range"
+
+  (** [copy_range fd_in off_in fd_out off_out len] copies [len] bytes
+      from [fd_in] to [fd_out], stopping early at the end of the input.
+      Offsets have the same meaning as for {!copy_file_range}.
+
+      The fastest mechanism supported by the pair of descriptors is used:
+      reflink (only with both offsets given), [copy_file_range],
+      [sendfile] (only with [off_out = None]), [splice] and finally a
+      [pread]/[pwrite] loop, moving on to the next one on [EXDEV],
+      [EINVAL], [ENOSYS], [EOPNOTSUPP], [ESPIPE] or (for an [O_APPEND]
+      output) [EBADF]. Reflink also gives way on [ETXTBSY] and [EPERM].
+      The whole copy runs in a single blocking section.
+
+      @return the strategy which completed the copy and the number of
+      bytes copied. If an error occurs after some data was copied the
+      count so far is returned, unless data was read from the current
+      file offset of [fd_in] ([off_in = None]) and could not be written,
+      then as in all other error cases Unix.Unix_error is raised. *)
+  let copy_range fd_in off_in fd_out off_out len =
+    let neg = function Some off -> off < Int64.zero | None -> false in
+    if neg off_in || neg off_out || len < Int64.zero
+    then invalid_arg "ExtUnix.LargeFile.copy_range"
+    else unsafe_copy_range fd_in off_in fd_out off_out len
+  ]
+
+  [%%have SPLICE
+  (** Same as {!ExtUnix.splice} but with 64-bit offsets *)
+  external splice : Unix.file_descr -> int64 option -> Unix.file_descr -> int64 option -> int -> splice_flag list -> int = "caml_extunix_splice64_bytecode" "caml_extunix_splice64"
+  ]
+
   (** {2 Bigarray variants} *)
 
   (** *)
@@ -725,6 +879,66 @@ struct
     else unsafe_intr_pwrite fd off buf
   ]
 
+  [%%have PREADV
+  external unsafe_all_preadv: Unix.file_descr -> int64 -> 'a iov array -> int = "caml_extunixba_all_preadv64"
+
+  let all_preadv fd off iovs =
+    if off < Int64.zero
+    then invalid_arg "ExtUnix.LargeFile.all_preadv"
+    else unsafe_all_preadv fd off iovs
+
+  external unsafe_single_preadv: Unix.file_descr -> int64 -> 'a iov array -> int = "caml_extunixba_single_preadv64"
+
+  let single_preadv fd off iovs =
+    if off < Int64.zero
+    then invalid_arg "ExtUnix.LargeFile.single_preadv"
+    else unsafe_single_preadv fd off iovs
+
+  external unsafe_preadv: Unix.file_descr -> int64 -> 'a iov array -> int = "caml_extunixba_preadv64"
+
+  let preadv fd off iovs =
+    if off < Int64.zero
+    then invalid_arg "ExtUnix.LargeFile.preadv"
+    else unsafe_preadv fd off iovs
+
+  external unsafe_intr_preadv: Unix.file_descr -> int64 -> 'a iov array -> int = "caml_extunixba_intr_preadv64"
+
+  let intr_preadv fd off iovs =
+    if off < Int64.zero
+    then invalid_arg "ExtUnix.LargeFile.intr_preadv"
+    else unsafe_intr_preadv fd off iovs
+  ]
+
+  [%%have PWRITEV
+  external unsafe_all_pwritev: Unix.file_descr -> int64 -> 'a iov array -> int = "caml_extunixba_all_pwritev64"
+
+  let all_pwritev fd off iovs =
+    if off < Int64.zero
+    then invalid_arg "ExtUnix.LargeFile.all_pwritev"
+    else unsafe_all_pwritev fd off iovs
+
+  external unsafe_single_pwritev: Unix.file_descr -> int64 -> 'a iov array -> int = "caml_extunixba_single_pwritev64"
+
+  let single_pwritev fd off iovs =
+    if off < Int64.zero
+    then invalid_arg "ExtUnix.LargeFile.single_pwritev"
+    else unsafe_single_pwritev fd off iovs
+
+  external unsafe_pwritev: Unix.file_descr -> int64 -> 'a iov array -> int = "caml_extunixba_pwritev64"
+
+  let pwritev fd off iovs =
+    if off < Int64.zero
+    then invalid_arg "ExtUnix.LargeFile.pwritev"
+    else unsafe_pwritev fd off iovs
+
+  external unsafe_intr_pwritev: Unix.file_descr -> int64 -> 'a iov array -> int = "caml_extunixba_intr_pwritev64"
+
+  let intr_pwritev fd off iovs =
+    if off < Int64.zero
+    then invalid_arg "ExtUnix.LargeFile.intr_pwritev"
+    else unsafe_intr_pwritev fd off iovs
+  ]
+
   end (* module BA *)
 
 end (* module LargeFile *)
@@ -931,6 +1145,9 @@ type socket_int_option_ =
 | SO_DETACH_FILTER_
 | SO_DETACH_BPF_
 | SO_LOCK_FILTER_
+| UDP_SEGMENT_
+| UDP_GRO_
+| SO_ZEROCOPY_
 
 let string_of_socket_int_option_ = function
 | TCP_KEEPCNT_ -> "TCP_KEEPCNT"
@@ -942,6 +1159,9 @@ let string_of_socket_int_option_ = function
 | SO_DETACH_FILTER_ -> "SO_DETACH_FILTER"
 | SO_DETACH_BPF_ -> "SO_DETACH_BPF"
 | SO_LOCK_FILTER_ -> "SO_LOCK_FILTER"
+| UDP_SEGMENT_ -> "UDP_SEGMENT"
+| UDP_GRO_ -> "UDP_GRO"
+| SO_ZEROCOPY_ -> "SO_ZEROCOPY"
 
 external setsockopt_int : Unix.file_descr -> socket_int_option_ -> int -> unit = "caml_extunix_setsockopt_int"
 external getsockopt_int : Unix.file_descr -> socket_int_option_ -> int = "caml_extunix_getsockopt_int"
@@ -968,10 +1188,15 @@ type socket_int_option =
 | TCP_KEEPINTVL (** The time (in seconds) between individual keepalive probes *)
 | SO_ATTACH_BPF (** file descriptor returned by the bpf(2), with program of type [BPF_PROG_TYPE_SOCKET_FILTER] *)
 | SO_ATTACH_REUSEPORT_EBPF (** same as for SO_ATTACH_BPF *)
+| UDP_SEGMENT (** Size of the datagrams a UDP send is split into by the kernel
+                  (generic segmentation offload), 0 disables *)
 
 type socket_bool_option =
 | SO_REUSEPORT (** Permits multiple AF_INET or AF_INET6 sockets to be bound to an identical socket address. *)
 | SO_LOCK_FILTER (** Prevent changing the filters associated with the socket *)
+| UDP_GRO (** Let the kernel coalesce received UDP datagrams of a flow
+              (generic receive offload), see {!BA.recvmsg_gro} *)
+| SO_ZEROCOPY (** Allow [MSG_ZEROCOPY] transmission, see {!Zerocopy} *)
 
 type socket_unit_option =
 | SO_DETACH_FILTER (** Remove classic or extended BPF program attached to a socket *)
@@ -984,10 +1209,13 @@ let make_socket_int_option = function
 | TCP_KEEPINTVL -> TCP_KEEPINTVL_
 | SO_ATTACH_BPF -> SO_ATTACH_BPF_
 | SO_ATTACH_REUSEPORT_EBPF -> SO_ATTACH_REUSEPORT_EBPF_
+| UDP_SEGMENT -> UDP_SEGMENT_
 
 let make_socket_bool_option = function
 | SO_REUSEPORT -> SO_REUSEPORT_
 | SO_LOCK_FILTER -> SO_LOCK_FILTER_
+| UDP_GRO -> UDP_GRO_
+| SO_ZEROCOPY -> SO_ZEROCOPY_
 
 let make_socket_unit_option = function
 | SO_DETACH_FILTER -> SO_DETACH_FILTER_
@@ -1273,6 +1501,257 @@ external memalign: int -> int -> Bigarray.int8_unsigned_elt carray8 = "caml_extu
 
 ]
 
+[%%have MMAP
+
+(** Memory mapped files with explicit protection and flags *)
+module Mmap = struct
+
+(** memory protection *)
+type prot = PROT_READ | PROT_WRITE | PROT_EXEC
+
+(** mapping flags, exactly one of [MAP_SHARED], [MAP_PRIVATE] and
+    [MAP_SHARED_VALIDATE] must be given *)
+type flag =
+  | MAP_SHARED (** updates are visible to other mappings and carried to the file *)
+  | MAP_PRIVATE (** copy-on-write mapping *)
+  | MAP_SHARED_VALIDATE (** same as [MAP_SHARED], but unknown flags are rejected with EOPNOTSUPP *)
+  | MAP_ANONYMOUS (** not backed by a file, implied when no descriptor is given *)
+  | MAP_POPULATE (** prefault the whole mapping *)
+  | MAP_HUGETLB (** use huge pages (offset and length must be multiples of the huge page size) *)
+  | MAP_NORESERVE (** do not reserve swap space *)
+  | MAP_LOCKED (** lock the pages in memory, like [mlock] *)
+
+external unsafe_mmap : Unix.file_descr option -> int64 -> int -> prot list -> flag list -> Bigarray.int8_unsigned_elt carray8 = "caml_extunix_mmap"
+external unsafe_mremap : 'a carray8 -> int -> bool -> 'a carray8 = "caml_extunix_mremap"
+
+(** [map ?fd ?offset ~prot ~flags len] maps [len] bytes of the file [fd]
+    starting at [offset] (default: 0), or anonymous memory if [fd] is not
+    given. [offset] need not be page aligned. Unlike [Unix.map_file] the
+    file is never grown, accessing pages beyond its end raises SIGBUS.
+
+    The mapping is released when the array and all its sub-arrays are
+    garbage collected, or explicitly with {!unmap}. *)
+let map ?fd ?(offset=0L) ~prot ~flags len =
+  if len <= 0 || offset < 0L
+  then invalid_arg "ExtUnix.Mmap.map"
+  else unsafe_mmap fd offset len prot flags
+
+(** [remap ?may_move a len] resizes the mapping [a] (as returned by {!map}
+    or [remap]) to [len] bytes, e.g. to follow an append-only file. The
+    mapping is transferred to the returned array and [a] becomes empty.
+    With [may_move = false] the mapping is only grown in place and fails
+    with ENOMEM when the adjacent address range is taken, by default the
+    kernel may move it.
+
+    @raise Invalid_argument if [a] was not created by {!map}, or if
+    sub-arrays sharing its data are alive *)
+let remap ?(may_move=true) a len =
+  if len <= 0
+  then invalid_arg "ExtUnix.Mmap.remap"
+  else unsafe_mremap a len may_move
+
+(** [unmap a] releases the mapping [a] immediately, [a] becomes empty.
+    Accessing sub-arrays of [a] afterwards is undefined behaviour, so
+    only arrays without sub-arrays are accepted.
+
+    @raise Invalid_argument if [a] was not created by {!map} or has
+    sub-arrays *)
+external unmap : 'a carray8 -> unit = "caml_extunix_munmap"
+
+(* The functions below work on any bigarray, not only on mappings,
+   and act on the pages covering [ofs, ofs + len) of the array. *)
+
+[%%have MADVISE
+
+(** memory advice *)
+type madvice =
+  | MADV_NORMAL (** no special treatment *)
+  | MADV_RANDOM (** expect random page references, disables read-ahead *)
+  | MADV_SEQUENTIAL (** expect sequential page references, aggressive read-ahead *)
+  | MADV_WILLNEED (** expect access in the near future, start reading the pages *)
+  | MADV_DONTNEED (** drop the pages, private anonymous memory reads back as zeros *)
+  | MADV_FREE (** the pages may be freed lazily unless written again *)
+  | MADV_HUGEPAGE (** enable transparent huge pages *)
+  | MADV_NOHUGEPAGE (** disable transparent huge pages *)
+  | MADV_COLD (** deactivate the pages, they are reclaimed first *)
+  | MADV_PAGEOUT (** reclaim the pages now *)
+
+(** [madvise a ofs len advice] gives advice about the use of the bytes
+    [ofs] to [ofs + len - 1] of [a]. Partial pages are included, except
+    for [MADV_DONTNEED], [MADV_FREE] and [MADV_PAGEOUT] which only act on
+    whole pages inside the range so that neighbouring data is left alone.
+    Advice not known to the system raises EINVAL. *)
+external madvise : 'a carray8 -> int -> int -> madvice -> unit = "caml_extunix_madvise"
+
+]
+
+[%%have MINCORE
+
+(** [mincore a ofs len] reports which pages covering the bytes [ofs] to
+    [ofs + len - 1] of [a] are resident in memory: element [i] of the
+    result is 1 if the [i]-th page is resident, 0 otherwise. *)
+external mincore : 'a carray8 -> int -> int -> Bigarray.int8_unsigned_elt carray8 = "caml_extunix_mincore"
+
+]
+
+[%%have MLOCK2
+
+(** mlock2 flag *)
+type mlock_flag =
+  | MLOCK_ONFAULT (** lock pages as they are faulted in instead of populating the range *)
+
+(** [mlock2 a ofs len flags] locks the pages covering the bytes [ofs] to
+    [ofs + len - 1] of [a] in memory. *)
+external mlock2 : 'a carray8 -> int -> int -> mlock_flag list -> unit = "caml_extunix_mlock2"
+
+(** [munlock a ofs len] unlocks the pages covering the bytes [ofs] to
+    [ofs + len - 1] of [a]. *)
+external munlock : 'a carray8 -> int -> int -> unit = "caml_extunix_munlock"
+
+]
+
+[%%have MSYNC
+
+(** msync flag *)
+type msync_flag =
+  | MS_ASYNC (** schedule the write back and return *)
+  | MS_SYNC (** wait for the write back to complete *)
+  | MS_INVALIDATE (** invalidate other mappings of the same file *)
+
+(** @return the size of a memory page *)
+external page_size : unit -> int = "caml_extunix_page_size"
+
+(** [msync a ofs len flags] flushes the pages covering the bytes [ofs] to
+    [ofs + len - 1] of the shared mapping [a] back to the file. *)
+external msync : 'a carray8 -> int -> int -> msync_flag list -> unit = "caml_extunix_msync"
+
+external msync_ranges : 'a carray8 -> int array -> int -> msync_flag list -> unit = "caml_extunix_msync_ranges"
+
+(** Dirty range tracking for shared mappings, so that only modified pages
+    are flushed *)
+module Dirty = struct
+
+  type 'a t = {
+    map : 'a carray8;
+    page : int;
+    bits : Bytes.t; (** one bit per page of [map] *)
+    mutable lo : int; (** dirty pages are in \[lo, hi), empty if [lo >= hi] *)
+    mutable hi : int;
+  }
+
+  (** [create a] tracks writes to the mapping [a], initially clean *)
+  let create map =
+    let page = page_size () in
+    let pages = (Bigarray.Array1.dim map + page - 1) / page in
+    { map; page; bits = Bytes.make ((pages + 7) / 8) '\000'; lo = max_int; hi = 0 }
+
+  let is_set t i = Char.code (Bytes.unsafe_get t.bits (i lsr 3)) land (1 lsl (i land 7)) <> 0
+
+  (** [mark t ofs len] records that the bytes [ofs] to [ofs + len - 1] of
+      the mapping were modified *)
+  let mark t ofs len =
+    if ofs < 0 || len < 0 || ofs > Bigarray.Array1.dim t.map - len
+    then invalid_arg "ExtUnix.Mmap.Dirty.mark"
+    else if len > 0 then begin
+      let first = ofs / t.page and last = (ofs + len - 1) / t.page in
+      for i = first to last do
+        let c = Char.code (Bytes.unsafe_get t.bits (i lsr 3)) in
+        Bytes.unsafe_set t.bits (i lsr 3) (Char.unsafe_chr (c lor (1 lsl (i land 7))))
+      done;
+      if first < t.lo then t.lo <- first;
+      if last + 1 > t.hi then t.hi <- last + 1
+    end
+
+  (** @return whether some pages were marked since the last flush *)
+  let is_dirty t = t.lo < t.hi
+
+  (** @return the dirty extents as a list of (offset, length) pairs in
+      increasing order, adjacent dirty pages are coalesced *)
+  let extents t =
+    let size = Bigarray.Array1.dim t.map in
+    let rec loop acc i =
+      if i < t.lo then acc
+      else if not (is_set t i) then loop acc (i - 1)
+      else begin
+        let j = ref i in
+        while !j > t.lo && is_set t (!j - 1) do decr j done;
+        let ofs = !j * t.page in
+        loop ((ofs, min size ((i + 1) * t.page) - ofs) :: acc) (!j - 1)
+      end
+    in
+    loop [] (t.hi - 1)
+
+  (** [flush ?sync t] writes the dirty pages back with [msync], using
+      [MS_ASYNC] by default or [MS_SYNC] when [sync] is true (a
+      durability barrier), and marks them clean.
+
+      @return the flushed extents, as returned by {!extents} *)
+  let flush ?(sync=false) t =
+    let ext = extents t in
+    let ranges = Array.make (2 * List.length ext) 0 in
+    List.iteri (fun i (ofs, len) -> ranges.(2 * i) <- ofs; ranges.(2 * i + 1) <- len) ext;
+    msync_ranges t.map ranges (List.length ext) [if sync then MS_SYNC else MS_ASYNC];
+    if is_dirty t then
+      Bytes.fill t.bits (t.lo lsr 3) ((t.hi - 1) lsr 3 - t.lo lsr 3 + 1) '\000';
+    t.lo <- max_int;
+    t.hi <- 0;
+    ext
+
+end (* module Dirty *)
+
+]
+
+end (* module Mmap *)
+
+]
+
+[%%have MEMFD
+
+(** {3 memfd}
+
+    Anonymous memory files, which can be sealed and shared with other
+    processes by passing the descriptor with {!sendfd}. *)
+
+(** memfd_create flag *)
+type memfd_flag =
+  | MFD_CLOEXEC (** close on exec *)
+  | MFD_ALLOW_SEALING (** allow {!memfd_add_seals} *)
+  | MFD_HUGETLB (** back the file with huge pages *)
+
+(** file seal *)
+type seal =
+  | F_SEAL_SEAL (** no more seals can be added *)
+  | F_SEAL_SHRINK (** the file size can not be reduced *)
+  | F_SEAL_GROW (** the file size can not be increased *)
+  | F_SEAL_WRITE (** the contents can not be modified *)
+  | F_SEAL_FUTURE_WRITE (** the contents can not be modified through new
+                            writable mappings or [write], existing writable
+                            mappings still work *)
+
+(** [memfd_create name flags] creates an anonymous file living in memory.
+    [name] is only used for debugging (/proc/self/fd). *)
+external memfd_create : string -> memfd_flag list -> Unix.file_descr = "caml_extunix_memfd_create"
+
+(** [memfd_add_seals fd seals] adds [seals] to the memfd [fd] (created with
+    [MFD_ALLOW_SEALING]). [F_SEAL_WRITE] fails with EBUSY while writable
+    shared mappings of [fd] exist. *)
+external memfd_add_seals : Unix.file_descr -> seal list -> unit = "caml_extunix_memfd_add_seals"
+
+(** @return the seals of the memfd [fd] *)
+external memfd_get_seals : Unix.file_descr -> seal list = "caml_extunix_memfd_get_seals"
+
+(** [memfd_map_sealed fd] maps the whole memfd [fd] read-only and shared,
+    without copying. The mapping is released when the array is garbage
+    collected.
+
+    @raise Unix.Unix_error EPERM unless [fd] is sealed with both
+    [F_SEAL_SHRINK] and [F_SEAL_WRITE], i.e. the sender can not change
+    the data after sealing. [F_SEAL_FUTURE_WRITE] is not accepted, as
+    it leaves existing writable mappings working. *)
+external memfd_map_sealed : Unix.file_descr -> Bigarray.int8_unsigned_elt carray8 = "caml_extunix_memfd_map_sealed"
+
+]
+
 (** {2 Time conversion} *)
 
 [%%have STRPTIME
@@ -1545,17 +2024,24 @@ module BigEndian = struct
       integers are 31bit signed there. No error is reported if this
       occurs. Use with care.
       Note: The same applies to 63bit functions.
+      Note: The float32 functions widen a single precision float.
+      Note: In native code the 32bit, 64bit and float functions take
+      and return unboxed values and do not allocate.
   *)
   external unsafe_get_uint8  : string -> int -> int = "caml_extunix_get_u8" [@@noalloc]
   external unsafe_get_int8   : string -> int -> int = "caml_extunix_get_s8" [@@noalloc]
   external unsafe_get_uint16 : string -> int -> int = "caml_extunix_get_bu16" [@@noalloc]
   external unsafe_get_int16  : string -> int -> int = "caml_extunix_get_bs16" [@@noalloc]
+  external unsafe_get_uint24 : string -> int -> int = "caml_extunix_get_bu24" [@@noalloc]
+  external unsafe_get_int24  : string -> int -> int = "caml_extunix_get_bs24" [@@noalloc]
   external unsafe_get_uint31 : string -> int -> int = "caml_extunix_get_bu31" [@@noalloc]
   external unsafe_get_int31  : string -> int -> int = "caml_extunix_get_bs31" [@@noalloc]
-  external unsafe_get_int32  : string -> int -> int32 = "caml_extunix_get_bs32"
+  external unsafe_get_int32  : string -> (int [@untagged]) -> (int32 [@unboxed]) = "caml_extunix_get_bs32" "caml_extunix_get_bs32_unboxed" [@@noalloc]
   external unsafe_get_uint63 : string -> int -> int = "caml_extunix_get_bu63" [@@noalloc]
   external unsafe_get_int63  : string -> int -> int = "caml_extunix_get_bs63" [@@noalloc]
-  external unsafe_get_int64  : string -> int -> int64 = "caml_extunix_get_bs64"
+  external unsafe_get_int64  : string -> (int [@untagged]) -> (int64 [@unboxed]) = "caml_extunix_get_bs64" "caml_extunix_get_bs64_unboxed" [@@noalloc]
+  external unsafe_get_float32 : string -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunix_get_bf32" "caml_extunix_get_bf32_unboxed" [@@noalloc]
+  external unsafe_get_float64 : string -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunix_get_bf64" "caml_extunix_get_bf64_unboxed" [@@noalloc]
 
   (** [get_X str off] same as [unsafe_get_X] but with bounds checking. *)
   let get_uint8 str off =
@@ -1578,6 +2064,16 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int16 str off
 
+  let get_uint24 str off =
+    if off < 0 || off > String.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_uint24 str off
+
+  let get_int24 str off =
+    if off < 0 || off > String.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_int24 str off
+
   let get_uint31 str off =
     if off < 0 || off > String.length str - 4
     then raise (Invalid_argument "index out of bounds");
@@ -1588,7 +2084,7 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int31 str off
 
-  let get_int32 str off =
+  let[@inline] get_int32 str off =
     if off < 0 || off > String.length str - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int32 str off
@@ -1603,11 +2099,21 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int63 str off
 
-  let get_int64 str off =
+  let[@inline] get_int64 str off =
     if off < 0 || off > String.length str - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int64 str off
 
+  let[@inline] get_float32 str off =
+    if off < 0 || off > String.length str - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float32 str off
+
+  let[@inline] get_float64 str off =
+    if off < 0 || off > String.length str - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float64 str off
+
   (** [unsafe_set_X buf off v] stores the integer [v] as type [X] in
       the buffer [buf] starting at offset [off]. Bounds checking is not
       performed. Use with caution and only when the program logic
@@ -1622,12 +2128,16 @@ module BigEndian = struct
   external unsafe_set_int8   : Bytes.t -> int -> int -> unit = "caml_extunix_set_8" [@@noalloc]
   external unsafe_set_uint16 : Bytes.t -> int -> int -> unit = "caml_extunix_set_b16" [@@noalloc]
   external unsafe_set_int16  : Bytes.t -> int -> int -> unit = "caml_extunix_set_b16" [@@noalloc]
+  external unsafe_set_uint24 : Bytes.t -> int -> int -> unit = "caml_extunix_set_b24" [@@noalloc]
+  external unsafe_set_int24  : Bytes.t -> int -> int -> unit = "caml_extunix_set_b24" [@@noalloc]
   external unsafe_set_uint31 : Bytes.t -> int -> int -> unit = "caml_extunix_set_b31" [@@noalloc]
   external unsafe_set_int31  : Bytes.t -> int -> int -> unit = "caml_extunix_set_b31" [@@noalloc]
-  external unsafe_set_int32  : Bytes.t -> int -> int32 -> unit = "caml_extunix_set_b32" [@@noalloc]
+  external unsafe_set_int32  : Bytes.t -> (int [@untagged]) -> (int32 [@unboxed]) -> unit = "caml_extunix_set_b32" "caml_extunix_set_b32_unboxed" [@@noalloc]
   external unsafe_set_uint63 : Bytes.t -> int -> int -> unit = "caml_extunix_set_b63" [@@noalloc]
   external unsafe_set_int63  : Bytes.t -> int -> int -> unit = "caml_extunix_set_b63" [@@noalloc]
-  external unsafe_set_int64  : Bytes.t -> int -> int64 -> unit = "caml_extunix_set_b64" [@@noalloc]
+  external unsafe_set_int64  : Bytes.t -> (int [@untagged]) -> (int64 [@unboxed]) -> unit = "caml_extunix_set_b64" "caml_extunix_set_b64_unboxed" [@@noalloc]
+  external unsafe_set_float32 : Bytes.t -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunix_set_bf32" "caml_extunix_set_bf32_unboxed" [@@noalloc]
+  external unsafe_set_float64 : Bytes.t -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunix_set_bf64" "caml_extunix_set_bf64_unboxed" [@@noalloc]
 
   (** [set_X buf off v] same as [unsafe_set_X] but with bounds checking. *)
   let set_uint8 str off v =
@@ -1650,6 +2160,16 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int16 str off v
 
+  let set_uint24 str off v =
+    if off < 0 || off > Bytes.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_uint24 str off v
+
+  let set_int24 str off v =
+    if off < 0 || off > Bytes.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_int24 str off v
+
   let set_uint31 str off v =
     if off < 0 || off > Bytes.length str - 4
     then raise (Invalid_argument "index out of bounds");
@@ -1660,7 +2180,7 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int31 str off v
 
-  let set_int32 str off v =
+  let[@inline] set_int32 str off v =
     if off < 0 || off > Bytes.length str - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int32 str off v
@@ -1675,11 +2195,21 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int63 str off v
 
-  let set_int64 str off v =
+  let[@inline] set_int64 str off v =
     if off < 0 || off > Bytes.length str - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int64 str off v
 
+  let[@inline] set_float32 str off v =
+    if off < 0 || off > Bytes.length str - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float32 str off v
+
+  let[@inline] set_float64 str off v =
+    if off < 0 || off > Bytes.length str - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float64 str off v
+
 ]
 
 end
@@ -1761,17 +2291,24 @@ module LittleEndian = struct
       Note: The 31bit functions extract a 32bit integer and return it
       as ocaml int. On 32bit platforms this can overflow as ocaml
       integers are 31bit signed there. No error is reported if this
-      occurs. Use with care. *)
+      occurs. Use with care.
+      Note: The float32 functions widen a single precision float.
+      Note: In native code the 32bit, 64bit and float functions take
+      and return unboxed values and do not allocate. *)
   external unsafe_get_uint8  : string -> int -> int = "caml_extunix_get_u8" [@@noalloc]
   external unsafe_get_int8   : string -> int -> int = "caml_extunix_get_s8" [@@noalloc]
   external unsafe_get_uint16 : string -> int -> int = "caml_extunix_get_lu16" [@@noalloc]
   external unsafe_get_int16  : string -> int -> int = "caml_extunix_get_ls16" [@@noalloc]
+  external unsafe_get_uint24 : string -> int -> int = "caml_extunix_get_lu24" [@@noalloc]
+  external unsafe_get_int24  : string -> int -> int = "caml_extunix_get_ls24" [@@noalloc]
   external unsafe_get_uint31 : string -> int -> int = "caml_extunix_get_lu31" [@@noalloc]
   external unsafe_get_int31  : string -> int -> int = "caml_extunix_get_ls31" [@@noalloc]
-  external unsafe_get_int32  : string -> int -> int32 = "caml_extunix_get_ls32"
+  external unsafe_get_int32  : string -> (int [@untagged]) -> (int32 [@unboxed]) = "caml_extunix_get_ls32" "caml_extunix_get_ls32_unboxed" [@@noalloc]
   external unsafe_get_uint63 : string -> int -> int = "caml_extunix_get_lu63" [@@noalloc]
   external unsafe_get_int63  : string -> int -> int = "caml_extunix_get_ls63" [@@noalloc]
-  external unsafe_get_int64  : string -> int -> int64 = "caml_extunix_get_ls64"
+  external unsafe_get_int64  : string -> (int [@untagged]) -> (int64 [@unboxed]) = "caml_extunix_get_ls64" "caml_extunix_get_ls64_unboxed" [@@noalloc]
+  external unsafe_get_float32 : string -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunix_get_lf32" "caml_extunix_get_lf32_unboxed" [@@noalloc]
+  external unsafe_get_float64 : string -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunix_get_lf64" "caml_extunix_get_lf64_unboxed" [@@noalloc]
 
   (** [get_X str off] same as [unsafe_get_X] but with bounds checking. *)
   let get_uint8 str off =
@@ -1794,6 +2331,16 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int16 str off
 
+  let get_uint24 str off =
+    if off < 0 || off > String.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_uint24 str off
+
+  let get_int24 str off =
+    if off < 0 || off > String.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_int24 str off
+
   let get_uint31 str off =
     if off < 0 || off > String.length str - 4
     then raise (Invalid_argument "index out of bounds");
@@ -1804,7 +2351,7 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int31 str off
 
-  let get_int32 str off =
+  let[@inline] get_int32 str off =
     if off < 0 || off > String.length str - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int32 str off
@@ -1819,11 +2366,21 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int63 str off
 
-  let get_int64 str off =
+  let[@inline] get_int64 str off =
     if off < 0 || off > String.length str - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int64 str off
 
+  let[@inline] get_float32 str off =
+    if off < 0 || off > String.length str - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float32 str off
+
+  let[@inline] get_float64 str off =
+    if off < 0 || off > String.length str - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float64 str off
+
   (** [unsafe_set_X buf off v] stores the integer [v] as type [X] in
       the buffer [buf] starting at offset [off]. Bounds checking is not
       performed. Use with caution and only when the program logic
@@ -1836,12 +2393,16 @@ module LittleEndian = struct
   external unsafe_set_int8   : Bytes.t -> int -> int -> unit = "caml_extunix_set_8" [@@noalloc]
   external unsafe_set_uint16 : Bytes.t -> int -> int -> unit = "caml_extunix_set_l16" [@@noalloc]
   external unsafe_set_int16  : Bytes.t -> int -> int -> unit = "caml_extunix_set_l16" [@@noalloc]
+  external unsafe_set_uint24 : Bytes.t -> int -> int -> unit = "caml_extunix_set_l24" [@@noalloc]
+  external unsafe_set_int24  : Bytes.t -> int -> int -> unit = "caml_extunix_set_l24" [@@noalloc]
   external unsafe_set_uint31 : Bytes.t -> int -> int -> unit = "caml_extunix_set_l31" [@@noalloc]
   external unsafe_set_int31  : Bytes.t -> int -> int -> unit = "caml_extunix_set_l31" [@@noalloc]
-  external unsafe_set_int32  : Bytes.t -> int -> int32 -> unit = "caml_extunix_set_l32" [@@noalloc]
+  external unsafe_set_int32  : Bytes.t -> (int [@untagged]) -> (int32 [@unboxed]) -> unit = "caml_extunix_set_l32" "caml_extunix_set_l32_unboxed" [@@noalloc]
   external unsafe_set_uint63 : Bytes.t -> int -> int -> unit = "caml_extunix_set_l63" [@@noalloc]
   external unsafe_set_int63  : Bytes.t -> int -> int -> unit = "caml_extunix_set_l63" [@@noalloc]
-  external unsafe_set_int64  : Bytes.t -> int -> int64 -> unit = "caml_extunix_set_l64" [@@noalloc]
+  external unsafe_set_int64  : Bytes.t -> (int [@untagged]) -> (int64 [@unboxed]) -> unit = "caml_extunix_set_l64" "caml_extunix_set_l64_unboxed" [@@noalloc]
+  external unsafe_set_float32 : Bytes.t -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunix_set_lf32" "caml_extunix_set_lf32_unboxed" [@@noalloc]
+  external unsafe_set_float64 : Bytes.t -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunix_set_lf64" "caml_extunix_set_lf64_unboxed" [@@noalloc]
 
   (** [set_X buf off v] same as [unsafe_set_X] but with bounds checking. *)
   let set_uint8 str off v =
@@ -1864,6 +2425,16 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int16 str off v
 
+  let set_uint24 str off v =
+    if off < 0 || off > Bytes.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_uint24 str off v
+
+  let set_int24 str off v =
+    if off < 0 || off > Bytes.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_int24 str off v
+
   let set_uint31 str off v =
     if off < 0 || off > Bytes.length str - 4
     then raise (Invalid_argument "index out of bounds");
@@ -1874,7 +2445,7 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int31 str off v
 
-  let set_int32 str off v =
+  let[@inline] set_int32 str off v =
     if off < 0 || off > Bytes.length str - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int32 str off v
@@ -1889,11 +2460,21 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int63 str off v
 
-  let set_int64 str off v =
+  let[@inline] set_int64 str off v =
     if off < 0 || off > Bytes.length str - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int64 str off v
 
+  let[@inline] set_float32 str off v =
+    if off < 0 || off > Bytes.length str - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float32 str off v
+
+  let[@inline] set_float64 str off v =
+    if off < 0 || off > Bytes.length str - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float64 str off v
+
 ]
 
 end
@@ -1914,17 +2495,24 @@ module HostEndian = struct
       integers are 31bit signed there. No error is reported if this
       occurs. Use with care.
       Note: The same applies to 63bit functions.
+      Note: The float32 functions widen a single precision float.
+      Note: In native code the 32bit, 64bit and float functions take
+      and return unboxed values and do not allocate.
   *)
   external unsafe_get_uint8  : string -> int -> int = "caml_extunix_get_u8" [@@noalloc]
   external unsafe_get_int8   : string -> int -> int = "caml_extunix_get_s8" [@@noalloc]
   external unsafe_get_uint16 : string -> int -> int = "caml_extunix_get_hu16" [@@noalloc]
   external unsafe_get_int16  : string -> int -> int = "caml_extunix_get_hs16" [@@noalloc]
+  external unsafe_get_uint24 : string -> int -> int = "caml_extunix_get_hu24" [@@noalloc]
+  external unsafe_get_int24  : string -> int -> int = "caml_extunix_get_hs24" [@@noalloc]
   external unsafe_get_uint31 : string -> int -> int = "caml_extunix_get_hu31" [@@noalloc]
   external unsafe_get_int31  : string -> int -> int = "caml_extunix_get_hs31" [@@noalloc]
-  external unsafe_get_int32  : string -> int -> int32 = "caml_extunix_get_hs32"
+  external unsafe_get_int32  : string -> (int [@untagged]) -> (int32 [@unboxed]) = "caml_extunix_get_hs32" "caml_extunix_get_hs32_unboxed" [@@noalloc]
   external unsafe_get_uint63 : string -> int -> int = "caml_extunix_get_hu63" [@@noalloc]
   external unsafe_get_int63  : string -> int -> int = "caml_extunix_get_hs63" [@@noalloc]
-  external unsafe_get_int64  : string -> int -> int64 = "caml_extunix_get_hs64"
+  external unsafe_get_int64  : string -> (int [@untagged]) -> (int64 [@unboxed]) = "caml_extunix_get_hs64" "caml_extunix_get_hs64_unboxed" [@@noalloc]
+  external unsafe_get_float32 : string -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunix_get_hf32" "caml_extunix_get_hf32_unboxed" [@@noalloc]
+  external unsafe_get_float64 : string -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunix_get_hf64" "caml_extunix_get_hf64_unboxed" [@@noalloc]
 
   (** [get_X str off] same as [unsafe_get_X] but with bounds checking. *)
   let get_uint8 str off =
@@ -1947,6 +2535,16 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int16 str off
 
+  let get_uint24 str off =
+    if off < 0 || off > String.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_uint24 str off
+
+  let get_int24 str off =
+    if off < 0 || off > String.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_int24 str off
+
   let get_uint31 str off =
     if off < 0 || off > String.length str - 4
     then raise (Invalid_argument "index out of bounds");
@@ -1957,7 +2555,7 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int31 str off
 
-  let get_int32 str off =
+  let[@inline] get_int32 str off =
     if off < 0 || off > String.length str - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int32 str off
@@ -1972,11 +2570,21 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int63 str off
 
-  let get_int64 str off =
+  let[@inline] get_int64 str off =
     if off < 0 || off > String.length str - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int64 str off
 
+  let[@inline] get_float32 str off =
+    if off < 0 || off > String.length str - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float32 str off
+
+  let[@inline] get_float64 str off =
+    if off < 0 || off > String.length str - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float64 str off
+
   (** [unsafe_set_X buf off v] stores the integer [v] as type [X] in
       the buffer [buf] starting at offset [off]. Bounds checking is not
       performed. Use with caution and only when the program logic
@@ -1991,12 +2599,16 @@ module HostEndian = struct
   external unsafe_set_int8   : Bytes.t -> int -> int -> unit = "caml_extunix_set_8" [@@noalloc]
   external unsafe_set_uint16 : Bytes.t -> int -> int -> unit = "caml_extunix_set_h16" [@@noalloc]
   external unsafe_set_int16  : Bytes.t -> int -> int -> unit = "caml_extunix_set_h16" [@@noalloc]
+  external unsafe_set_uint24 : Bytes.t -> int -> int -> unit = "caml_extunix_set_h24" [@@noalloc]
+  external unsafe_set_int24  : Bytes.t -> int -> int -> unit = "caml_extunix_set_h24" [@@noalloc]
   external unsafe_set_uint31 : Bytes.t -> int -> int -> unit = "caml_extunix_set_h31" [@@noalloc]
   external unsafe_set_int31  : Bytes.t -> int -> int -> unit = "caml_extunix_set_h31" [@@noalloc]
-  external unsafe_set_int32  : Bytes.t -> int -> int32 -> unit = "caml_extunix_set_h32" [@@noalloc]
+  external unsafe_set_int32  : Bytes.t -> (int [@untagged]) -> (int32 [@unboxed]) -> unit = "caml_extunix_set_h32" "caml_extunix_set_h32_unboxed" [@@noalloc]
   external unsafe_set_uint63 : Bytes.t -> int -> int -> unit = "caml_extunix_set_h63" [@@noalloc]
   external unsafe_set_int63  : Bytes.t -> int -> int -> unit = "caml_extunix_set_h63" [@@noalloc]
-  external unsafe_set_int64  : Bytes.t -> int -> int64 -> unit = "caml_extunix_set_h64" [@@noalloc]
+  external unsafe_set_int64  : Bytes.t -> (int [@untagged]) -> (int64 [@unboxed]) -> unit = "caml_extunix_set_h64" "caml_extunix_set_h64_unboxed" [@@noalloc]
+  external unsafe_set_float32 : Bytes.t -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunix_set_hf32" "caml_extunix_set_hf32_unboxed" [@@noalloc]
+  external unsafe_set_float64 : Bytes.t -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunix_set_hf64" "caml_extunix_set_hf64_unboxed" [@@noalloc]
 
   (** [set_X buf off v] same as [unsafe_set_X] but with bounds checking. *)
   let set_uint8 str off v =
@@ -2019,6 +2631,16 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int16 str off v
 
+  let set_uint24 str off v =
+    if off < 0 || off > Bytes.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_uint24 str off v
+
+  let set_int24 str off v =
+    if off < 0 || off > Bytes.length str - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_int24 str off v
+
   let set_uint31 str off v =
     if off < 0 || off > Bytes.length str - 4
     then raise (Invalid_argument "index out of bounds");
@@ -2029,7 +2651,7 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int31 str off v
 
-  let set_int32 str off v =
+  let[@inline] set_int32 str off v =
     if off < 0 || off > Bytes.length str - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int32 str off v
@@ -2044,11 +2666,21 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int63 str off v
 
-  let set_int64 str off v =
+  let[@inline] set_int64 str off v =
     if off < 0 || off > Bytes.length str - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int64 str off v
 
+  let[@inline] set_float32 str off v =
+    if off < 0 || off > Bytes.length str - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float32 str off v
+
+  let[@inline] set_float64 str off v =
+    if off < 0 || off > Bytes.length str - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float64 str off v
+
 end
 
 [%%have READ_CREDENTIALS
@@ -2118,6 +2750,63 @@ let recvmsg_nofd fd =
   | (Some fd, msg) -> Unix.close fd; msg
   | (None, msg) -> msg
 
+(** Flags reported by {!BA.recvmsg} *)
+type recv_flag =
+  | MSG_TRUNC (** part of the datagram did not fit the buffers and was discarded *)
+  | MSG_CTRUNC (** some ancillary data (e.g. descriptors) was discarded *)
+
+type recvmsg_result = {
+  recv_len : int; (** number of bytes received *)
+  recv_fd : Unix.file_descr option; (** descriptor passed along the message *)
+  recv_flags : recv_flag list;
+}
+
+]
+
+[%%have SENDFDS
+
+(** {2 Passing several descriptors per message} *)
+
+(** Largest number of descriptors the kernel accepts in one message *)
+let scm_max_fd = 253
+
+external unsafe_sendfds : Unix.file_descr -> Unix.file_descr array -> int -> int -> unit = "caml_extunix_sendfds"
+
+(** [sendfds ~sock ~fds] sends the descriptors [fds] (at most
+    {!scm_max_fd}) through the UNIX domain socket [sock], with a one
+    byte sentinel message. *)
+let sendfds ~sock ~fds =
+  let n = Array.length fds in
+  if n = 0 || n > scm_max_fd then invalid_arg "ExtUnix.sendfds";
+  unsafe_sendfds sock fds 0 n
+
+(** [sendfds_batch ~sock ~fds] sends any number of descriptors in as
+    few messages as possible.
+    @return the number of messages sent *)
+let sendfds_batch ~sock ~fds =
+  let n = Array.length fds in
+  let rec loop ofs msgs =
+    if ofs >= n then msgs
+    else begin
+      let len = min scm_max_fd (n - ofs) in
+      unsafe_sendfds sock fds ofs len;
+      loop (ofs + len) (msgs + 1)
+    end
+  in
+  loop 0 0
+
+external recvfds_ : Unix.file_descr -> bool -> Unix.file_descr array = "caml_extunix_recvfds"
+
+(** [recvfds ?cloexec sock] receives the descriptors of one message
+    sent by {!sendfds} or {!sendfds_batch}, with close-on-exec set
+    unless [cloexec] is [false] (default [true]).
+    @raise End_of_file if the peer closed the connection
+    @raise Unix.Unix_error EMFILE if the kernel dropped some of the
+    descriptors (MSG_CTRUNC), e.g. because of [RLIMIT_NOFILE]; the
+    message is consumed and the descriptors that were received are
+    closed *)
+let recvfds ?(cloexec=true) sock = recvfds_ sock cloexec
+
 ]
 
 [%%have SYSCONF
@@ -2185,25 +2874,6 @@ let sysconf sc =
   @author Pierre Chambart <pierre.chambart@ocamlpro.com>
 *)
 
-(** splice functions flags *)
-type splice_flag =
-  | SPLICE_F_MOVE     (** Attempt to move pages instead of copying. Only a hint
-                          to the kernel *)
-  | SPLICE_F_NONBLOCK (** Do not block on I/O *)
-  | SPLICE_F_MORE     (** Announce that more data will be coming. Hint used by
-                          sockets *)
-  | SPLICE_F_GIFT     (** The user pages are a gift to the kernel. The
-                          application may not modify this memory ever, or page
-                          cache and on-disk data may differ. Gifting pages to
-                          the kernel means that a subsequent splice(2)
-                          SPLICE_F_MOVE can successfully move the pages; if
-                          this flag is not specified, then a subsequent
-                          splice(2) SPLICE_F_MOVE must copy the pages. Data
-                          must also be properly page aligned, both in memory
-                          and length.
-
-                          Only use for [vmsplice]. *)
-
 ]
 
 [%%have SPLICE
@@ -2245,11 +2915,52 @@ external splice : Unix.file_descr -> int option -> Unix.file_descr -> int option
 external tee : Unix.file_descr -> Unix.file_descr -> int -> splice_flag list -> int = "caml_extunix_tee"
 ]
 
+[%%have SPLICE_PUMP
+
+(** result of {!splice_pump} *)
+type pump_result = {
+  fwd_bytes : int; (** bytes moved from [fd1] to [fd2] *)
+  bwd_bytes : int; (** bytes moved from [fd2] to [fd1] *)
+  fwd_eof : bool; (** end of stream was seen on [fd1] and propagated to [fd2] *)
+  bwd_eof : bool; (** end of stream was seen on [fd2] and propagated to [fd1] *)
+}
+
+external unsafe_splice_pump : Unix.file_descr -> Unix.file_descr -> int -> int -> float option -> pump_result = "caml_extunix_splice_pump"
+
+(** [splice_pump ?timeout fd1 fd2 ~pipe_size ~max_bytes] relays data in
+    both directions between the sockets [fd1] and [fd2] through a pair of
+    internal pipes (resized to [pipe_size] bytes with F_SETPIPE_SZ when
+    possible), without copying it to user space. The whole loop runs
+    without holding the runtime lock.
+
+    Once a direction reaches end of stream and its pipe is drained the
+    writing side of the destination is shut down. The relay stops when
+    both directions are finished, after [max_bytes] bytes were read in
+    total, or when nothing could be moved for [timeout] seconds (default:
+    wait forever, [Some 0.] returns as soon as both sockets would block).
+    Data already read into a pipe is always delivered before returning.
+    Both sockets are switched to non-blocking mode during the call and
+    their flags are restored before returning.
+
+    @raise Unix.Unix_error on failure, data moved so far is lost then *)
+let splice_pump ?timeout fd1 fd2 ~pipe_size ~max_bytes =
+  if max_bytes <= 0 || pipe_size < 0 || (match timeout with Some t -> not (t >= 0.) | None -> false)
+  then invalid_arg "ExtUnix.splice_pump"
+  else unsafe_splice_pump fd1 fd2 pipe_size max_bytes timeout
+]
+
 (** {2 Bigarray variants} *)
 
 (** *)
 module BA = struct
 
+(** I/O vector, same as {!ExtUnix.iov} *)
+type nonrec 'a iov = 'a iov = {
+  iov_buf : 'a carray8;
+  iov_off : int;
+  iov_len : int;
+}
+
 [%%have PREAD
 
 (** {2 pread}
@@ -2484,6 +3195,234 @@ external write: Unix.file_descr -> ('a, 'b) carray -> int = "caml_extunixba_writ
 external intr_write: Unix.file_descr -> ('a, 'b) carray -> int = "caml_extunixba_intr_write"
 ]
 
+[%%have PREADV
+
+(** {2 preadv} *)
+
+(** [all_preadv fd off iovs] reads from file descriptor [fd] at offset
+    [off] (from the start of the file) into the buffer slices described
+    by [iovs], filling them in order. The file offset is not changed.
+
+    [all_preadv] repeats the read operation, resuming in the middle of
+    a slice if needed, until all slices have been filled or an error
+    occurs. Returns less than the number of characters requested on
+    EAGAIN, EWOULDBLOCK or End-of-file but only ever returns 0 on
+    End-of-file. Continues the read operation on EINTR. Raises an
+    Unix.Unix_error exception in all other cases.
+
+    Raises [Invalid_argument] if a slice does not lie within its
+    buffer. *)
+external unsafe_all_preadv: Unix.file_descr -> int -> 'a iov array -> int = "caml_extunixba_all_preadv"
+
+let all_preadv fd off iovs =
+  if off < 0
+  then invalid_arg "ExtUnix.all_preadv"
+  else unsafe_all_preadv fd off iovs
+
+(** [single_preadv fd off iovs] reads from file descriptor [fd] at
+    offset [off] (from the start of the file) into the buffer slices
+    described by [iovs]. The file offset is not changed.
+
+    [single_preadv] attempts to read only once. Returns the number of
+    characters read or raises an Unix.Unix_error exception. *)
+external unsafe_single_preadv: Unix.file_descr -> int -> 'a iov array -> int = "caml_extunixba_single_preadv"
+
+let single_preadv fd off iovs =
+  if off < 0
+  then invalid_arg "ExtUnix.single_preadv"
+  else unsafe_single_preadv fd off iovs
+
+(** [preadv fd off iovs] reads from file descriptor [fd] at offset
+    [off] (from the start of the file) into the buffer slices described
+    by [iovs]. The file offset is not changed.
+
+    [preadv] repeats the read operation until all slices have been
+    filled or an error occurs. Raises an Unix.Unix_error exception if 0
+    characters could be read before an error occurs. Continues the read
+    operation on EINTR. Returns the number of characters read in all
+    other cases. *)
+external unsafe_preadv: Unix.file_descr -> int -> 'a iov array -> int = "caml_extunixba_preadv"
+
+let preadv fd off iovs =
+  if off < 0
+  then invalid_arg "ExtUnix.preadv"
+  else unsafe_preadv fd off iovs
+
+(** [intr_preadv fd off iovs] reads from file descriptor [fd] at offset
+    [off] (from the start of the file) into the buffer slices described
+    by [iovs]. The file offset is not changed.
+
+    [intr_preadv] repeats the read operation until all slices have been
+    filled or an error occurs. Raises an Unix.Unix_error exception if 0
+    characters could be read before an error occurs. Does NOT continue
+    on EINTR. Returns the number of characters read in all other
+    cases. *)
+external unsafe_intr_preadv: Unix.file_descr -> int -> 'a iov array -> int = "caml_extunixba_intr_preadv"
+
+let intr_preadv fd off iovs =
+  if off < 0
+  then invalid_arg "ExtUnix.intr_preadv"
+  else unsafe_intr_preadv fd off iovs
+]
+
+[%%have PWRITEV
+
+(** {2 pwritev} *)
+
+(** [all_pwritev fd off iovs] writes the buffer slices described by
+    [iovs], in order, to file descriptor [fd] at offset [off] (from the
+    start of the file). The file offset is not changed.
+
+    [all_pwritev] repeats the write operation, resuming in the middle
+    of a slice if needed, until all slices have been written or an
+    error occurs. Returns less than the number of characters requested
+    on EAGAIN, EWOULDBLOCK but never 0. Continues the write operation
+    on EINTR. Raises an Unix.Unix_error exception in all other cases.
+
+    Raises [Invalid_argument] if a slice does not lie within its
+    buffer. *)
+external unsafe_all_pwritev: Unix.file_descr -> int -> 'a iov array -> int = "caml_extunixba_all_pwritev"
+
+let all_pwritev fd off iovs =
+  if off < 0
+  then invalid_arg "ExtUnix.all_pwritev"
+  else unsafe_all_pwritev fd off iovs
+
+(** [single_pwritev fd off iovs] writes the buffer slices described by
+    [iovs] to file descriptor [fd] at offset [off] (from the start of
+    the file). The file offset is not changed.
+
+    [single_pwritev] attempts to write only once. Returns the number of
+    characters written or raises an Unix.Unix_error exception. *)
+external unsafe_single_pwritev: Unix.file_descr -> int -> 'a iov array -> int = "caml_extunixba_single_pwritev"
+
+let single_pwritev fd off iovs =
+  if off < 0
+  then invalid_arg "ExtUnix.single_pwritev"
+  else unsafe_single_pwritev fd off iovs
+
+(** [pwritev fd off iovs] writes the buffer slices described by [iovs]
+    to file descriptor [fd] at offset [off] (from the start of the
+    file). The file offset is not changed.
+
+    [pwritev] repeats the write operation until all slices have been
+    written or an error occurs. Raises an Unix.Unix_error exception if
+    0 characters could be written before an error occurs. Continues the
+    write operation on EINTR. Returns the number of characters written
+    in all other cases. *)
+external unsafe_pwritev: Unix.file_descr -> int -> 'a iov array -> int = "caml_extunixba_pwritev"
+
+let pwritev fd off iovs =
+  if off < 0
+  then invalid_arg "ExtUnix.pwritev"
+  else unsafe_pwritev fd off iovs
+
+(** [intr_pwritev fd off iovs] writes the buffer slices described by
+    [iovs] to file descriptor [fd] at offset [off] (from the start of
+    the file). The file offset is not changed.
+
+    [intr_pwritev] repeats the write operation until all slices have
+    been written or an error occurs. Raises an Unix.Unix_error
+    exception if 0 characters could be written before an error occurs.
+    Does NOT continue on EINTR. Returns the number of characters
+    written in all other cases. *)
+external unsafe_intr_pwritev: Unix.file_descr -> int -> 'a iov array -> int = "caml_extunixba_intr_pwritev"
+
+let intr_pwritev fd off iovs =
+  if off < 0
+  then invalid_arg "ExtUnix.intr_pwritev"
+  else unsafe_intr_pwritev fd off iovs
+]
+
+[%%have PREADV2
+
+(** {2 preadv2/pwritev2} *)
+
+(** [preadv2 fd off iovs flags] reads from file descriptor [fd] at
+    offset [off] (from the start of the file) into the buffer slices
+    described by [iovs], with the behaviour modified by [flags]. The
+    file offset is not changed.
+
+    Attempts to read only once. Returns [Some n] where [n] is the
+    number of characters read, or [None] if the data is not
+    immediately available (EAGAIN, only with [RWF_NOWAIT]). With
+    [RWF_NOWAIT] the runtime lock is not released. At most IOV_MAX
+    slices are read by a single call. Raises an Unix.Unix_error
+    exception in all other cases, including EAGAIN without
+    [RWF_NOWAIT]. *)
+external unsafe_preadv2: Unix.file_descr -> int -> 'a iov array -> rw_flag list -> int option = "caml_extunixba_preadv2"
+
+let preadv2 fd off iovs flags =
+  if off < 0
+  then invalid_arg "ExtUnix.preadv2"
+  else unsafe_preadv2 fd off iovs flags
+
+(** [pwritev2 fd off iovs flags] writes the buffer slices described by
+    [iovs] to file descriptor [fd] at offset [off] (from the start of
+    the file), with the behaviour modified by [flags]. The file offset
+    is not changed.
+
+    Attempts to write only once. Returns [Some n] where [n] is the
+    number of characters written, or [None] if the write would block
+    (EAGAIN, only with [RWF_NOWAIT]). With [RWF_NOWAIT] the runtime lock is
+    not released. At most IOV_MAX slices are written by a single call.
+    Raises an Unix.Unix_error exception in all other cases, including
+    EAGAIN without [RWF_NOWAIT]. *)
+external unsafe_pwritev2: Unix.file_descr -> int -> 'a iov array -> rw_flag list -> int option = "caml_extunixba_pwritev2"
+
+let pwritev2 fd off iovs flags =
+  if off < 0
+  then invalid_arg "ExtUnix.pwritev2"
+  else unsafe_pwritev2 fd off iovs flags
+]
+
+[%%have SENDMSG
+
+(** {2 sendmsg / recvmsg} *)
+
+(** [sendmsg fd ?sendfd iovs flags] sends the buffer slices described
+    by [iovs] as one message, and optionally the file descriptor
+    [sendfd], without copying the data.
+    @raise Unix.Unix_error [EMSGSIZE] if [iovs] has more than IOV_MAX slices
+    @return the number of bytes sent *)
+external sendmsg: Unix.file_descr -> ?sendfd:Unix.file_descr -> 'a iov array -> Unix.msg_flag list -> int = "caml_extunixba_sendmsg"
+
+(** [recvmsg fd iovs flags] receives a message (and possibly a file
+    descriptor) directly into the buffer slices described by [iovs].
+    A datagram larger than the buffers is reported with [MSG_TRUNC]. *)
+external recvmsg: Unix.file_descr -> 'a iov array -> Unix.msg_flag list -> recvmsg_result = "caml_extunixba_recvmsg"
+]
+
+[%%have UDP_GSO
+
+(** {2 UDP segmentation offload} *)
+
+(** [sendmsg_gso fd ~gso_size iovs flags] sends the UDP payload described
+    by [iovs] as a train of datagrams of [gso_size] bytes (the last one
+    may be shorter), split by the kernel ([UDP_SEGMENT] control message).
+    The payload is limited to 64 datagrams and 64 KiB.
+    @return the number of bytes sent *)
+external sendmsg_gso: Unix.file_descr -> gso_size:int -> 'a iov array -> Unix.msg_flag list -> int = "caml_extunixba_sendmsg_gso"
+
+(** [recvmsg_gro fd iovs flags] receives into [iovs] on a socket with
+    the [UDP_GRO] option set, where the kernel may coalesce consecutive
+    datagrams of a flow.
+    @return [(len, segment_size)], the payload holds datagrams of
+    [segment_size] bytes (the last one may be shorter), [segment_size]
+    is 0 when a single datagram was received *)
+external recvmsg_gro: Unix.file_descr -> 'a iov array -> Unix.msg_flag list -> int * int = "caml_extunixba_recvmsg_gro"
+]
+
+[%%have ZEROCOPY
+
+(** [send_zerocopy fd iovs flags] sends like {!sendmsg} with
+    [MSG_ZEROCOPY]: the kernel keeps referencing the buffers after the
+    call returns, they must not be modified until the completion is
+    reported, see {!Zerocopy}. The socket needs the [SO_ZEROCOPY] option.
+    @return the number of bytes sent *)
+external send_zerocopy: Unix.file_descr -> 'a iov array -> Unix.msg_flag list -> int = "caml_extunixba_send_zerocopy"
+]
+
 (** {2 Byte order conversion} *)
 
 (** {2 big endian functions}
@@ -2505,17 +3444,24 @@ module BigEndian = struct
       integers are 31bit signed there. No error is reported if this
       occurs. Use with care.
       Note: The same applies to 63bit functions.
+      Note: The float32 functions widen a single precision float.
+      Note: In native code the 32bit, 64bit and float functions take
+      and return unboxed values and do not allocate.
   *)
   external unsafe_get_uint8  : 'a carray8 -> int -> int = "caml_extunixba_get_u8" [@@noalloc]
   external unsafe_get_int8   : 'a carray8 -> int -> int = "caml_extunixba_get_s8" [@@noalloc]
   external unsafe_get_uint16 : 'a carray8 -> int -> int = "caml_extunixba_get_bu16" [@@noalloc]
   external unsafe_get_int16  : 'a carray8 -> int -> int = "caml_extunixba_get_bs16" [@@noalloc]
+  external unsafe_get_uint24 : 'a carray8 -> int -> int = "caml_extunixba_get_bu24" [@@noalloc]
+  external unsafe_get_int24  : 'a carray8 -> int -> int = "caml_extunixba_get_bs24" [@@noalloc]
   external unsafe_get_uint31 : 'a carray8 -> int -> int = "caml_extunixba_get_bu31" [@@noalloc]
   external unsafe_get_int31  : 'a carray8 -> int -> int = "caml_extunixba_get_bs31" [@@noalloc]
-  external unsafe_get_int32  : 'a carray8 -> int -> int32 = "caml_extunixba_get_bs32"
+  external unsafe_get_int32  : 'a carray8 -> (int [@untagged]) -> (int32 [@unboxed]) = "caml_extunixba_get_bs32" "caml_extunixba_get_bs32_unboxed" [@@noalloc]
   external unsafe_get_uint63 : 'a carray8 -> int -> int = "caml_extunixba_get_bu63" [@@noalloc]
   external unsafe_get_int63  : 'a carray8 -> int -> int = "caml_extunixba_get_bs63" [@@noalloc]
-  external unsafe_get_int64  : 'a carray8 -> int -> int64 = "caml_extunixba_get_bs64"
+  external unsafe_get_int64  : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed]) = "caml_extunixba_get_bs64" "caml_extunixba_get_bs64_unboxed" [@@noalloc]
+  external unsafe_get_float32 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunixba_get_bf32" "caml_extunixba_get_bf32_unboxed" [@@noalloc]
+  external unsafe_get_float64 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunixba_get_bf64" "caml_extunixba_get_bf64_unboxed" [@@noalloc]
 
   (** [get_X buf off] same as [unsafe_get_X] but with bounds checking. *)
   let get_uint8 buf off =
@@ -2538,6 +3484,16 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int16 buf off
 
+  let get_uint24 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_uint24 buf off
+
+  let get_int24 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_int24 buf off
+
   let get_uint31 buf off =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
@@ -2548,7 +3504,7 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int31 buf off
 
-  let get_int32 buf off =
+  let[@inline] get_int32 buf off =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int32 buf off
@@ -2563,11 +3519,60 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int63 buf off
 
-  let get_int64 buf off =
+  let[@inline] get_int64 buf off =
     if off < 0 || off > Bigarray.Array1.dim buf - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int64 buf off
 
+  let[@inline] get_float32 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float32 buf off
+
+  let[@inline] get_float64 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float64 buf off
+
+  (** [unsafe_get_X_array buf off dst dst_off len] decodes [len]
+      consecutive values of type [X] from [buf] starting at offset [off]
+      into [dst] starting at index [dst_off], in a single call. Integers
+      are sign extended, 32bit floats are widened. Bounds checking is not
+      performed.
+  *)
+  external unsafe_get_int16_array : 'a carray8 -> int -> (int32, Bigarray.int32_elt, Bigarray.c_layout) Bigarray.Array1.t -> int -> int -> unit = "caml_extunixba_get_bs16_array" [@@noalloc]
+  external unsafe_get_int32_array : 'a carray8 -> int -> (int32, Bigarray.int32_elt, Bigarray.c_layout) Bigarray.Array1.t -> int -> int -> unit = "caml_extunixba_get_bs32_array" [@@noalloc]
+  external unsafe_get_int64_array : 'a carray8 -> int -> (int64, Bigarray.int64_elt, Bigarray.c_layout) Bigarray.Array1.t -> int -> int -> unit = "caml_extunixba_get_bs64_array" [@@noalloc]
+  external unsafe_get_float32_array : 'a carray8 -> int -> (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t -> int -> int -> unit = "caml_extunixba_get_bf32_array" [@@noalloc]
+  external unsafe_get_float64_array : 'a carray8 -> int -> (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t -> int -> int -> unit = "caml_extunixba_get_bf64_array" [@@noalloc]
+
+  let check_array buf off size dst dst_off len =
+    if len < 0 || off < 0 || dst_off < 0
+      || len > (Bigarray.Array1.dim buf - off) / size
+      || dst_off > Bigarray.Array1.dim dst - len
+    then raise (Invalid_argument "index out of bounds")
+
+  (** [get_X_array buf off dst dst_off len] same as [unsafe_get_X_array] but with bounds checking. *)
+  let get_int16_array buf off dst dst_off len =
+    check_array buf off 2 dst dst_off len;
+    unsafe_get_int16_array buf off dst dst_off len
+
+  let get_int32_array buf off dst dst_off len =
+    check_array buf off 4 dst dst_off len;
+    unsafe_get_int32_array buf off dst dst_off len
+
+  let get_int64_array buf off dst dst_off len =
+    check_array buf off 8 dst dst_off len;
+    unsafe_get_int64_array buf off dst dst_off len
+
+  let get_float32_array buf off dst dst_off len =
+    check_array buf off 4 dst dst_off len;
+    unsafe_get_float32_array buf off dst dst_off len
+
+  let get_float64_array buf off dst dst_off len =
+    check_array buf off 8 dst dst_off len;
+    unsafe_get_float64_array buf off dst dst_off len
+
   (** [unsafe_set_X buf off v] stores the integer [v] as type [X] in a
       buffer [buf] starting at offset [off]. Bounds checking is not
       performed. Use with caution and only when the program logic
@@ -2582,12 +3587,16 @@ module BigEndian = struct
   external unsafe_set_int8   : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_8" [@@noalloc]
   external unsafe_set_uint16 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_b16" [@@noalloc]
   external unsafe_set_int16  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_b16" [@@noalloc]
+  external unsafe_set_uint24 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_b24" [@@noalloc]
+  external unsafe_set_int24  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_b24" [@@noalloc]
   external unsafe_set_uint31 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_b31" [@@noalloc]
   external unsafe_set_int31  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_b31" [@@noalloc]
-  external unsafe_set_int32  : 'a carray8 -> int -> int32 -> unit = "caml_extunixba_set_b32" [@@noalloc]
+  external unsafe_set_int32  : 'a carray8 -> (int [@untagged]) -> (int32 [@unboxed]) -> unit = "caml_extunixba_set_b32" "caml_extunixba_set_b32_unboxed" [@@noalloc]
   external unsafe_set_uint63 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_b63" [@@noalloc]
   external unsafe_set_int63  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_b63" [@@noalloc]
-  external unsafe_set_int64  : 'a carray8 -> int -> int64 -> unit = "caml_extunixba_set_b64" [@@noalloc]
+  external unsafe_set_int64  : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed]) -> unit = "caml_extunixba_set_b64" "caml_extunixba_set_b64_unboxed" [@@noalloc]
+  external unsafe_set_float32 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunixba_set_bf32" "caml_extunixba_set_bf32_unboxed" [@@noalloc]
+  external unsafe_set_float64 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunixba_set_bf64" "caml_extunixba_set_bf64_unboxed" [@@noalloc]
 
   (** [set_X buf off v] same as [unsafe_set_X] but with bounds checking. *)
   let set_uint8 buf off v =
@@ -2610,6 +3619,16 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int16 buf off v
 
+  let set_uint24 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_uint24 buf off v
+
+  let set_int24 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_int24 buf off v
+
   let set_uint31 buf off v =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
@@ -2620,7 +3639,7 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int31 buf off v
 
-  let set_int32 buf off v =
+  let[@inline] set_int32 buf off v =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int32 buf off v
@@ -2635,11 +3654,21 @@ module BigEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int63 buf off v
 
-  let set_int64 buf off v =
+  let[@inline] set_int64 buf off v =
     if off < 0 || off > Bigarray.Array1.dim buf - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int64 buf off v
 
+  let[@inline] set_float32 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float32 buf off v
+
+  let[@inline] set_float64 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float64 buf off v
+
 ]
 
 end (* module BigEndian *)
@@ -2663,17 +3692,24 @@ module LittleEndian = struct
       integers are 31bit signed there. No error is reported if this
       occurs. Use with care.
       Note: The same applies to 63bit functions.
+      Note: The float32 functions widen a single precision float.
+      Note: In native code the 32bit, 64bit and float functions take
+      and return unboxed values and do not allocate.
   *)
   external unsafe_get_uint8  : 'a carray8 -> int -> int = "caml_extunixba_get_u8" [@@noalloc]
   external unsafe_get_int8   : 'a carray8 -> int -> int = "caml_extunixba_get_s8" [@@noalloc]
   external unsafe_get_uint16 : 'a carray8 -> int -> int = "caml_extunixba_get_lu16" [@@noalloc]
   external unsafe_get_int16  : 'a carray8 -> int -> int = "caml_extunixba_get_ls16" [@@noalloc]
+  external unsafe_get_uint24 : 'a carray8 -> int -> int = "caml_extunixba_get_lu24" [@@noalloc]
+  external unsafe_get_int24  : 'a carray8 -> int -> int = "caml_extunixba_get_ls24" [@@noalloc]
   external unsafe_get_uint31 : 'a carray8 -> int -> int = "caml_extunixba_get_lu31" [@@noalloc]
   external unsafe_get_int31  : 'a carray8 -> int -> int = "caml_extunixba_get_ls31" [@@noalloc]
-  external unsafe_get_int32  : 'a carray8 -> int -> int32 = "caml_extunixba_get_ls32"
+  external unsafe_get_int32  : 'a carray8 -> (int [@untagged]) -> (int32 [@unboxed]) = "caml_extunixba_get_ls32" "caml_extunixba_get_ls32_unboxed" [@@noalloc]
   external unsafe_get_uint63 : 'a carray8 -> int -> int = "caml_extunixba_get_lu63" [@@noalloc]
   external unsafe_get_int63  : 'a carray8 -> int -> int = "caml_extunixba_get_ls63" [@@noalloc]
-  external unsafe_get_int64  : 'a carray8 -> int -> int64 = "caml_extunixba_get_ls64"
+  external unsafe_get_int64  : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed]) = "caml_extunixba_get_ls64" "caml_extunixba_get_ls64_unboxed" [@@noalloc]
+  external unsafe_get_float32 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunixba_get_lf32" "caml_extunixba_get_lf32_unboxed" [@@noalloc]
+  external unsafe_get_float64 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunixba_get_lf64" "caml_extunixba_get_lf64_unboxed" [@@noalloc]
 
   (** [get_X buf off] same as [unsafe_get_X] but with bounds checking. *)
   let get_uint8 buf off =
@@ -2696,6 +3732,16 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int16 buf off
 
+  let get_uint24 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_uint24 buf off
+
+  let get_int24 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_int24 buf off
+
   let get_uint31 buf off =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
@@ -2706,7 +3752,7 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int31 buf off
 
-  let get_int32 buf off =
+  let[@inline] get_int32 buf off =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int32 buf off
@@ -2721,11 +3767,60 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int63 buf off
 
-  let get_int64 buf off =
+  let[@inline] get_int64 buf off =
     if off < 0 || off > Bigarray.Array1.dim buf - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int64 buf off
 
+  let[@inline] get_float32 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float32 buf off
+
+  let[@inline] get_float64 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float64 buf off
+
+  (** [unsafe_get_X_array buf off dst dst_off len] decodes [len]
+      consecutive values of type [X] from [buf] starting at offset [off]
+      into [dst] starting at index [dst_off], in a single call. Integers
+      are sign extended, 32bit floats are widened. Bounds checking is not
+      performed.
+  *)
+  external unsafe_get_int16_array : 'a carray8 -> int -> (int32, Bigarray.int32_elt, Bigarray.c_layout) Bigarray.Array1.t -> int -> int -> unit = "caml_extunixba_get_ls16_array" [@@noalloc]
+  external unsafe_get_int32_array : 'a carray8 -> int -> (int32, Bigarray.int32_elt, Bigarray.c_layout) Bigarray.Array1.t -> int -> int -> unit = "caml_extunixba_get_ls32_array" [@@noalloc]
+  external unsafe_get_int64_array : 'a carray8 -> int -> (int64, Bigarray.int64_elt, Bigarray.c_layout) Bigarray.Array1.t -> int -> int -> unit = "caml_extunixba_get_ls64_array" [@@noalloc]
+  external unsafe_get_float32_array : 'a carray8 -> int -> (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t -> int -> int -> unit = "caml_extunixba_get_lf32_array" [@@noalloc]
+  external unsafe_get_float64_array : 'a carray8 -> int -> (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t -> int -> int -> unit = "caml_extunixba_get_lf64_array" [@@noalloc]
+
+  let check_array buf off size dst dst_off len =
+    if len < 0 || off < 0 || dst_off < 0
+      || len > (Bigarray.Array1.dim buf - off) / size
+      || dst_off > Bigarray.Array1.dim dst - len
+    then raise (Invalid_argument "index out of bounds")
+
+  (** [get_X_array buf off dst dst_off len] same as [unsafe_get_X_array] but with bounds checking. *)
+  let get_int16_array buf off dst dst_off len =
+    check_array buf off 2 dst dst_off len;
+    unsafe_get_int16_array buf off dst dst_off len
+
+  let get_int32_array buf off dst dst_off len =
+    check_array buf off 4 dst dst_off len;
+    unsafe_get_int32_array buf off dst dst_off len
+
+  let get_int64_array buf off dst dst_off len =
+    check_array buf off 8 dst dst_off len;
+    unsafe_get_int64_array buf off dst dst_off len
+
+  let get_float32_array buf off dst dst_off len =
+    check_array buf off 4 dst dst_off len;
+    unsafe_get_float32_array buf off dst dst_off len
+
+  let get_float64_array buf off dst dst_off len =
+    check_array buf off 8 dst dst_off len;
+    unsafe_get_float64_array buf off dst dst_off len
+
   (** [unsafe_set_X buf off v] stores the integer [v] as type [X] in a
       buffer [buf] starting at offset [off]. Bounds checking is not
       performed. Use with caution and only when the program logic
@@ -2740,12 +3835,16 @@ module LittleEndian = struct
   external unsafe_set_int8   : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_8" [@@noalloc]
   external unsafe_set_uint16 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_l16" [@@noalloc]
   external unsafe_set_int16  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_l16" [@@noalloc]
+  external unsafe_set_uint24 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_l24" [@@noalloc]
+  external unsafe_set_int24  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_l24" [@@noalloc]
   external unsafe_set_uint31 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_l31" [@@noalloc]
   external unsafe_set_int31  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_l31" [@@noalloc]
-  external unsafe_set_int32  : 'a carray8 -> int -> int32 -> unit = "caml_extunixba_set_l32" [@@noalloc]
+  external unsafe_set_int32  : 'a carray8 -> (int [@untagged]) -> (int32 [@unboxed]) -> unit = "caml_extunixba_set_l32" "caml_extunixba_set_l32_unboxed" [@@noalloc]
   external unsafe_set_uint63 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_l63" [@@noalloc]
   external unsafe_set_int63  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_l63" [@@noalloc]
-  external unsafe_set_int64  : 'a carray8 -> int -> int64 -> unit = "caml_extunixba_set_l64" [@@noalloc]
+  external unsafe_set_int64  : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed]) -> unit = "caml_extunixba_set_l64" "caml_extunixba_set_l64_unboxed" [@@noalloc]
+  external unsafe_set_float32 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunixba_set_lf32" "caml_extunixba_set_lf32_unboxed" [@@noalloc]
+  external unsafe_set_float64 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunixba_set_lf64" "caml_extunixba_set_lf64_unboxed" [@@noalloc]
 
   (** [set_X buf off v] same as [unsafe_set_X] but with bounds checking. *)
   let set_uint8 buf off v =
@@ -2768,6 +3867,16 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int16 buf off v
 
+  let set_uint24 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_uint24 buf off v
+
+  let set_int24 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_int24 buf off v
+
   let set_uint31 buf off v =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
@@ -2778,7 +3887,7 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int31 buf off v
 
-  let set_int32 buf off v =
+  let[@inline] set_int32 buf off v =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int32 buf off v
@@ -2793,11 +3902,21 @@ module LittleEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int63 buf off v
 
-  let set_int64 buf off v =
+  let[@inline] set_int64 buf off v =
     if off < 0 || off > Bigarray.Array1.dim buf - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int64 buf off v
 
+  let[@inline] set_float32 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float32 buf off v
+
+  let[@inline] set_float64 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float64 buf off v
+
 ]
 
 end (* module LittleEndian *)
@@ -2819,17 +3938,24 @@ module HostEndian = struct
       integers are 31bit signed there. No error is reported if this
       occurs. Use with care.
       Note: The same applies to 63bit functions.
+      Note: The float32 functions widen a single precision float.
+      Note: In native code the 32bit, 64bit and float functions take
+      and return unboxed values and do not allocate.
   *)
   external unsafe_get_uint8  : 'a carray8 -> int -> int = "caml_extunixba_get_u8" [@@noalloc]
   external unsafe_get_int8   : 'a carray8 -> int -> int = "caml_extunixba_get_s8" [@@noalloc]
   external unsafe_get_uint16 : 'a carray8 -> int -> int = "caml_extunixba_get_hu16" [@@noalloc]
   external unsafe_get_int16  : 'a carray8 -> int -> int = "caml_extunixba_get_hs16" [@@noalloc]
+  external unsafe_get_uint24 : 'a carray8 -> int -> int = "caml_extunixba_get_hu24" [@@noalloc]
+  external unsafe_get_int24  : 'a carray8 -> int -> int = "caml_extunixba_get_hs24" [@@noalloc]
   external unsafe_get_uint31 : 'a carray8 -> int -> int = "caml_extunixba_get_hu31" [@@noalloc]
   external unsafe_get_int31  : 'a carray8 -> int -> int = "caml_extunixba_get_hs31" [@@noalloc]
-  external unsafe_get_int32  : 'a carray8 -> int -> int32 = "caml_extunixba_get_hs32"
+  external unsafe_get_int32  : 'a carray8 -> (int [@untagged]) -> (int32 [@unboxed]) = "caml_extunixba_get_hs32" "caml_extunixba_get_hs32_unboxed" [@@noalloc]
   external unsafe_get_uint63 : 'a carray8 -> int -> int = "caml_extunixba_get_hu63" [@@noalloc]
   external unsafe_get_int63  : 'a carray8 -> int -> int = "caml_extunixba_get_hs63" [@@noalloc]
-  external unsafe_get_int64  : 'a carray8 -> int -> int64 = "caml_extunixba_get_hs64"
+  external unsafe_get_int64  : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed]) = "caml_extunixba_get_hs64" "caml_extunixba_get_hs64_unboxed" [@@noalloc]
+  external unsafe_get_float32 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunixba_get_hf32" "caml_extunixba_get_hf32_unboxed" [@@noalloc]
+  external unsafe_get_float64 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) = "caml_extunixba_get_hf64" "caml_extunixba_get_hf64_unboxed" [@@noalloc]
 
   (** [get_X buf off] same as [unsafe_get_X] but with bounds checking. *)
   let get_uint8 buf off =
@@ -2852,6 +3978,16 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int16 buf off
 
+  let get_uint24 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_uint24 buf off
+
+  let get_int24 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_int24 buf off
+
   let get_uint31 buf off =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
@@ -2862,7 +3998,7 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int31 buf off
 
-  let get_int32 buf off =
+  let[@inline] get_int32 buf off =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int32 buf off
@@ -2877,11 +4013,21 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int63 buf off
 
-  let get_int64 buf off =
+  let[@inline] get_int64 buf off =
     if off < 0 || off > Bigarray.Array1.dim buf - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_get_int64 buf off
 
+  let[@inline] get_float32 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float32 buf off
+
+  let[@inline] get_float64 buf off =
+    if off < 0 || off > Bigarray.Array1.dim buf - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_get_float64 buf off
+
   (** [unsafe_set_X buf off v] stores the integer [v] as type [X] in a
       buffer [buf] starting at offset [off]. Bounds checking is not
       performed. Use with caution and only when the program logic
@@ -2896,12 +4042,16 @@ module HostEndian = struct
   external unsafe_set_int8   : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_8" [@@noalloc]
   external unsafe_set_uint16 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_h16" [@@noalloc]
   external unsafe_set_int16  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_h16" [@@noalloc]
+  external unsafe_set_uint24 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_h24" [@@noalloc]
+  external unsafe_set_int24  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_h24" [@@noalloc]
   external unsafe_set_uint31 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_h31" [@@noalloc]
   external unsafe_set_int31  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_h31" [@@noalloc]
-  external unsafe_set_int32  : 'a carray8 -> int -> int32 -> unit = "caml_extunixba_set_h32" [@@noalloc]
+  external unsafe_set_int32  : 'a carray8 -> (int [@untagged]) -> (int32 [@unboxed]) -> unit = "caml_extunixba_set_h32" "caml_extunixba_set_h32_unboxed" [@@noalloc]
   external unsafe_set_uint63 : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_h63" [@@noalloc]
   external unsafe_set_int63  : 'a carray8 -> int -> int -> unit = "caml_extunixba_set_h63" [@@noalloc]
-  external unsafe_set_int64  : 'a carray8 -> int -> int64 -> unit = "caml_extunixba_set_h64" [@@noalloc]
+  external unsafe_set_int64  : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed]) -> unit = "caml_extunixba_set_h64" "caml_extunixba_set_h64_unboxed" [@@noalloc]
+  external unsafe_set_float32 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunixba_set_hf32" "caml_extunixba_set_hf32_unboxed" [@@noalloc]
+  external unsafe_set_float64 : 'a carray8 -> (int [@untagged]) -> (float [@unboxed]) -> unit = "caml_extunixba_set_hf64" "caml_extunixba_set_hf64_unboxed" [@@noalloc]
 
   (** [set_X buf off v] same as [unsafe_set_X] but with bounds checking. *)
   let set_uint8 buf off v =
@@ -2924,6 +4074,16 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int16 buf off v
 
+  let set_uint24 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_uint24 buf off v
+
+  let set_int24 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 3
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_int24 buf off v
+
   let set_uint31 buf off v =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
@@ -2934,7 +4094,7 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int31 buf off v
 
-  let set_int32 buf off v =
+  let[@inline] set_int32 buf off v =
     if off < 0 || off > Bigarray.Array1.dim buf - 4
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int32 buf off v
@@ -2949,11 +4109,21 @@ module HostEndian = struct
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int63 buf off v
 
-  let set_int64 buf off v =
+  let[@inline] set_int64 buf off v =
     if off < 0 || off > Bigarray.Array1.dim buf - 8
     then raise (Invalid_argument "index out of bounds");
     unsafe_set_int64 buf off v
 
+  let[@inline] set_float32 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 4
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float32 buf off v
+
+  let[@inline] set_float64 buf off v =
+    if off < 0 || off > Bigarray.Array1.dim buf - 8
+    then raise (Invalid_argument "index out of bounds");
+    unsafe_set_float64 buf off v
+
 end (* module HostEndian *)
 
 (** [unsafe_get_substr buf off len] extracts the substring from buffer
@@ -2982,6 +4152,147 @@ let set_substr buf off str =
   then raise (Invalid_argument "index out of bounds");
   unsafe_set_substr buf off str
 
+[%%have MEMSEARCH
+
+(** {2 Searching}
+
+    Functions over the slice of [len] bytes starting at offset [off]
+    of a buffer. Results are offsets in the buffer, or -1 when not
+    found, and nothing is allocated. *)
+
+(** Set of bytes for {!index_any_of_set}, see {!byte_set} *)
+type byte_set = { set : string } [@@unboxed]
+
+(** [byte_set chars] is the set of the characters in [chars] *)
+let byte_set chars =
+  let t = Bytes.make 32 '\000' in
+  String.iter (fun c ->
+    let b = Char.code c in
+    let i = (b lsr 7) * 16 + b land 15 in
+    Bytes.set t i (Char.unsafe_chr (Char.code (Bytes.get t i) lor (1 lsl ((b lsr 4) land 7))))) chars;
+  { set = Bytes.unsafe_to_string t }
+
+(** [unsafe_X buf off len ...] same as [X] without bounds checking *)
+external unsafe_index_byte : 'a carray8 -> int -> int -> char -> int = "caml_extunixba_index_byte" [@@noalloc]
+external unsafe_rindex_byte : 'a carray8 -> int -> int -> char -> int = "caml_extunixba_rindex_byte" [@@noalloc]
+external unsafe_index_sub : 'a carray8 -> int -> int -> string -> int = "caml_extunixba_index_sub" [@@noalloc]
+external unsafe_index_any_of_set : 'a carray8 -> int -> int -> byte_set -> int = "caml_extunixba_index_any_of_set" [@@noalloc]
+
+let check_search buf off len =
+  if off < 0 || len < 0 || off > Bigarray.Array1.dim buf - len
+  then raise (Invalid_argument "index out of bounds")
+
+(** [index_byte buf off len c] @return the offset of the first [c] in the slice *)
+let index_byte buf off len c =
+  check_search buf off len;
+  unsafe_index_byte buf off len c
+
+(** [rindex_byte buf off len c] @return the offset of the last [c] in the slice *)
+let rindex_byte buf off len c =
+  check_search buf off len;
+  unsafe_rindex_byte buf off len c
+
+(** [index_sub buf off len s] @return the offset of the first occurrence
+    of [s] contained in the slice (e.g. ["\r\n\r\n"]) *)
+let index_sub buf off len s =
+  check_search buf off len;
+  unsafe_index_sub buf off len s
+
+(** [index_any_of_set buf off len set] @return the offset of the first
+    byte of the slice that belongs to [set]. Uses SSSE3 or AVX2 when the
+    CPU supports them. *)
+let index_any_of_set buf off len set =
+  check_search buf off len;
+  unsafe_index_any_of_set buf off len set
+
+]
+
+[%%have ATOMIC
+
+(** Atomic operations on 32 and 64-bit cells in host endianness, which
+    can be shared between processes through a shared mapping.
+
+    Cells must be naturally aligned in memory. Values are OCaml ints:
+    32-bit cells are sign extended and 64-bit cells are truncated to
+    63 bits when read. [load] has acquire and [store] release semantics,
+    the read-modify-write operations are sequentially consistent. *)
+module Atomic = struct
+
+  external unsafe_misalign : 'a carray8 -> int = "caml_extunixba_atomic_misalign" [@@noalloc]
+
+  external unsafe_load_int32 : 'a carray8 -> int -> int = "caml_extunixba_atomic_load32" [@@noalloc]
+  external unsafe_store_int32 : 'a carray8 -> int -> int -> unit = "caml_extunixba_atomic_store32" [@@noalloc]
+  external unsafe_compare_and_swap_int32 : 'a carray8 -> int -> int -> int -> bool = "caml_extunixba_atomic_cas32" [@@noalloc]
+  external unsafe_fetch_add_int32 : 'a carray8 -> int -> int -> int = "caml_extunixba_atomic_fetch_add32" [@@noalloc]
+  external unsafe_fetch_or_int32 : 'a carray8 -> int -> int -> int = "caml_extunixba_atomic_fetch_or32" [@@noalloc]
+  external unsafe_exchange_int32 : 'a carray8 -> int -> int -> int = "caml_extunixba_atomic_exchange32" [@@noalloc]
+
+  external unsafe_load_int64 : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed])
+    = "caml_extunixba_atomic_load64" "caml_extunixba_atomic_load64_unboxed" [@@noalloc]
+  external unsafe_store_int64 : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed]) -> unit
+    = "caml_extunixba_atomic_store64" "caml_extunixba_atomic_store64_unboxed" [@@noalloc]
+  external unsafe_compare_and_swap_int64 : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed]) -> (int64 [@unboxed]) -> bool
+    = "caml_extunixba_atomic_cas64" "caml_extunixba_atomic_cas64_unboxed" [@@noalloc]
+  external unsafe_fetch_add_int64 : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed]) -> (int64 [@unboxed])
+    = "caml_extunixba_atomic_fetch_add64" "caml_extunixba_atomic_fetch_add64_unboxed" [@@noalloc]
+  external unsafe_fetch_or_int64 : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed]) -> (int64 [@unboxed])
+    = "caml_extunixba_atomic_fetch_or64" "caml_extunixba_atomic_fetch_or64_unboxed" [@@noalloc]
+  external unsafe_exchange_int64 : 'a carray8 -> (int [@untagged]) -> (int64 [@unboxed]) -> (int64 [@unboxed])
+    = "caml_extunixba_atomic_exchange64" "caml_extunixba_atomic_exchange64_unboxed" [@@noalloc]
+
+  let check buf off size =
+    if off < 0 || off > Bigarray.Array1.dim buf - size
+    then raise (Invalid_argument "index out of bounds");
+    if (unsafe_misalign buf + off) land (size - 1) <> 0
+    then raise (Invalid_argument "misaligned atomic access")
+
+  (** [load_int32 buf off] reads the 32-bit cell at [off] *)
+  let load_int32 buf off = check buf off 4; unsafe_load_int32 buf off
+
+  (** [store_int32 buf off v] writes [v] to the 32-bit cell at [off] *)
+  let store_int32 buf off v = check buf off 4; unsafe_store_int32 buf off v
+
+  (** [compare_and_swap_int32 buf off old v] sets the 32-bit cell at [off]
+      to [v] if it holds [old].
+      @return whether the cell was updated *)
+  let compare_and_swap_int32 buf off old v = check buf off 4; unsafe_compare_and_swap_int32 buf off old v
+
+  (** [fetch_add_int32 buf off n] adds [n] to the 32-bit cell at [off].
+      @return the previous value *)
+  let fetch_add_int32 buf off n = check buf off 4; unsafe_fetch_add_int32 buf off n
+
+  (** [fetch_or_int32 buf off n] sets the bits of [n] in the 32-bit cell
+      at [off].
+      @return the previous value *)
+  let fetch_or_int32 buf off n = check buf off 4; unsafe_fetch_or_int32 buf off n
+
+  (** [exchange_int32 buf off v] writes [v] to the 32-bit cell at [off].
+      @return the previous value *)
+  let exchange_int32 buf off v = check buf off 4; unsafe_exchange_int32 buf off v
+
+  (** Same as {!load_int32} for a 64-bit cell, with [int64] values
+      (unboxed in native code) *)
+  let[@inline] load_int64 buf off = check buf off 8; unsafe_load_int64 buf off
+
+  (** Same as {!store_int32} for a 64-bit cell *)
+  let[@inline] store_int64 buf off v = check buf off 8; unsafe_store_int64 buf off v
+
+  (** Same as {!compare_and_swap_int32} for a 64-bit cell *)
+  let[@inline] compare_and_swap_int64 buf off old v = check buf off 8; unsafe_compare_and_swap_int64 buf off old v
+
+  (** Same as {!fetch_add_int32} for a 64-bit cell *)
+  let[@inline] fetch_add_int64 buf off n = check buf off 8; unsafe_fetch_add_int64 buf off n
+
+  (** Same as {!fetch_or_int32} for a 64-bit cell *)
+  let[@inline] fetch_or_int64 buf off n = check buf off 8; unsafe_fetch_or_int64 buf off n
+
+  (** Same as {!exchange_int32} for a 64-bit cell *)
+  let[@inline] exchange_int64 buf off v = check buf off 8; unsafe_exchange_int64 buf off v
+
+end (* module Atomic *)
+
+]
+
 [%%have VMSPLICE
 
 (**
@@ -2990,13 +4301,6 @@ let set_substr buf off str =
   @author Pierre Chambart <pierre.chambart@ocamlpro.com>
 *)
 
-(** I/O vector. Used to send multiple data using a single system call *)
-type 'a iov = {
-  iov_buf : 'a carray8;
-  iov_off : int;
-  iov_len : int;
-}
-
 (** [vmsplice fd iovs flags] sends the data described by [iovs] to the pipe [fd]
     @return the number of bytes transferred to the pipe. *)
 external vmsplice : Unix.file_descr -> 'a iov array -> splice_flag list -> int = "caml_extunixba_vmsplice"
@@ -3004,6 +4308,1115 @@ external vmsplice : Unix.file_descr -> 'a iov array -> splice_flag list -> int =
 
 end (* module BA *)
 
+[%%have ENDIAN
+
+(** Sequential reads and writes over a bigarray slice.
+
+    A cursor keeps a position that every read and write advances. The
+    [read_X] and [write_X] functions check the remaining length each
+    time, the [unsafe_] ones do not: call {!ensure} once for a whole
+    fixed-size record and then use the [unsafe_] accessors.
+
+    Varints are LEB128 (protobuf style), signed ones zigzag encoded,
+    each decoded or encoded by a single C call. *)
+module Cursor = struct
+
+  type 'a t = {
+    buf : 'a carray8;
+    mutable pos : int;
+    limit : int;
+    start : int;
+  }
+
+  (** [create ?off ?len buf] is a cursor over [len] bytes of [buf]
+      starting at [off], by default the whole [buf] *)
+  let create ?(off=0) ?len buf =
+    let len = match len with Some len -> len | None -> Bigarray.Array1.dim buf - off in
+    if off < 0 || len < 0 || off > Bigarray.Array1.dim buf - len
+    then invalid_arg "ExtUnix.Cursor.create";
+    { buf; pos = off; limit = off + len; start = off }
+
+  let buffer t = t.buf
+
+  (** @return the current offset in the bigarray *)
+  let pos t = t.pos
+
+  (** @return the number of bytes between the position and the end of the slice *)
+  let remaining t = t.limit - t.pos
+
+  (** @return the number of bytes read or written since creation *)
+  let consumed t = t.pos - t.start
+
+  (** [seek t pos] moves to the bigarray offset [pos] *)
+  let seek t pos =
+    if pos < t.start || pos > t.limit
+    then raise (Invalid_argument "index out of bounds");
+    t.pos <- pos
+
+  (** [ensure t n] checks that at least [n] bytes remain *)
+  let[@inline] ensure t n =
+    if n < 0 || n > t.limit - t.pos
+    then raise (Invalid_argument "index out of bounds")
+
+  let skip t n = ensure t n; t.pos <- t.pos + n
+
+  let[@inline] unsafe_read_uint8 t = let p = t.pos in t.pos <- p + 1; BA.BigEndian.unsafe_get_uint8 t.buf p
+  let[@inline] unsafe_read_int8 t = let p = t.pos in t.pos <- p + 1; BA.BigEndian.unsafe_get_int8 t.buf p
+  let[@inline] unsafe_write_uint8 t v = let p = t.pos in t.pos <- p + 1; BA.BigEndian.unsafe_set_uint8 t.buf p v
+  let[@inline] unsafe_write_int8 t v = let p = t.pos in t.pos <- p + 1; BA.BigEndian.unsafe_set_int8 t.buf p v
+
+  let[@inline] read_uint8 t = ensure t 1; unsafe_read_uint8 t
+  let[@inline] read_int8 t = ensure t 1; unsafe_read_int8 t
+  let[@inline] write_uint8 t v = ensure t 1; unsafe_write_uint8 t v
+  let[@inline] write_int8 t v = ensure t 1; unsafe_write_int8 t v
+
+  (** Big endian (network byte order) fixed-size values *)
+  module BE = struct
+    let[@inline] unsafe_read_uint16 t = let p = t.pos in t.pos <- p + 2; BA.BigEndian.unsafe_get_uint16 t.buf p
+    let[@inline] unsafe_read_int16 t = let p = t.pos in t.pos <- p + 2; BA.BigEndian.unsafe_get_int16 t.buf p
+    let[@inline] unsafe_read_uint24 t = let p = t.pos in t.pos <- p + 3; BA.BigEndian.unsafe_get_uint24 t.buf p
+    let[@inline] unsafe_read_int24 t = let p = t.pos in t.pos <- p + 3; BA.BigEndian.unsafe_get_int24 t.buf p
+    let[@inline] unsafe_read_int32 t = let p = t.pos in t.pos <- p + 4; BA.BigEndian.unsafe_get_int32 t.buf p
+    let[@inline] unsafe_read_int64 t = let p = t.pos in t.pos <- p + 8; BA.BigEndian.unsafe_get_int64 t.buf p
+    let[@inline] unsafe_read_float32 t = let p = t.pos in t.pos <- p + 4; BA.BigEndian.unsafe_get_float32 t.buf p
+    let[@inline] unsafe_read_float64 t = let p = t.pos in t.pos <- p + 8; BA.BigEndian.unsafe_get_float64 t.buf p
+
+    let[@inline] unsafe_write_uint16 t v = let p = t.pos in t.pos <- p + 2; BA.BigEndian.unsafe_set_uint16 t.buf p v
+    let[@inline] unsafe_write_int16 t v = let p = t.pos in t.pos <- p + 2; BA.BigEndian.unsafe_set_int16 t.buf p v
+    let[@inline] unsafe_write_uint24 t v = let p = t.pos in t.pos <- p + 3; BA.BigEndian.unsafe_set_uint24 t.buf p v
+    let[@inline] unsafe_write_int24 t v = let p = t.pos in t.pos <- p + 3; BA.BigEndian.unsafe_set_int24 t.buf p v
+    let[@inline] unsafe_write_int32 t v = let p = t.pos in t.pos <- p + 4; BA.BigEndian.unsafe_set_int32 t.buf p v
+    let[@inline] unsafe_write_int64 t v = let p = t.pos in t.pos <- p + 8; BA.BigEndian.unsafe_set_int64 t.buf p v
+    let[@inline] unsafe_write_float32 t v = let p = t.pos in t.pos <- p + 4; BA.BigEndian.unsafe_set_float32 t.buf p v
+    let[@inline] unsafe_write_float64 t v = let p = t.pos in t.pos <- p + 8; BA.BigEndian.unsafe_set_float64 t.buf p v
+
+    let[@inline] read_uint16 t = ensure t 2; unsafe_read_uint16 t
+    let[@inline] read_int16 t = ensure t 2; unsafe_read_int16 t
+    let[@inline] read_uint24 t = ensure t 3; unsafe_read_uint24 t
+    let[@inline] read_int24 t = ensure t 3; unsafe_read_int24 t
+    let[@inline] read_int32 t = ensure t 4; unsafe_read_int32 t
+    let[@inline] read_int64 t = ensure t 8; unsafe_read_int64 t
+    let[@inline] read_float32 t = ensure t 4; unsafe_read_float32 t
+    let[@inline] read_float64 t = ensure t 8; unsafe_read_float64 t
+
+    let[@inline] write_uint16 t v = ensure t 2; unsafe_write_uint16 t v
+    let[@inline] write_int16 t v = ensure t 2; unsafe_write_int16 t v
+    let[@inline] write_uint24 t v = ensure t 3; unsafe_write_uint24 t v
+    let[@inline] write_int24 t v = ensure t 3; unsafe_write_int24 t v
+    let[@inline] write_int32 t v = ensure t 4; unsafe_write_int32 t v
+    let[@inline] write_int64 t v = ensure t 8; unsafe_write_int64 t v
+    let[@inline] write_float32 t v = ensure t 4; unsafe_write_float32 t v
+    let[@inline] write_float64 t v = ensure t 8; unsafe_write_float64 t v
+  end (* module BE *)
+
+  (** Little endian fixed-size values *)
+  module LE = struct
+    let[@inline] unsafe_read_uint16 t = let p = t.pos in t.pos <- p + 2; BA.LittleEndian.unsafe_get_uint16 t.buf p
+    let[@inline] unsafe_read_int16 t = let p = t.pos in t.pos <- p + 2; BA.LittleEndian.unsafe_get_int16 t.buf p
+    let[@inline] unsafe_read_uint24 t = let p = t.pos in t.pos <- p + 3; BA.LittleEndian.unsafe_get_uint24 t.buf p
+    let[@inline] unsafe_read_int24 t = let p = t.pos in t.pos <- p + 3; BA.LittleEndian.unsafe_get_int24 t.buf p
+    let[@inline] unsafe_read_int32 t = let p = t.pos in t.pos <- p + 4; BA.LittleEndian.unsafe_get_int32 t.buf p
+    let[@inline] unsafe_read_int64 t = let p = t.pos in t.pos <- p + 8; BA.LittleEndian.unsafe_get_int64 t.buf p
+    let[@inline] unsafe_read_float32 t = let p = t.pos in t.pos <- p + 4; BA.LittleEndian.unsafe_get_float32 t.buf p
+    let[@inline] unsafe_read_float64 t = let p = t.pos in t.pos <- p + 8; BA.LittleEndian.unsafe_get_float64 t.buf p
+
+    let[@inline] unsafe_write_uint16 t v = let p = t.pos in t.pos <- p + 2; BA.LittleEndian.unsafe_set_uint16 t.buf p v
+    let[@inline] unsafe_write_int16 t v = let p = t.pos in t.pos <- p + 2; BA.LittleEndian.unsafe_set_int16 t.buf p v
+    let[@inline] unsafe_write_uint24 t v = let p = t.pos in t.pos <- p + 3; BA.LittleEndian.unsafe_set_uint24 t.buf p v
+    let[@inline] unsafe_write_int24 t v = let p = t.pos in t.pos <- p + 3; BA.LittleEndian.unsafe_set_int24 t.buf p v
+    let[@inline] unsafe_write_int32 t v = let p = t.pos in t.pos <- p + 4; BA.LittleEndian.unsafe_set_int32 t.buf p v
+    let[@inline] unsafe_write_int64 t v = let p = t.pos in t.pos <- p + 8; BA.LittleEndian.unsafe_set_int64 t.buf p v
+    let[@inline] unsafe_write_float32 t v = let p = t.pos in t.pos <- p + 4; BA.LittleEndian.unsafe_set_float32 t.buf p v
+    let[@inline] unsafe_write_float64 t v = let p = t.pos in t.pos <- p + 8; BA.LittleEndian.unsafe_set_float64 t.buf p v
+
+    let[@inline] read_uint16 t = ensure t 2; unsafe_read_uint16 t
+    let[@inline] read_int16 t = ensure t 2; unsafe_read_int16 t
+    let[@inline] read_uint24 t = ensure t 3; unsafe_read_uint24 t
+    let[@inline] read_int24 t = ensure t 3; unsafe_read_int24 t
+    let[@inline] read_int32 t = ensure t 4; unsafe_read_int32 t
+    let[@inline] read_int64 t = ensure t 8; unsafe_read_int64 t
+    let[@inline] read_float32 t = ensure t 4; unsafe_read_float32 t
+    let[@inline] read_float64 t = ensure t 8; unsafe_read_float64 t
+
+    let[@inline] write_uint16 t v = ensure t 2; unsafe_write_uint16 t v
+    let[@inline] write_int16 t v = ensure t 2; unsafe_write_int16 t v
+    let[@inline] write_uint24 t v = ensure t 3; unsafe_write_uint24 t v
+    let[@inline] write_int24 t v = ensure t 3; unsafe_write_int24 t v
+    let[@inline] write_int32 t v = ensure t 4; unsafe_write_int32 t v
+    let[@inline] write_int64 t v = ensure t 8; unsafe_write_int64 t v
+    let[@inline] write_float32 t v = ensure t 4; unsafe_write_float32 t v
+    let[@inline] write_float64 t v = ensure t 8; unsafe_write_float64 t v
+  end (* module LE *)
+
+  (** [read_string t len] copies the next [len] bytes *)
+  let read_string t len =
+    ensure t len;
+    let s = BA.unsafe_get_substr t.buf t.pos len in
+    t.pos <- t.pos + len;
+    s
+
+  let write_string t s =
+    ensure t (String.length s);
+    BA.unsafe_set_substr t.buf t.pos s;
+    t.pos <- t.pos + String.length s
+
+  (** [read_uvarint t] decodes an unsigned LEB128 varint.
+      @raise Invalid_argument if the slice ends in the middle of it
+      @raise Failure if it does not fit an OCaml int *)
+  external read_uvarint : 'a t -> int = "caml_extunix_cursor_read_uvarint"
+
+  (** zigzag encoded signed varint *)
+  external read_varint : 'a t -> int = "caml_extunix_cursor_read_varint"
+  external read_uvarint64 : 'a t -> (int64 [@unboxed]) = "caml_extunix_cursor_read_uvarint64" "caml_extunix_cursor_read_uvarint64_unboxed"
+  external read_varint64 : 'a t -> (int64 [@unboxed]) = "caml_extunix_cursor_read_varint64" "caml_extunix_cursor_read_varint64_unboxed"
+
+  (** [write_uvarint t n] encodes the non-negative [n], nothing is
+      written if it does not fit in the remaining space *)
+  external write_uvarint : 'a t -> int -> unit = "caml_extunix_cursor_write_uvarint"
+  external write_varint : 'a t -> int -> unit = "caml_extunix_cursor_write_varint"
+
+  (** the int64 is taken as unsigned *)
+  external write_uvarint64 : 'a t -> (int64 [@unboxed]) -> unit = "caml_extunix_cursor_write_uvarint64" "caml_extunix_cursor_write_uvarint64_unboxed"
+  external write_varint64 : 'a t -> (int64 [@unboxed]) -> unit = "caml_extunix_cursor_write_varint64" "caml_extunix_cursor_write_varint64_unboxed"
+
+  external read_prefixed_offset : 'a t -> int = "caml_extunix_cursor_read_prefixed"
+
+  (** [read_prefixed t] skips a slice prefixed with its length as a
+      uvarint (protobuf length-delimited field)
+      @return the slice, sharing memory with the buffer *)
+  let read_prefixed t =
+    let off = read_prefixed_offset t in
+    Bigarray.Array1.sub t.buf off (t.pos - off)
+
+  (** [read_prefixed_cursor t] same as [read_prefixed] but returns a
+      cursor over the slice, without allocating a sub-bigarray *)
+  let read_prefixed_cursor t =
+    let off = read_prefixed_offset t in
+    { buf = t.buf; pos = off; limit = t.pos; start = off }
+
+  let read_prefixed_string t =
+    let off = read_prefixed_offset t in
+    BA.unsafe_get_substr t.buf off (t.pos - off)
+
+  (** [write_prefixed_string t s] writes the length of [s] as a uvarint followed by [s] *)
+  let write_prefixed_string t s =
+    let pos = t.pos in
+    write_uvarint t (String.length s);
+    if String.length s > t.limit - t.pos then (t.pos <- pos; raise (Invalid_argument "index out of bounds"));
+    write_string t s
+
+end (* module Cursor *)
+]
+
+[%%have MMSG
+
+(** {2 Batched datagram I/O}
+
+    [recvmmsg] and [sendmmsg] transfer many datagrams in one system call.
+    Datagram [i] of a slab lives in slot [i], a fixed size region of one
+    bigarray, its length and (optionally) its peer address are kept in
+    preallocated arrays, so that receiving a batch allocates nothing on
+    the OCaml heap. *)
+module Mmsg = struct
+
+  type 'a t = {
+    buf : 'a carray8; (** slot [i] starts at offset [i * slot] *)
+    slot : int; (** size of a slot, longer datagrams are truncated *)
+    lens : int array; (** datagram lengths, one per slot *)
+    addrs : Bigarray.int8_unsigned_elt carray8; (** raw socket addresses, empty if not kept *)
+    addr_lens : int array; (** address lengths, 0 for none *)
+    truncated : bool array; (** whether the received datagram did not fit the slot ([MSG_TRUNC]) *)
+  }
+
+  external sockaddr_size : unit -> int = "caml_extunix_mmsg_sockaddr_size" [@@noalloc]
+
+  (** [of_carray8 ?addrs ~slot buf] splits [buf] into as many slots of
+      [slot] bytes as fit. Room for peer addresses is reserved unless
+      [addrs] is [false] (default [true]). *)
+  let of_carray8 ?(addrs=true) ~slot buf =
+    if slot <= 0 then invalid_arg "ExtUnix.Mmsg.of_carray8";
+    let count = Bigarray.Array1.dim buf / slot in
+    let addrs = Bigarray.(Array1.create int8_unsigned c_layout (if addrs then count * sockaddr_size () else 0)) in
+    { buf; slot; lens = Array.make count 0; addrs; addr_lens = Array.make count 0;
+      truncated = Array.make count false }
+
+  (** [create ?addrs ~slot count] allocates a slab of [count] slots of [slot] bytes *)
+  let create ?addrs ~slot count =
+    if slot <= 0 || count < 0 then invalid_arg "ExtUnix.Mmsg.create";
+    of_carray8 ?addrs ~slot (Bigarray.(Array1.create int8_unsigned c_layout (slot * count)))
+
+  (** @return the number of slots *)
+  let count t = Array.length t.lens
+
+  (** @return the offset of slot [i] in the bigarray *)
+  let offset t i =
+    if i < 0 || i >= count t then invalid_arg "ExtUnix.Mmsg.offset";
+    i * t.slot
+
+  let length t i = t.lens.(i)
+
+  (** [truncated t i] tells whether the datagram received into slot [i]
+      was longer than the slot, in which case only [slot] bytes of it
+      were kept and [length t i = t.slot] *)
+  let truncated t i = t.truncated.(i)
+
+  (** [set_length t i len] sets the length of the datagram to send from slot [i] *)
+  let set_length t i len =
+    if len < 0 || len > t.slot then invalid_arg "ExtUnix.Mmsg.set_length";
+    t.lens.(i) <- len
+
+  (** @return the datagram of slot [i] as an iov, without copy *)
+  let iov t i = { iov_buf = t.buf; iov_off = offset t i; iov_len = t.lens.(i) }
+
+  (** [addr t i] decodes the peer address of slot [i] (allocates) *)
+  external addr : 'a t -> int -> Unix.sockaddr = "caml_extunix_mmsg_addr"
+
+  (** [set_addr t i addr] sets the destination of the datagram of slot [i] *)
+  external set_addr : 'a t -> int -> Unix.sockaddr -> unit = "caml_extunix_mmsg_set_addr"
+
+  (** [clear_addr t i] sends the datagram of slot [i] to the connected peer *)
+  let clear_addr t i = t.addr_lens.(i) <- 0
+
+  external mmsg_recv : Unix.file_descr -> 'a t -> int -> int -> Unix.msg_flag list -> bool -> float option -> int
+    = "caml_extunix_mmsg_recv_bytecode" "caml_extunix_mmsg_recv"
+  external mmsg_send : Unix.file_descr -> 'a t -> int -> int -> Unix.msg_flag list -> int = "caml_extunix_mmsg_send"
+
+  let check_slots name t off len =
+    let len = match len with Some len -> len | None -> count t - off in
+    if off < 0 || len < 0 || off > count t - len then invalid_arg name;
+    len
+
+  (** [recv ?off ?len ?flags ?waitforone ?timeout fd t] receives up to
+      [len] datagrams (default all the slots from [off], default 0) with
+      [recvmmsg], storing their lengths and peer addresses. Datagrams
+      longer than the slot size are truncated and flagged, see
+      {!truncated}.
+      With [waitforone] ([MSG_WAITFORONE]) the call returns as soon as
+      one datagram was received. Note that Linux only checks [timeout]
+      (in seconds) after each datagram, it does not bound the wait for
+      the first one.
+      @return the number of datagrams received *)
+  let recv ?(off=0) ?len ?(flags=[]) ?(waitforone=false) ?timeout fd t =
+    let len = check_slots "ExtUnix.Mmsg.recv" t off len in
+    mmsg_recv fd t off len flags waitforone timeout
+
+  (** [send ?off ?len ?flags fd t] sends the datagrams of [len] slots
+      starting at [off] with [sendmmsg], each to its address if set.
+      @return the number of datagrams sent *)
+  let send ?(off=0) ?len ?(flags=[]) fd t =
+    let len = check_slots "ExtUnix.Mmsg.send" t off len in
+    mmsg_send fd t off len flags
+
+end (* module Mmsg *)
+]
+
+[%%have ZEROCOPY
+
+(** {2 Zero-copy transmission}
+
+    Buffer lifetime tracking for {!BA.send_zerocopy}. Every successful
+    zero-copy send is numbered and the kernel reports, on the error queue
+    of the socket, ranges of sends whose buffers it no longer references.
+    The tracker keeps a user value (typically the buffer) per send and
+    hands it back once the kernel released it. Pending completions are
+    signalled by [POLLERR] on the socket. *)
+module Zerocopy = struct
+
+  type 'a t = {
+    fd : Unix.file_descr;
+    mutable next : int; (* number of the next send, 32 bit counter *)
+    pending : (int, 'a) Hashtbl.t; (* values of the sends not completed yet *)
+    mutable copied : bool;
+    res : int array; (* (first, last, copied) triples *)
+  }
+
+  external zerocopy_reap : Unix.file_descr -> int array -> int = "caml_extunix_zerocopy_reap"
+
+  let id_mask = if Sys.int_size > 32 then (1 lsl 32) - 1 else max_int
+
+  (** [create ?batch fd] enables [SO_ZEROCOPY] on [fd] and returns a
+      tracker collecting up to [batch] (default 64) completion ranges per
+      system call *)
+  let create ?(batch=64) fd =
+    if batch <= 0 then invalid_arg "ExtUnix.Zerocopy.create";
+    setsockopt fd SO_ZEROCOPY true;
+    { fd; next = 0; pending = Hashtbl.create 16; copied = false; res = Array.make (3 * batch) 0 }
+
+  (** [send ?flags t iovs v] sends [iovs] with {!BA.send_zerocopy} and
+      keeps [v] until the kernel released the buffers.
+      @return the number of bytes sent *)
+  let send ?(flags=[]) t iovs v =
+    let n = BA.send_zerocopy t.fd iovs flags in
+    Hashtbl.replace t.pending t.next v;
+    t.next <- (t.next + 1) land id_mask;
+    n
+
+  (** [reap t f] collects the completions reported so far, without
+      blocking, and calls [f v] for the value of every completed send.
+      Other entries of the error queue are discarded.
+      @return the number of completed sends *)
+  let reap t f =
+    let released = ref 0 in
+    let rec range id last =
+      begin match Hashtbl.find_opt t.pending id with
+      | Some v -> Hashtbl.remove t.pending id; incr released; f v
+      | None -> ()
+      end;
+      if id <> last then range ((id + 1) land id_mask) last
+    in
+    let rec loop () =
+      let n = zerocopy_reap t.fd t.res in
+      for i = 0 to n - 1 do
+        if t.res.(3 * i + 2) <> 0 then t.copied <- true;
+        range t.res.(3 * i) t.res.(3 * i + 1)
+      done;
+      if n = Array.length t.res / 3 then loop ()
+    in
+    loop ();
+    !released
+
+  (** @return the number of sends whose buffers are still referenced *)
+  let pending t = Hashtbl.length t.pending
+
+  (** @return [true] if the kernel copied the data of a completed send
+      anyway (e.g. over loopback), in which case plain sends are cheaper *)
+  let copied t = t.copied
+
+end (* module Zerocopy *)
+]
+
+[%%have URING
+
+(** {2 io_uring}
+
+    Asynchronous I/O engine built directly on the [io_uring_setup] and
+    [io_uring_enter] system calls (liburing is not required).
+
+    Operations are queued with the [prep_*] functions, handed to the
+    kernel in batches with {!Uring.submit} and their completions are
+    collected with {!Uring.reap} into a preallocated array. Every
+    operation is tagged with a user supplied [id]. Buffers referenced by
+    an operation are kept alive by the ring until its completion is
+    reaped. *)
+module Uring = struct
+
+type ring
+
+(** buffer referenced by an in-flight operation *)
+type buf = No_buf | Buf : 'a carray8 -> buf | Bufs : 'a iov array -> buf
+
+type buf_ring
+
+(** Provided buffer ring, see {!setup_buf_ring} *)
+type buf_group = {
+  pbuf : buf_ring;
+  gid : int; (** buffer group id *)
+  slab : buf;
+  buf_size : int; (** size of every buffer *)
+  count : int; (** number of buffers *)
+}
+
+type t = {
+  ring : ring;
+  ids : int array; (** slot -> user id *)
+  bufs : buf array; (** slot -> buffer kept alive until reaped *)
+  free : int array; (** stack of free slots *)
+  mutable nfree : int;
+  mutable registered : buf array;
+  mutable groups : buf_group list;
+}
+
+(** Subset of the [statx] structure filled by {!prep_statx} *)
+type statx = {
+  stx_mask : int;
+  stx_mode : int;
+  stx_nlink : int;
+  stx_uid : int;
+  stx_gid : int;
+  stx_ino : int64;
+  stx_size : int64;
+  stx_blocks : int64;
+  stx_mtime : float;
+}
+
+external uring_create : int -> ring = "caml_extunix_uring_create"
+external uring_close : ring -> unit = "caml_extunix_uring_close"
+external uring_cq_entries : ring -> int = "caml_extunix_uring_cq_entries"
+external uring_prep_rw : ring -> int -> bool -> Unix.file_descr -> 'a iov -> int -> int -> bool
+  = "caml_extunix_uring_prep_rw_bytecode" "caml_extunix_uring_prep_rw"
+external uring_prep_fsync : ring -> int -> Unix.file_descr -> bool -> bool = "caml_extunix_uring_prep_fsync"
+external uring_prep_fallocate : ring -> int -> Unix.file_descr -> int -> int -> bool = "caml_extunix_uring_prep_fallocate"
+external uring_prep_cancel : ring -> int -> bool = "caml_extunix_uring_prep_cancel"
+external uring_prep_openat : ring -> int -> Unix.file_descr option -> string -> open_flag list -> int -> bool
+  = "caml_extunix_uring_prep_openat_bytecode" "caml_extunix_uring_prep_openat"
+external uring_prep_statx : ring -> int -> Unix.file_descr option -> string -> bool -> 'a carray8 -> bool
+  = "caml_extunix_uring_prep_statx_bytecode" "caml_extunix_uring_prep_statx"
+external uring_submit : ring -> int -> int = "caml_extunix_uring_submit"
+external uring_reap : ring -> int array -> int = "caml_extunix_uring_reap"
+external uring_register_buffers : ring -> 'a iov array -> unit = "caml_extunix_uring_register_buffers"
+external uring_unregister_buffers : ring -> unit = "caml_extunix_uring_unregister_buffers"
+
+(** [error_of_result res] converts the negative result of a failed
+    operation into the corresponding [Unix.error] *)
+external error_of_result : int -> Unix.error = "caml_extunix_uring_error_of_result"
+
+(** [statx_of_buffer buf] decodes the [statx] structure stored in [buf]
+    by a completed {!prep_statx} operation *)
+external statx_of_buffer : 'a carray8 -> statx = "caml_extunix_uring_statx_of_buffer"
+
+(** size in bytes of the buffer required by {!prep_statx} *)
+let statx_size = 256
+
+(** [create entries] sets up a new ring with room for at least
+    [entries] submissions. The number of operations in flight is
+    bounded by the size of the completion queue. *)
+let create entries =
+  let ring = uring_create entries in
+  let n = uring_cq_entries ring in
+  { ring; ids = Array.make n 0; bufs = Array.make n No_buf;
+    free = Array.init n (fun i -> n - 1 - i); nfree = n; registered = [||]; groups = [] }
+
+(** @return the number of operations submitted (or queued) and not reaped yet *)
+let in_flight t = Array.length t.free - t.nfree
+
+let prep t id buf ok =
+  if ok then begin
+    let slot = t.free.(t.nfree - 1) in
+    t.nfree <- t.nfree - 1;
+    t.ids.(slot) <- id;
+    t.bufs.(slot) <- buf
+  end;
+  ok
+
+let slot t = if t.nfree = 0 then -1 else t.free.(t.nfree - 1)
+
+(* All [prep_*] functions queue an operation tagged with [id] and
+   return [false] (without queueing anything) when the submission queue
+   or the completion slots are exhausted, in which case the caller
+   should [submit] and [reap] first. *)
+
+(** [prep_read t ~id fd iov off] queues a read of [iov.iov_len] bytes
+    from [fd] at offset [off] into [iov] *)
+let prep_read t ~id fd iov off =
+  if off < 0 then invalid_arg "ExtUnix.Uring.prep_read";
+  let s = slot t in
+  s >= 0 && prep t id (Buf iov.iov_buf) (uring_prep_rw t.ring s false fd iov off (-1))
+
+(** [prep_write t ~id fd iov off] queues a write of [iov] to [fd] at
+    offset [off] *)
+let prep_write t ~id fd iov off =
+  if off < 0 then invalid_arg "ExtUnix.Uring.prep_write";
+  let s = slot t in
+  s >= 0 && prep t id (Buf iov.iov_buf) (uring_prep_rw t.ring s true fd iov off (-1))
+
+(** [prep_read_fixed t ~id fd iov off ~index] same as {!prep_read} but
+    [iov] must lie within the registered buffer number [index] *)
+let prep_read_fixed t ~id fd iov off ~index =
+  if off < 0 || index < 0 || index >= Array.length t.registered then invalid_arg "ExtUnix.Uring.prep_read_fixed";
+  let s = slot t in
+  s >= 0 && prep t id (Buf iov.iov_buf) (uring_prep_rw t.ring s false fd iov off index)
+
+(** [prep_write_fixed t ~id fd iov off ~index] same as {!prep_write} but
+    [iov] must lie within the registered buffer number [index] *)
+let prep_write_fixed t ~id fd iov off ~index =
+  if off < 0 || index < 0 || index >= Array.length t.registered then invalid_arg "ExtUnix.Uring.prep_write_fixed";
+  let s = slot t in
+  s >= 0 && prep t id (Buf iov.iov_buf) (uring_prep_rw t.ring s true fd iov off index)
+
+(** [prep_fsync t ~id ?datasync fd] queues [fsync] (or [fdatasync] if
+    [datasync] is [true], default [false]) of [fd] *)
+let prep_fsync t ~id ?(datasync=false) fd =
+  let s = slot t in
+  s >= 0 && prep t id No_buf (uring_prep_fsync t.ring s fd datasync)
+
+(** [prep_fallocate t ~id fd off len] queues allocation of the disk
+    space for the range of [len] bytes starting at [off] *)
+let prep_fallocate t ~id fd off len =
+  if off < 0 || len <= 0 then invalid_arg "ExtUnix.Uring.prep_fallocate";
+  let s = slot t in
+  s >= 0 && prep t id No_buf (uring_prep_fallocate t.ring s fd off len)
+
+(** [prep_openat t ~id ?dirfd path flags perm] queues opening of [path]
+    (relative to [dirfd], or the current directory if omitted). The
+    result of the completion is the new file descriptor, which is
+    always opened with [O_CLOEXEC] *)
+let prep_openat t ~id ?dirfd path flags perm =
+  let s = slot t in
+  s >= 0 && prep t id No_buf (uring_prep_openat t.ring s dirfd path flags perm)
+
+(** [prep_statx t ~id ?dirfd ?nofollow path buf] queues [statx] of
+    [path], the result is stored into [buf] (of at least {!statx_size}
+    bytes) and can be decoded with {!statx_of_buffer} *)
+let prep_statx t ~id ?dirfd ?(nofollow=false) path buf =
+  let s = slot t in
+  s >= 0 && prep t id (Buf buf) (uring_prep_statx t.ring s dirfd path nofollow buf)
+
+(** [submit t] hands all queued operations to the kernel without
+    waiting.
+    @return the number of operations submitted *)
+let submit t = uring_submit t.ring 0
+
+(** [submit_and_wait t n] hands all queued operations to the kernel and
+    waits until at least [n] completions are available, releasing the
+    runtime lock while waiting.
+    @return the number of operations submitted *)
+let submit_and_wait t n =
+  if n < 0 then invalid_arg "ExtUnix.Uring.submit_and_wait";
+  uring_submit t.ring n
+
+(** [reap t results] collects available completions without blocking.
+    Completion [i] is stored as the triple [results.(3*i)] (operation
+    [id]), [results.(3*i+1)] (result, negative errno on failure, see
+    {!error_of_result}) and [results.(3*i+2)] (completion flags, see
+    {!has_more} and {!buffer_id}). The operation stays in flight as
+    long as its completions have {!has_more} set.
+    @return the number of completions stored, at most
+    [Array.length results / 3] *)
+let reap t results =
+  let n = uring_reap t.ring results in
+  for i = 0 to n - 1 do
+    let slot = results.(3*i) in
+    results.(3*i) <- t.ids.(slot);
+    if results.(3*i+2) land 2 = 0 then begin
+      t.bufs.(slot) <- No_buf;
+      t.free.(t.nfree) <- slot;
+      t.nfree <- t.nfree + 1
+    end
+  done;
+  n
+
+let rec retry_eintr f x =
+  try f x with Unix.Unix_error (Unix.EINTR, _, _) -> retry_eintr f x
+
+(* Cancels every operation in flight and waits until all of them are
+   reaped, so that the kernel no longer writes into their buffers.
+   Operations that can not be cancelled run to completion. *)
+let cancel_all t =
+  let n = Array.length t.free in
+  let busy = Array.make n true in
+  for i = 0 to t.nfree - 1 do busy.(t.free.(i)) <- false done;
+  Array.iteri (fun slot busy ->
+    if busy then
+      while not (uring_prep_cancel t.ring slot) do
+        ignore (retry_eintr (uring_submit t.ring) 0)
+      done) busy;
+  let results = Array.make (3 * n) 0 in
+  while in_flight t > 0 do
+    ignore (retry_eintr (uring_submit t.ring) 1);
+    ignore (reap t results)
+  done
+
+(** [close t] cancels the operations still in flight, waits for them to
+    complete (releasing the runtime lock while waiting) and releases the
+    ring. Their completions are discarded. Buffers used by operations,
+    registered with {!register_buffers} or provided with
+    {!setup_buf_ring} are not referenced by the kernel anymore once
+    [close] returns. *)
+let close t =
+  if in_flight t > 0 then cancel_all t;
+  uring_close t.ring;
+  Array.fill t.bufs 0 (Array.length t.bufs) No_buf;
+  t.registered <- [||];
+  t.groups <- []
+
+(** [has_more flags] tests whether more completions will follow for the
+    same (multishot) operation (IORING_CQE_F_MORE) *)
+let has_more flags = flags land 2 <> 0
+
+(** [has_buffer flags] tests whether the completion carries a provided
+    buffer (IORING_CQE_F_BUFFER) *)
+let has_buffer flags = flags land 1 <> 0
+
+(** [buffer_id flags] extracts the id of the provided buffer holding
+    the received data, valid only when [has_buffer flags] *)
+let buffer_id flags = flags lsr 16
+
+(** [register_buffers t iovs] registers the buffer slices [iovs] with
+    the kernel, so that {!prep_read_fixed} and {!prep_write_fixed} do
+    not need to pin the pages for every operation. Buffers allocated
+    with {!memalign} are a good fit. Slice [i] is referred to by
+    [~index:i]. *)
+let register_buffers t iovs =
+  uring_register_buffers t.ring iovs;
+  t.registered <- Array.map (fun iov -> Buf iov.iov_buf) iovs
+
+(** [unregister_buffers t] drops the buffers registered with
+    {!register_buffers} *)
+let unregister_buffers t =
+  uring_unregister_buffers t.ring;
+  t.registered <- [||]
+
+[%%have URING_NET
+
+external uring_register_buf_ring : ring -> int -> 'a carray8 -> int -> buf_ring = "caml_extunix_uring_register_buf_ring"
+external uring_unregister_buf_ring : ring -> int -> unit = "caml_extunix_uring_unregister_buf_ring"
+external uring_buf_ring_entries : buf_ring -> int = "caml_extunix_uring_buf_ring_entries"
+external uring_recycle : buf_ring -> int -> unit = "caml_extunix_uring_recycle" [@@noalloc]
+external uring_prep_accept_multishot : ring -> int -> Unix.file_descr -> bool = "caml_extunix_uring_prep_accept_multishot"
+external uring_prep_recv_multishot : ring -> int -> Unix.file_descr -> int -> bool = "caml_extunix_uring_prep_recv_multishot"
+external uring_prep_send : ring -> int -> Unix.file_descr -> 'a iov -> float option -> bool = "caml_extunix_uring_prep_send"
+external uring_prep_sendmsg : ring -> int -> Unix.file_descr -> 'a iov array -> float option -> bool = "caml_extunix_uring_prep_sendmsg"
+
+(** [setup_buf_ring t ~gid slab ~buf_size] carves [slab] into buffers
+    of [buf_size] bytes and registers them as provided buffer group
+    [gid] (IORING_REGISTER_PBUF_RING). The number of buffers is
+    rounded down to a power of 2 (at most 32768). Buffer [bid] starts at
+    offset [bid * buf_size] in [slab]. All buffers are initially
+    available to the kernel. *)
+let setup_buf_ring t ~gid slab ~buf_size =
+  let pbuf = uring_register_buf_ring t.ring gid slab buf_size in
+  let g = { pbuf; gid; slab = Buf slab; buf_size; count = uring_buf_ring_entries pbuf } in
+  t.groups <- g :: t.groups;
+  g
+
+(** [unregister_buf_ring t g] removes the provided buffer group [g] *)
+let unregister_buf_ring t g =
+  uring_unregister_buf_ring t.ring g.gid;
+  t.groups <- List.filter (fun g' -> g' != g) t.groups
+
+(** [recycle g bid] hands the buffer [bid] back to the kernel once the
+    data received into it has been consumed *)
+let recycle g bid =
+  if bid < 0 || bid >= g.count then invalid_arg "ExtUnix.Uring.recycle";
+  uring_recycle g.pbuf bid
+
+(** [buffer_offset g bid] is the offset of buffer [bid] in the slab *)
+let buffer_offset g bid = bid * g.buf_size
+
+(** [prep_accept_multishot t ~id fd] queues a multishot accept on the
+    listening socket [fd]: every accepted connection produces a
+    completion with the new file descriptor (opened with
+    [SOCK_CLOEXEC]) as result *)
+let prep_accept_multishot t ~id fd =
+  let s = slot t in
+  s >= 0 && prep t id No_buf (uring_prep_accept_multishot t.ring s fd)
+
+(** [prep_recv_multishot t ~id fd g] queues a multishot receive on [fd]:
+    every chunk of data is stored into a buffer taken from group [g] and
+    produces a completion with the length as result and the buffer id
+    in the flags (see {!buffer_id}). The operation stops with [ENOBUFS]
+    when the group runs out of buffers. *)
+let prep_recv_multishot t ~id fd g =
+  let s = slot t in
+  s >= 0 && prep t id g.slab (uring_prep_recv_multishot t.ring s fd g.gid)
+
+(** [prep_send t ~id ?timeout fd iov] queues sending of [iov] on the
+    connected socket [fd]. If [timeout] (in seconds) is given the
+    operation is cancelled ([ECANCELED]) unless it completes in time. *)
+let prep_send t ~id ?timeout fd iov =
+  let s = slot t in
+  s >= 0 && prep t id (Buf iov.iov_buf) (uring_prep_send t.ring s fd iov timeout)
+
+(** [prep_sendmsg t ~id ?timeout fd iovs] same as {!prep_send} but
+    gathers the data from the buffer slices [iovs] *)
+let prep_sendmsg t ~id ?timeout fd iovs =
+  let s = slot t in
+  s >= 0 && prep t id (Bufs iovs) (uring_prep_sendmsg t.ring s fd iovs timeout)
+]
+
+end (* module Uring *)
+]
+
+[%%have AIO
+
+(** {2 Linux native AIO}
+
+    Asynchronous [O_DIRECT] I/O through the [io_setup], [io_submit] and
+    [io_getevents] system calls (libaio is not required), for systems
+    where io_uring is not available.
+
+    Requests are queued with {!Aio.prep_pread} and {!Aio.prep_pwrite},
+    submitted in batches with {!Aio.submit} and reaped with
+    {!Aio.reap}. Buffers referenced by a request are kept alive until
+    its completion is reaped. *)
+module Aio = struct
+
+type ctx
+
+type buf = No_buf | Buf : 'a carray8 -> buf
+
+type t = {
+  ctx : ctx;
+  ids : int array; (** slot -> user id *)
+  bufs : buf array; (** slot -> buffer kept alive until reaped *)
+  free : int array; (** stack of free slots *)
+  mutable nfree : int;
+}
+
+external aio_create : int -> ctx = "caml_extunix_aio_create"
+external aio_destroy : ctx -> unit = "caml_extunix_aio_destroy"
+external aio_prep : ctx -> int -> bool -> Unix.file_descr -> 'a iov -> int -> int -> Unix.file_descr option -> bool
+  = "caml_extunix_aio_prep_bytecode" "caml_extunix_aio_prep"
+external aio_submit : ctx -> int = "caml_extunix_aio_submit"
+external aio_queued : ctx -> int = "caml_extunix_aio_queued"
+external aio_getevents : ctx -> int -> int array -> float option -> int = "caml_extunix_aio_getevents"
+
+(** [dio_alignment fd] is the alignment required for direct I/O on
+    [fd]: the logical block size for block devices, the alignment
+    reported by [statx] (STATX_DIOALIGN) for regular files, or 512 if
+    it cannot be determined. Raises [Unix.Unix_error EINVAL] if the
+    file system reports that it does not support direct I/O. *)
+external dio_alignment : Unix.file_descr -> int = "caml_extunix_aio_dio_alignment"
+
+(** [create nr] creates an AIO context able to hold [nr] requests in
+    flight *)
+let create nr =
+  let ctx = aio_create nr in
+  { ctx; ids = Array.make nr 0; bufs = Array.make nr No_buf;
+    free = Array.init nr (fun i -> nr - 1 - i); nfree = nr }
+
+(** [destroy t] releases the context, waiting for (or cancelling) the
+    requests in flight *)
+let destroy t =
+  aio_destroy t.ctx;
+  Array.fill t.bufs 0 (Array.length t.bufs) No_buf
+
+(** @return the number of requests queued or submitted and not reaped yet *)
+let in_flight t = Array.length t.free - t.nfree
+
+(** @return the number of requests queued and not submitted yet *)
+let queued t = aio_queued t.ctx
+
+let prep t id write ?resfd ~align fd iov off =
+  if t.nfree = 0 then false
+  else begin
+    let slot = t.free.(t.nfree - 1) in
+    let ok = aio_prep t.ctx slot write fd iov off align resfd in
+    if ok then begin
+      t.nfree <- t.nfree - 1;
+      t.ids.(slot) <- id;
+      t.bufs.(slot) <- Buf iov.iov_buf
+    end;
+    ok
+  end
+
+(** [prep_pread t ~id ?resfd ~align fd iov off] queues a read of
+    [iov.iov_len] bytes from [fd] at offset [off] into [iov]. The
+    buffer address, length and [off] must be multiples of [align]
+    (see {!dio_alignment}), otherwise [Invalid_argument] is raised
+    instead of letting the kernel fail the request with EINVAL. If
+    [resfd] (an {!eventfd}) is given, it is signalled on completion.
+    @return [false] if all slots are in use *)
+let prep_pread t ~id ?resfd ~align fd iov off = prep t id false ?resfd ~align fd iov off
+
+(** [prep_pwrite t ~id ?resfd ~align fd iov off] queues a write of [iov]
+    to [fd] at offset [off], see {!prep_pread} *)
+let prep_pwrite t ~id ?resfd ~align fd iov off = prep t id true ?resfd ~align fd iov off
+
+(** [submit t] submits the queued requests. Requests not accepted by
+    the kernel (e.g. EAGAIN) stay queued.
+    @return the number of requests submitted *)
+let submit t = aio_submit t.ctx
+
+(** [reap t ?timeout min results] waits for at least [min] completions
+    (or [timeout] seconds) and stores them as pairs: [results.(2*i)] is
+    the request [id] and [results.(2*i+1)] the result (number of bytes
+    transferred, or negative errno). The runtime lock is released while
+    waiting.
+    @return the number of completions stored, at most
+    [Array.length results / 2] *)
+let reap t ?timeout min results =
+  let n = aio_getevents t.ctx min results timeout in
+  for i = 0 to n - 1 do
+    let slot = results.(2*i) in
+    results.(2*i) <- t.ids.(slot);
+    t.bufs.(slot) <- No_buf;
+    t.free.(t.nfree) <- slot;
+    t.nfree <- t.nfree + 1
+  done;
+  n
+
+end (* module Aio *)
+]
+
+[%%have RING
+
+(** Lock-free queue of variable-length records in bigarray memory,
+    typically a shared mapping ({!Mmap.map}, {!memfd_create}) so that
+    the producers and the consumer can live in different processes.
+
+    There is a single consumer, and either a single producer ([SPSC]) or
+    several concurrent ones ([MPSC]). Head and tail indices are updated
+    with acquire/release atomics, each on its own cache line. A parked
+    consumer is woken up through an eventfd, which is only written to
+    when the consumer is actually sleeping. *)
+module Ring = struct
+
+  type mode = SPSC | MPSC
+
+  type 'a t = {
+    buf : 'a carray8;
+    mpsc : bool;
+    capacity : int;
+    efd : Unix.file_descr;
+    mutable cursor : int; (** consumer position, only used by the consumer *)
+  }
+
+  external ring_init : 'a carray8 -> int -> unit = "caml_extunix_ring_init"
+  external ring_capacity : 'a carray8 -> int = "caml_extunix_ring_capacity"
+  external ring_tail : 'a carray8 -> int = "caml_extunix_ring_tail" [@@noalloc]
+  external ring_claim : 'a carray8 -> int -> bool -> int = "caml_extunix_ring_claim" [@@noalloc]
+  external ring_commit : 'a carray8 -> int -> int -> unit = "caml_extunix_ring_commit" [@@noalloc]
+  external ring_push : 'a carray8 -> bool -> Bytes.t -> int -> int -> bool = "caml_extunix_ring_push" [@@noalloc]
+  external ring_notify : 'a carray8 -> Unix.file_descr -> bool = "caml_extunix_ring_notify"
+  external ring_take : 'a carray8 -> int -> int = "caml_extunix_ring_take" [@@noalloc]
+  external ring_release : 'a carray8 -> int -> unit = "caml_extunix_ring_release" [@@noalloc]
+  external ring_wait : 'a carray8 -> int -> Unix.file_descr -> float -> bool = "caml_extunix_ring_wait"
+
+  (** size of the control block in front of the data *)
+  let header_size = 256
+
+  (** [size capacity] is the size of the bigarray needed for a ring with
+      [capacity] bytes of data *)
+  let size capacity = header_size + capacity
+
+  (** [attach ?mode buf efd] uses the ring already initialized in [buf],
+      waking the consumer up through the eventfd [efd] (shared with the
+      other processes). Default mode is [SPSC]. *)
+  let attach ?(mode=SPSC) buf efd =
+    let capacity = ring_capacity buf in
+    { buf; mpsc = (mode = MPSC); capacity; efd; cursor = ring_tail buf }
+
+  (** [create ?mode buf ~capacity efd] initializes an empty ring in [buf],
+      which must be 64-byte aligned (e.g. a mapping) and hold at least
+      [size capacity] bytes. [capacity] must be a power of 2, at least 64.
+      Should be called once, before other processes {!attach} to it. *)
+  let create ?mode buf ~capacity efd =
+    ring_init buf capacity;
+    attach ?mode buf efd
+
+  (** @return the largest record the ring accepts *)
+  let max_record t = t.capacity / 2 - 8
+
+  (** Producer side: [claim t len] reserves space for a record of [len]
+      bytes. The payload must then be written to the bigarray at the
+      returned offset and the record made visible with {!commit}.
+      @return the offset of the payload in the bigarray, or -1 if the
+      ring is full *)
+  let claim t len =
+    if len < 0 || len > max_record t
+    then invalid_arg "ExtUnix.Ring.claim"
+    else ring_claim t.buf len t.mpsc
+
+  (** [unsafe_commit t pos len] makes the record claimed at [pos] visible
+      to the consumer, without checking that [pos] and [len] are those of
+      a claimed record. *)
+  let unsafe_commit t pos len = ring_commit t.buf pos len
+
+  (** [commit t pos len] makes the record claimed at [pos] visible to the
+      consumer. Call {!publish} after a batch of commits.
+      @raise Invalid_argument if [pos] or [len] can not come from {!claim} *)
+  let commit t pos len =
+    if pos < header_size + 8 || len < 0 || len > max_record t
+       || pos > header_size + t.capacity - len || (pos - header_size) land 7 <> 0
+    then invalid_arg "ExtUnix.Ring.commit"
+    else ring_commit t.buf pos len
+
+  (** [push t buf ofs len] copies a record from [buf] into the ring
+      (claim and commit).
+      @return false if the ring is full *)
+  let push t buf ofs len =
+    if len < 0 || len > max_record t || ofs < 0 || ofs > Bytes.length buf - len
+    then invalid_arg "ExtUnix.Ring.push"
+    else ring_push t.buf t.mpsc buf ofs len
+
+  (** [publish t] wakes the consumer up if it is parked in {!wait}, to be
+      called once after a batch of records is committed.
+      @return whether the eventfd was written to *)
+  let publish t = ring_notify t.buf t.efd
+
+  (** Consumer side: [consume ?max t f] calls [f buf ofs len] for each
+      available record (at most [max]), in order, then releases their
+      space to the producers at once. The record data must not be used
+      after [f] returns.
+      @return the number of records consumed *)
+  let consume ?(max=max_int) t f =
+    let rec loop n =
+      if n >= max then n else
+      match ring_take t.buf t.cursor with
+      | -1 -> n
+      | -2 ->
+        t.cursor <- t.cursor + t.capacity - (t.cursor land (t.capacity - 1));
+        loop n
+      | len ->
+        f t.buf (header_size + (t.cursor land (t.capacity - 1)) + 8) len;
+        t.cursor <- t.cursor + ((8 + len + 7) land (lnot 7));
+        loop (n + 1)
+    in
+    let start = t.cursor in
+    Fun.protect (fun () -> loop 0)
+      ~finally:(fun () -> if t.cursor <> start then ring_release t.buf t.cursor)
+
+  (** [wait ?timeout t] parks the consumer until a record is available,
+      or for at most [timeout] seconds. The runtime lock is released
+      while sleeping.
+      @return whether a record is available *)
+  let wait ?timeout t =
+    let timeout = match timeout with Some t when t >= 0. -> t | Some _ -> invalid_arg "ExtUnix.Ring.wait" | None -> -1. in
+    ring_wait t.buf t.cursor t.efd timeout
+
+end (* module Ring *)
+
+]
+
+[%%have FUTEX
+
+(** Futexes on aligned 32-bit words of a bigarray, and blocking primitives
+    built on them. With a shared mapping they synchronize processes, in
+    that case [private_] must be false (the default). Waiting releases the
+    runtime lock, so other threads keep running. *)
+module Futex = struct
+
+  external unsafe_wait : 'a carray8 -> int -> int -> bool -> float -> bool = "caml_extunixba_futex_wait"
+  external unsafe_wake : 'a carray8 -> int -> int -> bool -> int = "caml_extunixba_futex_wake"
+
+  let timeout_of_option name = function
+    | None -> -1.
+    | Some t when t >= 0. -> t
+    | Some _ -> invalid_arg name
+
+  (** [wait ?private_ ?timeout buf off v] sleeps as long as the 32-bit word
+      at [off] holds [v] and until {!wake} is called on it, for at most
+      [timeout] seconds. Wake-ups can be spurious, so the caller must
+      re-check its condition.
+      @return false if the timeout expired *)
+  let wait ?(private_=false) ?timeout buf off v =
+    unsafe_wait buf off v private_ (timeout_of_option "ExtUnix.Futex.wait" timeout)
+
+  (** [wake ?private_ buf off n] wakes up at most [n] waiters of the word
+      at [off].
+      @return the number of waiters woken up *)
+  let wake ?(private_=false) buf off n = unsafe_wake buf off n private_
+
+  [%%have FUTEX_WAITV
+  external unsafe_waitv : ('a carray8 * int * int) array -> bool -> float -> int = "caml_extunixba_futex_waitv"
+
+  (** [waitv ?private_ ?timeout waiters] sleeps until one of the words
+      [(buf, off, v)] of [waiters] (at most 128) is woken up, or does not
+      hold [v].
+      @return the index of the word woken up, [None] on timeout, when a
+      word did not hold the expected value, or on a signal *)
+  let waitv ?(private_=false) ?timeout waiters =
+    match unsafe_waitv waiters private_ (timeout_of_option "ExtUnix.Futex.waitv" timeout) with
+    | -1 -> None
+    | i -> Some i
+  ]
+
+  (* a word of a bigarray, checked once *)
+  type 'a word = { buf : 'a carray8; off : int; priv : bool }
+
+  let word name ?(private_=false) buf off =
+    (try BA.Atomic.check buf off 4 with Invalid_argument _ -> invalid_arg name);
+    { buf; off; priv = private_ }
+
+  let load w = BA.Atomic.unsafe_load_int32 w.buf w.off
+  let store w v = BA.Atomic.unsafe_store_int32 w.buf w.off v
+  let cas w old v = BA.Atomic.unsafe_compare_and_swap_int32 w.buf w.off old v
+  let exchange w v = BA.Atomic.unsafe_exchange_int32 w.buf w.off v
+  let fetch_add w n = BA.Atomic.unsafe_fetch_add_int32 w.buf w.off n
+  let sleep ?(timeout = -1.) w v = unsafe_wait w.buf w.off v w.priv timeout
+  let wake_up w n = ignore (unsafe_wake w.buf w.off n w.priv)
+
+  (** Mutex in a 32-bit word: 0 unlocked, 1 locked, 2 locked with
+      waiters. Not recursive, unlocking only wakes a waiter when there
+      may be one. *)
+  module Mutex = struct
+
+    type 'a t = 'a word
+
+    (** [at ?private_ buf off] is the mutex in the word at [off], it must
+        be initialized once with {!init} *)
+    let at ?private_ buf off = word "ExtUnix.Futex.Mutex.at" ?private_ buf off
+
+    let init m = store m 0
+
+    let try_lock m = cas m 0 1
+
+    let rec lock_contended m =
+      if exchange m 2 <> 0 then begin
+        ignore (sleep m 2);
+        lock_contended m
+      end
+
+    let lock m = if not (try_lock m) then lock_contended m
+
+    let unlock m =
+      if fetch_add m (-1) <> 1 then begin
+        store m 0;
+        wake_up m 1
+      end
+
+  end
+
+  (** Condition variable in a 32-bit sequence word, used together with a
+      {!Mutex} *)
+  module Condition = struct
+
+    type 'a t = 'a word
+
+    (** [at ?private_ buf off] is the condition variable in the word at
+        [off], it must be initialized once with {!init} *)
+    let at ?private_ buf off = word "ExtUnix.Futex.Condition.at" ?private_ buf off
+
+    let init c = store c 0
+
+    (** [wait ?timeout c m] atomically unlocks [m] and waits for [c] to be
+        signaled, then locks [m] again. Wake-ups can be spurious.
+        @return false if the timeout expired *)
+    let wait ?timeout c m =
+      let timeout = timeout_of_option "ExtUnix.Futex.Condition.wait" timeout in
+      let seq = load c in
+      Mutex.unlock m;
+      let woken = sleep ~timeout c seq in
+      (* other waiters may be queued on the mutex *)
+      Mutex.lock_contended m;
+      woken
+
+    let signal c =
+      ignore (fetch_add c 1);
+      wake_up c 1
+
+    let broadcast c =
+      ignore (fetch_add c 1);
+      wake_up c max_int
+
+  end
+
+  (** Countdown latch in a 32-bit word: waiters are released once it
+      reaches zero *)
+  module Latch = struct
+
+    type 'a t = 'a word
+
+    let at ?private_ buf off = word "ExtUnix.Futex.Latch.at" ?private_ buf off
+
+    (** [init l n] sets the count to [n] *)
+    let init l n = store l n
+
+    let count l = load l
+
+    (** decrements the count, releasing the waiters when it reaches zero *)
+    let count_down l =
+      if fetch_add l (-1) = 1 then wake_up l max_int
+
+    (** [await ?timeout l] waits for the count to reach zero.
+        @return false if the timeout expired *)
+    let await ?timeout l =
+      let timeout = timeout_of_option "ExtUnix.Futex.Latch.await" timeout in
+      let rec loop () =
+        let n = load l in
+        if n <= 0 then true
+        else if sleep ~timeout l n then loop ()
+        else load l <= 0
+      in
+      loop ()
+
+  end
+
+end (* module Futex *)
+
+]
+
 [%%have WAIT4
 
 (**
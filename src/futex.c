@@ -0,0 +1,121 @@
+#define EXTUNIX_WANT_FUTEX
+#define EXTUNIX_WANT_FUTEX_WAITV
+#include "config.h"
+
+#if defined(EXTUNIX_HAVE_FUTEX)
+
+/* Address of the aligned 32-bit word at [v_off] in [v_buf] */
+static uint32_t *futex_word(value v_buf, value v_off, const char *name)
+{
+  intnat off = Long_val(v_off);
+  char *p;
+
+  if (off < 0 || off > (intnat) caml_ba_byte_size(Caml_ba_array_val(v_buf)) - 4)
+    caml_invalid_argument(name);
+  p = (char *) Caml_ba_data_val(v_buf) + off;
+  if ((uintptr_t) p % 4 != 0)
+    caml_invalid_argument(name);
+  return (uint32_t *) p;
+}
+
+static struct timespec *futex_timeout(value v_timeout, struct timespec *ts)
+{
+  double t = Double_val(v_timeout);
+  if (t < 0.)
+    return NULL;
+  ts->tv_sec = (time_t) t;
+  ts->tv_nsec = (long) ((t - (double) ts->tv_sec) * 1e9);
+  return ts;
+}
+
+/* Sleeps while the word holds [v_val], returns false on timeout.
+   Wake-ups may be spurious, the caller re-checks its condition. */
+CAMLprim value caml_extunixba_futex_wait(value v_buf, value v_off, value v_val, value v_private, value v_timeout)
+{
+  CAMLparam5(v_buf, v_off, v_val, v_private, v_timeout);
+  uint32_t *addr = futex_word(v_buf, v_off, "futex_wait");
+  struct timespec ts, *pts = futex_timeout(v_timeout, &ts);
+  int op = FUTEX_WAIT | (Bool_val(v_private) ? FUTEX_PRIVATE_FLAG : 0);
+  long ret;
+  int err;
+
+  caml_enter_blocking_section();
+  ret = syscall(SYS_futex, addr, op, (uint32_t) Long_val(v_val), pts, NULL, 0);
+  err = errno;
+  caml_leave_blocking_section();
+
+  if (ret == -1)
+  {
+    if (err == ETIMEDOUT)
+      CAMLreturn(Val_false);
+    if (err != EAGAIN && err != EINTR)
+      caml_unix_error(err, "futex_wait", Nothing);
+  }
+  CAMLreturn(Val_true);
+}
+
+/* Wakes up at most [v_n] waiters, returns how many were woken */
+CAMLprim value caml_extunixba_futex_wake(value v_buf, value v_off, value v_n, value v_private)
+{
+  CAMLparam4(v_buf, v_off, v_n, v_private);
+  uint32_t *addr = futex_word(v_buf, v_off, "futex_wake");
+  int op = FUTEX_WAKE | (Bool_val(v_private) ? FUTEX_PRIVATE_FLAG : 0);
+  intnat n = Long_val(v_n);
+  long ret;
+
+  ret = syscall(SYS_futex, addr, op, n > INT32_MAX ? INT32_MAX : (int) n, NULL, NULL, 0);
+  if (ret == -1)
+    caml_uerror("futex_wake", Nothing);
+  CAMLreturn(Val_long(ret));
+}
+
+#endif
+
+#if defined(EXTUNIX_HAVE_FUTEX) && defined(EXTUNIX_HAVE_FUTEX_WAITV)
+
+/* [v_waiters] is an array of (buf, offset, value) triples. Returns the
+   index of the futex which was woken, -1 on timeout or when a value did
+   not match (or on a signal). */
+CAMLprim value caml_extunixba_futex_waitv(value v_waiters, value v_private, value v_timeout)
+{
+  CAMLparam3(v_waiters, v_private, v_timeout);
+  struct futex_waitv w[FUTEX_WAITV_MAX];
+  mlsize_t i, n = Wosize_val(v_waiters);
+  struct timespec ts, now, *pts = futex_timeout(v_timeout, &ts);
+  long ret;
+  int err;
+
+  if (n == 0 || n > FUTEX_WAITV_MAX)
+    caml_invalid_argument("futex_waitv");
+  memset(w, 0, n * sizeof w[0]);
+  for (i = 0; i < n; i++)
+  {
+    value v = Field(v_waiters, i);
+    w[i].uaddr = (uintptr_t) futex_word(Field(v, 0), Field(v, 1), "futex_waitv");
+    w[i].val = (uint32_t) Long_val(Field(v, 2));
+    w[i].flags = FUTEX_32 | (Bool_val(v_private) ? FUTEX_PRIVATE_FLAG : 0);
+  }
+  /* futex_waitv takes an absolute timeout */
+  if (pts != NULL)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ts.tv_sec += now.tv_sec;
+    ts.tv_nsec += now.tv_nsec;
+    if (ts.tv_nsec >= 1000000000) { ts.tv_sec++; ts.tv_nsec -= 1000000000; }
+  }
+
+  caml_enter_blocking_section();
+  ret = syscall(SYS_futex_waitv, w, (unsigned) n, 0, pts, CLOCK_MONOTONIC);
+  err = errno;
+  caml_leave_blocking_section();
+
+  if (ret == -1)
+  {
+    if (err == ETIMEDOUT || err == EAGAIN || err == EINTR)
+      CAMLreturn(Val_long(-1));
+    caml_unix_error(err, "futex_waitv", Nothing);
+  }
+  CAMLreturn(Val_long(ret));
+}
+
+#endif
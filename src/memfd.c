@@ -0,0 +1,96 @@
+#define EXTUNIX_WANT_MEMFD
+#include "config.h"
+
+#if defined(EXTUNIX_HAVE_MEMFD)
+
+/* Same as in mman.c, mappings are released by the unix library finalizer */
+extern value caml_unix_mapped_alloc(int flags, int num_dims, void *data, intnat *dim);
+
+static const int memfd_flags_table[] = { MFD_CLOEXEC, MFD_ALLOW_SEALING, MFD_HUGETLB };
+
+static const int seals_table[] =
+  {
+    F_SEAL_SEAL, F_SEAL_SHRINK, F_SEAL_GROW, F_SEAL_WRITE, F_SEAL_FUTURE_WRITE
+  };
+
+CAMLprim value caml_extunix_memfd_create(value v_name, value v_flags)
+{
+  CAMLparam2(v_name, v_flags);
+  int flags = caml_convert_flag_list(v_flags, memfd_flags_table);
+  int fd;
+
+  if (!caml_string_is_c_safe(v_name))
+    caml_invalid_argument("memfd_create");
+  fd = memfd_create(String_val(v_name), flags);
+  if (fd == -1)
+    caml_uerror("memfd_create", Nothing);
+
+  CAMLreturn(Val_int(fd));
+}
+
+CAMLprim value caml_extunix_memfd_add_seals(value v_fd, value v_seals)
+{
+  CAMLparam2(v_fd, v_seals);
+  int seals = caml_convert_flag_list(v_seals, seals_table);
+
+  if (fcntl(Int_val(v_fd), F_ADD_SEALS, seals) == -1)
+    caml_uerror("fcntl", Nothing);
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value caml_extunix_memfd_get_seals(value v_fd)
+{
+  CAMLparam1(v_fd);
+  CAMLlocal2(list, tmp);
+  int seals = fcntl(Int_val(v_fd), F_GET_SEALS);
+  int i;
+
+  if (seals == -1)
+    caml_uerror("fcntl", Nothing);
+
+  list = Val_emptylist;
+  for (i = sizeof(seals_table) / sizeof(seals_table[0]) - 1; i >= 0; i--)
+  {
+    if (seals & seals_table[i])
+    {
+      tmp = caml_alloc_small(2, Tag_cons);
+      Field(tmp, 0) = Val_int(i);
+      Field(tmp, 1) = list;
+      list = tmp;
+    }
+  }
+  CAMLreturn(list);
+}
+
+/* Maps the whole memfd read-only, once it can neither shrink nor be
+   written to, so that the data can not change under the reader */
+CAMLprim value caml_extunix_memfd_map_sealed(value v_fd)
+{
+  CAMLparam1(v_fd);
+  int fd = Int_val(v_fd);
+  int seals = fcntl(fd, F_GET_SEALS);
+  struct stat st;
+  intnat len;
+  void *addr;
+
+  if (seals == -1)
+    caml_uerror("fcntl", Nothing);
+  /* F_SEAL_FUTURE_WRITE is not enough: writable mappings made before
+     sealing keep working */
+  if ((seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) != (F_SEAL_SHRINK | F_SEAL_WRITE))
+    caml_unix_error(EPERM, "memfd_map_sealed", Nothing);
+  if (fstat(fd, &st) == -1)
+    caml_uerror("fstat", Nothing);
+  len = st.st_size;
+  if (len == 0)
+    CAMLreturn(caml_ba_alloc_dims(CAML_BA_UINT8 | CAML_BA_C_LAYOUT, 1, NULL, (intnat) 0));
+
+  addr = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED)
+    caml_uerror("mmap", Nothing);
+
+  CAMLreturn(caml_unix_mapped_alloc(CAML_BA_UINT8 | CAML_BA_C_LAYOUT, 1, addr, &len));
+}
+
+#endif
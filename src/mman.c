@@ -1,4 +1,9 @@
 #define EXTUNIX_WANT_MLOCKALL
+#define EXTUNIX_WANT_MMAP
+#define EXTUNIX_WANT_MADVISE
+#define EXTUNIX_WANT_MINCORE
+#define EXTUNIX_WANT_MLOCK2
+#define EXTUNIX_WANT_MSYNC
 #include "config.h"
 
 #if defined(EXTUNIX_HAVE_MLOCKALL)
@@ -36,3 +41,336 @@ CAMLprim value caml_extunix_munlockall(value v_unit)
 
 #endif
 
+#if defined(EXTUNIX_HAVE_MMAP)
+
+/* Mappings are wrapped with the finalizer of the unix library
+   (Unix.map_file), which unmaps them once the array and all its
+   sub-arrays are collected. */
+extern value caml_unix_mapped_alloc(int flags, int num_dims, void *data, intnat *dim);
+
+static const int mmap_prot_table[] = { PROT_READ, PROT_WRITE, PROT_EXEC };
+
+static const int mmap_flags_table[] =
+  {
+    MAP_SHARED, MAP_PRIVATE, MAP_SHARED_VALIDATE, MAP_ANONYMOUS,
+    MAP_POPULATE, MAP_HUGETLB, MAP_NORESERVE, MAP_LOCKED
+  };
+
+CAMLprim value caml_extunix_mmap(value v_fd, value v_off, value v_len, value v_prot, value v_flags)
+{
+  CAMLparam5(v_fd, v_off, v_len, v_prot, v_flags);
+  int prot = caml_convert_flag_list(v_prot, mmap_prot_table);
+  int flags = caml_convert_flag_list(v_flags, mmap_flags_table);
+  int fd = Is_some(v_fd) ? Int_val(Some_val(v_fd)) : -1;
+  int64_t off = Int64_val(v_off);
+  intnat len = Long_val(v_len);
+  uintnat page = sysconf(_SC_PAGESIZE);
+  uintnat delta;
+  void *addr;
+
+  if (fd == -1)
+    flags |= MAP_ANONYMOUS;
+  /* mmap wants a page aligned offset, map from the start of the page
+     like Unix.map_file does */
+  delta = (uintnat) (off % page);
+
+  /* MAP_POPULATE prefaults the whole range */
+  caml_enter_blocking_section();
+  addr = mmap(NULL, len + delta, prot, flags, fd, off - delta);
+  caml_leave_blocking_section();
+
+  if (addr == MAP_FAILED)
+    caml_uerror("mmap", Nothing);
+
+  CAMLreturn(caml_unix_mapped_alloc(CAML_BA_UINT8 | CAML_BA_C_LAYOUT, 1, (char *) addr + delta, &len));
+}
+
+/* The mapping is handed over to the returned array, [v_ba] is left
+   empty. Arrays sharing the mapping (sub-arrays) can not be updated,
+   so they are refused. */
+CAMLprim value caml_extunix_mremap(value v_ba, value v_len, value v_may_move)
+{
+  CAMLparam3(v_ba, v_len, v_may_move);
+  struct caml_ba_array *ba = Caml_ba_array_val(v_ba);
+  intnat len = Long_val(v_len);
+  uintnat page = sysconf(_SC_PAGESIZE);
+  uintnat delta = (uintnat) ba->data % page;
+  char *old = (char *) ba->data - delta;
+  void *addr;
+
+  if ((ba->flags & CAML_BA_MANAGED_MASK) != CAML_BA_MAPPED_FILE || ba->proxy != NULL
+      || ba->num_dims != 1 || ba->dim[0] == 0)
+    caml_invalid_argument("Mmap.remap");
+
+  addr = mremap(old, ba->dim[0] + delta, len + delta, Bool_val(v_may_move) ? MREMAP_MAYMOVE : 0);
+  if (addr == MAP_FAILED)
+    caml_uerror("mremap", Nothing);
+  ba->dim[0] = 0;
+
+  CAMLreturn(caml_unix_mapped_alloc(ba->flags & ~CAML_BA_MANAGED_MASK, 1, (char *) addr + delta, &len));
+}
+
+CAMLprim value caml_extunix_munmap(value v_ba)
+{
+  CAMLparam1(v_ba);
+  struct caml_ba_array *ba = Caml_ba_array_val(v_ba);
+  uintnat page = sysconf(_SC_PAGESIZE);
+  uintnat delta = (uintnat) ba->data % page;
+
+  if ((ba->flags & CAML_BA_MANAGED_MASK) != CAML_BA_MAPPED_FILE || ba->proxy != NULL
+      || ba->num_dims != 1)
+    caml_invalid_argument("Mmap.unmap");
+  if (ba->dim[0] == 0)
+    CAMLreturn(Val_unit);
+
+  if (munmap((char *) ba->data - delta, ba->dim[0] + delta) != 0)
+    caml_uerror("munmap", Nothing);
+  ba->dim[0] = 0;
+
+  CAMLreturn(Val_unit);
+}
+
+#endif
+
+#if defined(EXTUNIX_HAVE_MADVISE) || defined(EXTUNIX_HAVE_MINCORE) || defined(EXTUNIX_HAVE_MLOCK2) || defined(EXTUNIX_HAVE_MSYNC)
+
+/* Page range covering [v_ofs, v_ofs + v_len) of the bigarray [v_ba].
+   With [outward] partial pages at both ends are included, otherwise
+   they are left out (the range may become empty). */
+static void mman_range(value v_ba, value v_ofs, value v_len, int outward, const char *name, char **addr, size_t *len)
+{
+  intnat ofs = Long_val(v_ofs);
+  intnat size = Long_val(v_len);
+  uintnat page = sysconf(_SC_PAGESIZE);
+  uintnat start, end;
+
+  if (ofs < 0 || size < 0 || ofs > (intnat) caml_ba_byte_size(Caml_ba_array_val(v_ba)) - size)
+    caml_invalid_argument(name);
+  start = (uintnat) Caml_ba_data_val(v_ba) + ofs;
+  end = start + size;
+  if (outward)
+  {
+    start &= ~(page - 1);
+    end = (end + page - 1) & ~(page - 1);
+  }
+  else
+  {
+    start = (start + page - 1) & ~(page - 1);
+    end &= ~(page - 1);
+    if (end < start) end = start;
+  }
+  *addr = (char *) start;
+  *len = end - start;
+}
+
+#endif
+
+#if defined(EXTUNIX_HAVE_MADVISE)
+
+/* Same order as ExtUnix.Mmap.madvice, -1 when not known at compile time */
+static const int madvise_table[] =
+  {
+    MADV_NORMAL,
+    MADV_RANDOM,
+    MADV_SEQUENTIAL,
+    MADV_WILLNEED,
+    MADV_DONTNEED,
+#if defined(MADV_FREE)
+    MADV_FREE,
+#else
+    -1,
+#endif
+#if defined(MADV_HUGEPAGE)
+    MADV_HUGEPAGE,
+    MADV_NOHUGEPAGE,
+#else
+    -1, -1,
+#endif
+#if defined(MADV_COLD)
+    MADV_COLD,
+#else
+    -1,
+#endif
+#if defined(MADV_PAGEOUT)
+    MADV_PAGEOUT,
+#else
+    -1,
+#endif
+  };
+
+CAMLprim value caml_extunix_madvise(value v_ba, value v_ofs, value v_len, value v_advice)
+{
+  CAMLparam4(v_ba, v_ofs, v_len, v_advice);
+  int advice = madvise_table[Int_val(v_advice)];
+  char *addr;
+  size_t len;
+  int ret;
+
+  /* advice discarding data must not spill over to the neighbours of the range */
+  mman_range(v_ba, v_ofs, v_len, advice != MADV_DONTNEED
+#if defined(MADV_FREE)
+             && advice != MADV_FREE
+#endif
+#if defined(MADV_PAGEOUT)
+             && advice != MADV_PAGEOUT
+#endif
+             , "Mmap.madvise", &addr, &len);
+  if (advice == -1)
+    caml_unix_error(EINVAL, "madvise", Nothing);
+  if (len == 0)
+    CAMLreturn(Val_unit);
+
+  /* WILLNEED may start I/O */
+  caml_enter_blocking_section();
+  ret = madvise(addr, len, advice);
+  caml_leave_blocking_section();
+
+  if (ret != 0)
+    caml_uerror("madvise", Nothing);
+
+  CAMLreturn(Val_unit);
+}
+
+#endif
+
+#if defined(EXTUNIX_HAVE_MINCORE)
+
+CAMLprim value caml_extunix_mincore(value v_ba, value v_ofs, value v_len)
+{
+  CAMLparam3(v_ba, v_ofs, v_len);
+  CAMLlocal1(v_res);
+  uintnat page = sysconf(_SC_PAGESIZE);
+  unsigned char *vec;
+  char *addr;
+  size_t len, i, n;
+
+  mman_range(v_ba, v_ofs, v_len, 1, "Mmap.mincore", &addr, &len);
+  n = len / page;
+  v_res = caml_ba_alloc_dims(CAML_BA_UINT8 | CAML_BA_C_LAYOUT, 1, NULL, (intnat) n);
+  vec = Caml_ba_data_val(v_res);
+  if (n > 0 && mincore(addr, len, vec) != 0)
+    caml_uerror("mincore", Nothing);
+  /* other bits are reserved */
+  for (i = 0; i < n; i++)
+    vec[i] &= 1;
+
+  CAMLreturn(v_res);
+}
+
+#endif
+
+#if defined(EXTUNIX_HAVE_MLOCK2)
+
+static const int mlock2_flags_table[] = { MLOCK_ONFAULT };
+
+CAMLprim value caml_extunix_mlock2(value v_ba, value v_ofs, value v_len, value v_flags)
+{
+  CAMLparam4(v_ba, v_ofs, v_len, v_flags);
+  int flags = caml_convert_flag_list(v_flags, mlock2_flags_table);
+  char *addr;
+  size_t len;
+  int ret;
+
+  mman_range(v_ba, v_ofs, v_len, 1, "Mmap.mlock2", &addr, &len);
+
+  /* faults the pages in unless MLOCK_ONFAULT */
+  caml_enter_blocking_section();
+  ret = mlock2(addr, len, flags);
+  caml_leave_blocking_section();
+
+  if (ret != 0)
+    caml_uerror("mlock2", Nothing);
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value caml_extunix_munlock(value v_ba, value v_ofs, value v_len)
+{
+  CAMLparam3(v_ba, v_ofs, v_len);
+  char *addr;
+  size_t len;
+
+  mman_range(v_ba, v_ofs, v_len, 1, "Mmap.munlock", &addr, &len);
+  if (munlock(addr, len) != 0)
+    caml_uerror("munlock", Nothing);
+
+  CAMLreturn(Val_unit);
+}
+
+#endif
+
+#if defined(EXTUNIX_HAVE_MSYNC)
+
+static const int msync_flags_table[] = { MS_ASYNC, MS_SYNC, MS_INVALIDATE };
+
+CAMLprim value caml_extunix_page_size(value v_unit)
+{
+  (void)v_unit;
+  return Val_long(sysconf(_SC_PAGESIZE));
+}
+
+CAMLprim value caml_extunix_msync(value v_ba, value v_ofs, value v_len, value v_flags)
+{
+  CAMLparam4(v_ba, v_ofs, v_len, v_flags);
+  int flags = caml_convert_flag_list(v_flags, msync_flags_table);
+  char *addr;
+  size_t len;
+  int ret;
+
+  mman_range(v_ba, v_ofs, v_len, 1, "Mmap.msync", &addr, &len);
+
+  caml_enter_blocking_section();
+  ret = msync(addr, len, flags);
+  caml_leave_blocking_section();
+
+  if (ret != 0)
+    caml_uerror("msync", Nothing);
+
+  CAMLreturn(Val_unit);
+}
+
+/* Flushes the first [v_n] (offset, length) pairs stored in the int
+   array [v_ranges] in a single blocking section */
+CAMLprim value caml_extunix_msync_ranges(value v_ba, value v_ranges, value v_n, value v_flags)
+{
+  CAMLparam4(v_ba, v_ranges, v_n, v_flags);
+  int flags = caml_convert_flag_list(v_flags, msync_flags_table);
+  intnat n = Long_val(v_n);
+  struct { char *addr; size_t len; } *r;
+  intnat i;
+  int ret = 0, err = 0;
+
+  if (n < 0 || (mlsize_t) n > Wosize_val(v_ranges) / 2)
+    caml_invalid_argument("Mmap.msync_ranges");
+  if (n == 0)
+    CAMLreturn(Val_unit);
+  r = caml_stat_alloc(n * sizeof *r);
+  for (i = 0; i < n; i++)
+  {
+    /* no OCaml exception may escape with r allocated */
+    intnat ofs = Long_val(Field(v_ranges, 2 * i));
+    intnat len = Long_val(Field(v_ranges, 2 * i + 1));
+    if (ofs < 0 || len < 0 || ofs > (intnat) caml_ba_byte_size(Caml_ba_array_val(v_ba)) - len)
+    {
+      caml_stat_free(r);
+      caml_invalid_argument("Mmap.msync_ranges");
+    }
+    mman_range(v_ba, Field(v_ranges, 2 * i), Field(v_ranges, 2 * i + 1), 1, "Mmap.msync_ranges", &r[i].addr, &r[i].len);
+  }
+
+  caml_enter_blocking_section();
+  for (i = 0; i < n && ret == 0; i++)
+  {
+    ret = msync(r[i].addr, r[i].len, flags);
+    err = errno;
+  }
+  caml_leave_blocking_section();
+
+  caml_stat_free(r);
+  if (ret != 0)
+    caml_unix_error(err, "msync", Nothing);
+
+  CAMLreturn(Val_unit);
+}
+
+#endif
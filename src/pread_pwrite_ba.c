@@ -1,6 +1,9 @@
 
 #define EXTUNIX_WANT_PREAD
 #define EXTUNIX_WANT_PWRITE
+#define EXTUNIX_WANT_PREADV
+#define EXTUNIX_WANT_PWRITEV
+#define EXTUNIX_WANT_PREADV2
 #include "config.h"
 
 enum mode_bits {
@@ -287,3 +290,245 @@ value caml_extunixba_intr_write(value v_fd, value v_buf)
 }
 #endif
 
+
+#if defined(EXTUNIX_HAVE_PREADV) || defined(EXTUNIX_HAVE_PWRITEV) || defined(EXTUNIX_HAVE_PREADV2)
+
+/* Consumes [done] bytes from the front of iov[idx..count) and returns
+   the index of the first iovec that still has data to transfer. */
+static size_t extunixba_iovec_advance(struct iovec *iov, size_t idx, size_t count, size_t done)
+{
+    while (idx < count && done >= iov[idx].iov_len) {
+	done -= iov[idx].iov_len;
+	idx++;
+    }
+    if (idx < count) {
+	iov[idx].iov_base = (char *)iov[idx].iov_base + done;
+	iov[idx].iov_len -= done;
+    }
+    return idx;
+}
+#endif
+
+#if defined(EXTUNIX_HAVE_PREADV)
+
+CAMLprim value caml_extunixba_preadv_common(value v_fd, off_t off, value v_iov, int mode) {
+    CAMLparam2(v_fd, v_iov);
+    ssize_t ret;
+    int fd = Int_val(v_fd);
+    size_t count, idx, processed = 0;
+    struct iovec *iov = extunix_iovec_of_array(v_iov, "preadv", &count);
+    int err;
+
+    idx = extunixba_iovec_advance(iov, 0, count, 0);
+    while(idx < count) {
+	caml_enter_blocking_section();
+	ret = preadv(fd, iov + idx, (count - idx > IOV_MAX) ? IOV_MAX : (int)(count - idx), off);
+	caml_leave_blocking_section();
+	if (ret == 0) break;
+	if (ret == -1) {
+	    if (errno == EINTR && (mode & BIT_NOINTR)) continue;
+	    if (processed > 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+		if (mode & BIT_NOERROR) break;
+	    }
+	    err = errno;
+	    caml_stat_free(iov);
+	    caml_unix_error(err, "preadv", Nothing);
+	}
+	processed += ret;
+	off += ret;
+	idx = extunixba_iovec_advance(iov, idx, count, ret);
+	if (mode & BIT_ONCE) break;
+    }
+
+    caml_stat_free(iov);
+    CAMLreturn(Val_long(processed));
+}
+
+value caml_extunixba_all_preadv(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Long_val(v_off);
+    return caml_extunixba_preadv_common(v_fd, off, v_iov, BIT_NOINTR);
+}
+
+value caml_extunixba_single_preadv(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Long_val(v_off);
+    return caml_extunixba_preadv_common(v_fd, off, v_iov, BIT_ONCE);
+}
+
+value caml_extunixba_preadv(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Long_val(v_off);
+    return caml_extunixba_preadv_common(v_fd, off, v_iov, BIT_NOINTR | BIT_NOERROR);
+}
+
+value caml_extunixba_intr_preadv(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Long_val(v_off);
+    return caml_extunixba_preadv_common(v_fd, off, v_iov, BIT_NOERROR);
+}
+
+value caml_extunixba_all_preadv64(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Int64_val(v_off);
+    return caml_extunixba_preadv_common(v_fd, off, v_iov, BIT_NOINTR);
+}
+
+value caml_extunixba_single_preadv64(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Int64_val(v_off);
+    return caml_extunixba_preadv_common(v_fd, off, v_iov, BIT_ONCE);
+}
+
+value caml_extunixba_preadv64(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Int64_val(v_off);
+    return caml_extunixba_preadv_common(v_fd, off, v_iov, BIT_NOINTR | BIT_NOERROR);
+}
+
+value caml_extunixba_intr_preadv64(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Int64_val(v_off);
+    return caml_extunixba_preadv_common(v_fd, off, v_iov, BIT_NOERROR);
+}
+#endif
+
+#if defined(EXTUNIX_HAVE_PWRITEV)
+
+CAMLprim value caml_extunixba_pwritev_common(value v_fd, off_t off, value v_iov, int mode) {
+    CAMLparam2(v_fd, v_iov);
+    ssize_t ret;
+    int fd = Int_val(v_fd);
+    size_t count, idx, processed = 0;
+    struct iovec *iov = extunix_iovec_of_array(v_iov, "pwritev", &count);
+    int err;
+
+    idx = extunixba_iovec_advance(iov, 0, count, 0);
+    while(idx < count) {
+	caml_enter_blocking_section();
+	ret = pwritev(fd, iov + idx, (count - idx > IOV_MAX) ? IOV_MAX : (int)(count - idx), off);
+	caml_leave_blocking_section();
+	if (ret == 0) break;
+	if (ret == -1) {
+	    if (errno == EINTR && (mode & BIT_NOINTR)) continue;
+	    if (processed > 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+		if (mode & BIT_NOERROR) break;
+	    }
+	    err = errno;
+	    caml_stat_free(iov);
+	    caml_unix_error(err, "pwritev", Nothing);
+	}
+	processed += ret;
+	off += ret;
+	idx = extunixba_iovec_advance(iov, idx, count, ret);
+	if (mode & BIT_ONCE) break;
+    }
+
+    caml_stat_free(iov);
+    CAMLreturn(Val_long(processed));
+}
+
+value caml_extunixba_all_pwritev(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Long_val(v_off);
+    return caml_extunixba_pwritev_common(v_fd, off, v_iov, BIT_NOINTR);
+}
+
+value caml_extunixba_single_pwritev(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Long_val(v_off);
+    return caml_extunixba_pwritev_common(v_fd, off, v_iov, BIT_ONCE);
+}
+
+value caml_extunixba_pwritev(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Long_val(v_off);
+    return caml_extunixba_pwritev_common(v_fd, off, v_iov, BIT_NOINTR | BIT_NOERROR);
+}
+
+value caml_extunixba_intr_pwritev(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Long_val(v_off);
+    return caml_extunixba_pwritev_common(v_fd, off, v_iov, BIT_NOERROR);
+}
+
+value caml_extunixba_all_pwritev64(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Int64_val(v_off);
+    return caml_extunixba_pwritev_common(v_fd, off, v_iov, BIT_NOINTR);
+}
+
+value caml_extunixba_single_pwritev64(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Int64_val(v_off);
+    return caml_extunixba_pwritev_common(v_fd, off, v_iov, BIT_ONCE);
+}
+
+value caml_extunixba_pwritev64(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Int64_val(v_off);
+    return caml_extunixba_pwritev_common(v_fd, off, v_iov, BIT_NOINTR | BIT_NOERROR);
+}
+
+value caml_extunixba_intr_pwritev64(value v_fd, value v_off, value v_iov)
+{
+    off_t off = Int64_val(v_off);
+    return caml_extunixba_pwritev_common(v_fd, off, v_iov, BIT_NOERROR);
+}
+#endif
+
+#if defined(EXTUNIX_HAVE_PREADV2)
+
+static const int rwf_flags_table[] = {
+    RWF_HIPRI, RWF_DSYNC, RWF_SYNC, RWF_NOWAIT, RWF_APPEND
+};
+
+/* RWF_NOWAIT calls do not block, so the runtime lock is kept. Like
+   preadv/pwritev, a single call transfers at most IOV_MAX slices and
+   reports the short count (only messages, which can not be split, fail
+   with EMSGSIZE). */
+
+static value extunixba_rw2_common(value v_fd, value v_off, value v_iov, value v_flags, int write) {
+    CAMLparam4(v_fd, v_off, v_iov, v_flags);
+    CAMLlocal1(v_res);
+    ssize_t ret;
+    int fd = Int_val(v_fd);
+    off_t off = Long_val(v_off);
+    int flags = caml_convert_flag_list(v_flags, rwf_flags_table);
+    const char *name = write ? "pwritev2" : "preadv2";
+    size_t count;
+    struct iovec *iov = extunix_iovec_of_array(v_iov, name, &count);
+    int iovcnt = (count > IOV_MAX) ? IOV_MAX : (int)count;
+    int err;
+
+    if (!(flags & RWF_NOWAIT))
+	caml_enter_blocking_section();
+    ret = write ? pwritev2(fd, iov, iovcnt, off, flags) : preadv2(fd, iov, iovcnt, off, flags);
+    err = errno;
+    if (!(flags & RWF_NOWAIT))
+	caml_leave_blocking_section();
+    caml_stat_free(iov);
+
+    if (ret == -1) {
+	if ((flags & RWF_NOWAIT) && (err == EAGAIN || err == EWOULDBLOCK))
+	    CAMLreturn(Val_none);
+	caml_unix_error(err, name, Nothing);
+    }
+
+    v_res = caml_alloc(1, 0);
+    Store_field(v_res, 0, Val_long(ret));
+    CAMLreturn(v_res);
+}
+
+CAMLprim value caml_extunixba_preadv2(value v_fd, value v_off, value v_iov, value v_flags)
+{
+    return extunixba_rw2_common(v_fd, v_off, v_iov, v_flags, 0);
+}
+
+CAMLprim value caml_extunixba_pwritev2(value v_fd, value v_off, value v_iov, value v_flags)
+{
+    return extunixba_rw2_common(v_fd, v_off, v_iov, v_flags, 1);
+}
+#endif
@@ -0,0 +1,240 @@
+#define EXTUNIX_WANT_RING
+#include "config.h"
+
+#if defined(EXTUNIX_HAVE_RING)
+
+/*
+ * Lock-free byte ring for variable-length records in a (shared) bigarray,
+ * see ExtUnix.Ring. Layout, every control word on its own cache line:
+ *
+ *   0    head: bytes claimed by producers (u64)
+ *   64   tail: bytes released by the consumer (u64)
+ *   128  parked: consumer is sleeping on the eventfd (u32)
+ *   192  capacity (u64), magic (u32)
+ *   256  data, capacity bytes (power of 2)
+ *
+ * A record is an 8 byte header followed by the payload, padded to 8
+ * bytes. The header holds len + 1 once the record is committed (with
+ * release semantics), 0 before, and RING_PAD for the filler before a
+ * wrap-around. The consumer zeroes the space it releases, so that the
+ * header of a claimed but not yet committed record always reads as 0.
+ */
+
+#define RING_HEAD 0
+#define RING_TAIL 64
+#define RING_PARKED 128
+#define RING_CAP 192
+#define RING_MAGIC 200
+#define RING_DATA 256
+
+#define RING_MAGIC_VALUE 0x52494e47u
+#define RING_PAD 0xffffffffu
+
+#define ring_u64(b, ofs) ((uint64_t *) ((char *) (b) + (ofs)))
+#define ring_u32(b, ofs) ((uint32_t *) ((char *) (b) + (ofs)))
+#define ring_align(n) (((n) + 7) & ~(uint64_t) 7)
+
+static char *ring_base(value v_ba)
+{
+  return Caml_ba_data_val(v_ba);
+}
+
+static uint32_t *ring_header(char *b, uint64_t pos)
+{
+  uint64_t mask = *ring_u64(b, RING_CAP) - 1;
+  return ring_u32(b, RING_DATA + (pos & mask));
+}
+
+CAMLprim value caml_extunix_ring_init(value v_ba, value v_cap)
+{
+  CAMLparam2(v_ba, v_cap);
+  char *b = ring_base(v_ba);
+  intnat cap = Long_val(v_cap);
+
+  if (cap < 64 || (cap & (cap - 1)) != 0 || cap > (intnat) UINT32_MAX
+      || (uintptr_t) b % 64 != 0
+      || (uintnat) cap > caml_ba_byte_size(Caml_ba_array_val(v_ba)) - RING_DATA
+      || caml_ba_byte_size(Caml_ba_array_val(v_ba)) < RING_DATA)
+    caml_invalid_argument("Ring.create");
+
+  memset(b, 0, RING_DATA + cap);
+  *ring_u64(b, RING_CAP) = cap;
+  __atomic_store_n(ring_u32(b, RING_MAGIC), RING_MAGIC_VALUE, __ATOMIC_RELEASE);
+  CAMLreturn(Val_unit);
+}
+
+/* Returns the capacity of an initialized ring */
+CAMLprim value caml_extunix_ring_capacity(value v_ba)
+{
+  CAMLparam1(v_ba);
+  char *b = ring_base(v_ba);
+  uint64_t cap;
+
+  if ((uintptr_t) b % 64 != 0 || caml_ba_byte_size(Caml_ba_array_val(v_ba)) < RING_DATA
+      || __atomic_load_n(ring_u32(b, RING_MAGIC), __ATOMIC_ACQUIRE) != RING_MAGIC_VALUE)
+    caml_invalid_argument("Ring.attach");
+  cap = *ring_u64(b, RING_CAP);
+  if (cap > caml_ba_byte_size(Caml_ba_array_val(v_ba)) - RING_DATA)
+    caml_invalid_argument("Ring.attach");
+  CAMLreturn(Val_long(cap));
+}
+
+CAMLprim value caml_extunix_ring_tail(value v_ba)
+{
+  return Val_long(__atomic_load_n(ring_u64(ring_base(v_ba), RING_TAIL), __ATOMIC_ACQUIRE));
+}
+
+/* Reserves room for a record of [v_len] bytes, returns the offset of its
+   payload in the bigarray or -1 if the ring is full */
+CAMLprim value caml_extunix_ring_claim(value v_ba, value v_len, value v_mpsc)
+{
+  char *b = ring_base(v_ba);
+  uint64_t cap = *ring_u64(b, RING_CAP);
+  uint64_t need = ring_align(8 + (uint64_t) Long_val(v_len));
+  uint64_t head, tail, contiguous, total;
+
+  head = __atomic_load_n(ring_u64(b, RING_HEAD), __ATOMIC_RELAXED);
+  while (1)
+  {
+    contiguous = cap - (head & (cap - 1));
+    total = need <= contiguous ? need : contiguous + need;
+    tail = __atomic_load_n(ring_u64(b, RING_TAIL), __ATOMIC_ACQUIRE);
+    if (head + total - tail > cap)
+    {
+      /* head was stale, other producers and the consumer moved on */
+      if ((int64_t) (head - tail) < 0)
+      {
+        head = __atomic_load_n(ring_u64(b, RING_HEAD), __ATOMIC_RELAXED);
+        continue;
+      }
+      return Val_long(-1);
+    }
+    if (!Bool_val(v_mpsc))
+    {
+      __atomic_store_n(ring_u64(b, RING_HEAD), head + total, __ATOMIC_RELAXED);
+      break;
+    }
+    /* on failure head is reloaded */
+    if (__atomic_compare_exchange_n(ring_u64(b, RING_HEAD), &head, head + total, 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+      break;
+  }
+  if (total != need)
+  {
+    __atomic_store_n(ring_header(b, head), RING_PAD, __ATOMIC_RELEASE);
+    head += contiguous;
+  }
+  return Val_long(RING_DATA + (head & (cap - 1)) + 8);
+}
+
+/* Makes the record at payload offset [v_pos] visible to the consumer */
+CAMLprim value caml_extunix_ring_commit(value v_ba, value v_pos, value v_len)
+{
+  char *b = ring_base(v_ba);
+  __atomic_store_n(ring_u32(b, Long_val(v_pos) - 8), (uint32_t) Long_val(v_len) + 1, __ATOMIC_RELEASE);
+  return Val_unit;
+}
+
+CAMLprim value caml_extunix_ring_push(value v_ba, value v_mpsc, value v_buf, value v_ofs, value v_len)
+{
+  value v_pos = caml_extunix_ring_claim(v_ba, v_len, v_mpsc);
+  if (Long_val(v_pos) < 0)
+    return Val_false;
+  memcpy(ring_base(v_ba) + Long_val(v_pos), Bytes_val(v_buf) + Long_val(v_ofs), Long_val(v_len));
+  caml_extunix_ring_commit(v_ba, v_pos, v_len);
+  return Val_true;
+}
+
+/* Wakes the consumer up if it is parked */
+CAMLprim value caml_extunix_ring_notify(value v_ba, value v_efd)
+{
+  CAMLparam2(v_ba, v_efd);
+  char *b = ring_base(v_ba);
+
+  /* pairs with the fence in ring_wait: either the consumer sees the
+     committed records or we see it parked */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(ring_u32(b, RING_PARKED), __ATOMIC_RELAXED) == 0)
+    CAMLreturn(Val_false);
+  if (eventfd_write(Int_val(v_efd), 1) == -1)
+    caml_uerror("eventfd_write", Nothing);
+  CAMLreturn(Val_true);
+}
+
+/* Consumer side: length of the committed record at [v_cursor],
+   -1 if there is none yet, -2 for the filler before a wrap-around */
+CAMLprim value caml_extunix_ring_take(value v_ba, value v_cursor)
+{
+  char *b = ring_base(v_ba);
+  uint64_t cursor = Long_val(v_cursor);
+  uint32_t hdr;
+
+  /* a full lap was consumed but not released yet, the header at the
+     cursor is the one of the first unreleased record */
+  if (cursor - __atomic_load_n(ring_u64(b, RING_TAIL), __ATOMIC_RELAXED) >= *ring_u64(b, RING_CAP))
+    return Val_long(-1);
+  hdr = __atomic_load_n(ring_header(b, cursor), __ATOMIC_ACQUIRE);
+  if (hdr == 0)
+    return Val_long(-1);
+  return Val_long(hdr == RING_PAD ? -2 : (intnat) hdr - 1);
+}
+
+/* Hands the space up to [v_cursor] back to the producers */
+CAMLprim value caml_extunix_ring_release(value v_ba, value v_cursor)
+{
+  char *b = ring_base(v_ba);
+  uint64_t cap = *ring_u64(b, RING_CAP);
+  uint64_t tail = __atomic_load_n(ring_u64(b, RING_TAIL), __ATOMIC_RELAXED);
+  uint64_t cursor = Long_val(v_cursor);
+  uint64_t off = tail & (cap - 1);
+  uint64_t len = cursor - tail;
+
+  if (off + len > cap)
+  {
+    memset(b + RING_DATA + off, 0, cap - off);
+    len -= cap - off;
+    off = 0;
+  }
+  memset(b + RING_DATA + off, 0, len);
+  __atomic_store_n(ring_u64(b, RING_TAIL), cursor, __ATOMIC_RELEASE);
+  return Val_unit;
+}
+
+/* Parks the consumer until a record is committed at [v_cursor] or the
+   timeout (seconds, negative: none) expires. Returns whether a record
+   is available. */
+CAMLprim value caml_extunix_ring_wait(value v_ba, value v_cursor, value v_efd, value v_timeout)
+{
+  CAMLparam4(v_ba, v_cursor, v_efd, v_timeout);
+  char *b = ring_base(v_ba);
+  uint32_t *h = ring_header(b, Long_val(v_cursor));
+  double t = Double_val(v_timeout);
+  int timeout = t < 0. ? -1 : t * 1000. > 2147483647. ? -1 : (int) (t * 1000.);
+  struct pollfd pfd;
+  eventfd_t cnt;
+  int ret = 0, err = 0;
+
+  __atomic_store_n(ring_u32(b, RING_PARKED), 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(h, __ATOMIC_ACQUIRE) == 0)
+  {
+    pfd.fd = Int_val(v_efd);
+    pfd.events = POLLIN;
+    caml_enter_blocking_section();
+    ret = poll(&pfd, 1, timeout);
+    err = errno;
+    if (ret > 0 && eventfd_read(pfd.fd, &cnt) == -1)
+    {
+      ret = -1;
+      err = errno;
+    }
+    caml_leave_blocking_section();
+  }
+  __atomic_store_n(ring_u32(b, RING_PARKED), 0, __ATOMIC_RELAXED);
+
+  if (ret == -1 && err != EINTR && err != EAGAIN)
+    caml_unix_error(err, "Ring.wait", Nothing);
+
+  CAMLreturn(Val_bool(__atomic_load_n(h, __ATOMIC_ACQUIRE) != 0));
+}
+
+#endif
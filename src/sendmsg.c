@@ -8,9 +8,78 @@
  */
 
 #define EXTUNIX_WANT_SENDMSG
+#define EXTUNIX_WANT_SENDFDS
+#define EXTUNIX_WANT_MMSG
+#define EXTUNIX_WANT_UDP_GSO
+#define EXTUNIX_WANT_ZEROCOPY
 
 #include "config.h"
 
+#if defined(EXTUNIX_HAVE_SENDMSG) || defined(EXTUNIX_HAVE_MMSG) || defined(EXTUNIX_HAVE_UDP_GSO) || defined(EXTUNIX_HAVE_ZEROCOPY)
+
+/* same order as Unix.msg_flag */
+static const int msg_flag_table[] = { MSG_OOB, MSG_DONTROUTE, MSG_PEEK };
+
+#endif
+
+#if defined(EXTUNIX_HAVE_SENDMSG) || defined(EXTUNIX_HAVE_UDP_GSO) || defined(EXTUNIX_HAVE_ZEROCOPY)
+
+/* Bigarray variants, the payload is described by an 'a iov array and
+   transferred without copies. More than IOV_MAX slices fail with
+   EMSGSIZE rather than being clamped, which would truncate a datagram. */
+
+/* Sends the slices of [iov_val] with the address and control data
+   already set in [msg], raises on error */
+static ssize_t ba_sendmsg(int fd, struct msghdr *msg, value iov_val, int flags, const char *name)
+{
+  size_t count;
+  ssize_t ret;
+  int err;
+
+  if (Wosize_val(iov_val) > IOV_MAX)
+    caml_unix_error(EMSGSIZE, name, Nothing);
+  msg->msg_iov = extunix_iovec_of_array(iov_val, name, &count);
+  msg->msg_iovlen = count;
+
+  caml_enter_blocking_section();
+  ret = sendmsg(fd, msg, flags);
+  err = errno;
+  caml_leave_blocking_section();
+
+  caml_stat_free(msg->msg_iov);
+
+  if (ret == -1)
+    caml_unix_error(err, name, Nothing);
+  return ret;
+}
+
+/* Receives into the slices of [iov_val], [msg] may carry a control
+   buffer, raises on error */
+static ssize_t ba_recvmsg(int fd, struct msghdr *msg, value iov_val, int flags, const char *name)
+{
+  size_t count;
+  ssize_t len;
+  int err;
+
+  if (Wosize_val(iov_val) > IOV_MAX)
+    caml_unix_error(EMSGSIZE, name, Nothing);
+  msg->msg_iov = extunix_iovec_of_array(iov_val, name, &count);
+  msg->msg_iovlen = count;
+
+  caml_enter_blocking_section();
+  len = recvmsg(fd, msg, flags);
+  err = errno;
+  caml_leave_blocking_section();
+
+  caml_stat_free(msg->msg_iov);
+
+  if (len == -1)
+    caml_unix_error(err, name, Nothing);
+  return len;
+}
+
+#endif
+
 #if defined(EXTUNIX_HAVE_SENDMSG)
 
 CAMLprim value caml_extunix_sendmsg(value fd_val, value sendfd_val, value data_val)
@@ -144,4 +213,682 @@ CAMLprim value caml_extunix_recvmsg(value fd_val)
   CAMLreturn (res);
 }
 
+CAMLprim value caml_extunixba_sendmsg(value fd_val, value sendfd_val, value iov_val, value flags_val)
+{
+  CAMLparam4(fd_val, sendfd_val, iov_val, flags_val);
+  struct msghdr msg;
+  int flags = caml_convert_flag_list(flags_val, msg_flag_table);
+  int sendfd = -1;
+
+#if defined(CMSG_SPACE)
+  union {
+    struct cmsghdr cmsg; /* for alignment */
+    char control[CMSG_SPACE(sizeof(int))]; /* sizeof sendfd */
+  } control_un;
+#endif
+
+  memset(&msg, 0, sizeof msg);
+
+  if (sendfd_val != Val_none)
+  {
+    sendfd = Int_val(Some_val(sendfd_val));
+#if defined(CMSG_SPACE)
+    struct cmsghdr *cmsgp;
+
+    msg.msg_control = control_un.control;
+    msg.msg_controllen = CMSG_LEN(sizeof sendfd);
+
+    cmsgp = CMSG_FIRSTHDR(&msg);
+    cmsgp->cmsg_len = CMSG_LEN(sizeof sendfd);
+    cmsgp->cmsg_level = SOL_SOCKET;
+    cmsgp->cmsg_type = SCM_RIGHTS;
+    *(int *)CMSG_DATA(cmsgp) = sendfd;
+#else
+    msg.msg_accrights = (caddr_t)&sendfd;
+    msg.msg_accrightslen = sizeof sendfd;
+#endif
+  }
+
+  CAMLreturn(Val_long(ba_sendmsg(Int_val(fd_val), &msg, iov_val, flags, "sendmsg")));
+}
+
+/* Returns { recv_len; recv_fd; recv_flags } */
+CAMLprim value caml_extunixba_recvmsg(value fd_val, value iov_val, value flags_val)
+{
+  CAMLparam3(fd_val, iov_val, flags_val);
+  CAMLlocal3(res, some_fd, list);
+  struct msghdr msg;
+  int flags = caml_convert_flag_list(flags_val, msg_flag_table);
+  int recvfd = -1, have_fd = 0, msg_flags = 0;
+  ssize_t len;
+
+#if defined(CMSG_SPACE)
+  union {
+    struct cmsghdr cmsg; /* just for alignment */
+    char control[CMSG_SPACE(sizeof recvfd)];
+  } control_un;
+  struct cmsghdr *cmsgp;
+
+  memset(&msg, 0, sizeof msg);
+  msg.msg_control = control_un.control;
+  msg.msg_controllen = sizeof control_un.control;
+#else
+  memset(&msg, 0, sizeof msg);
+  msg.msg_accrights = (caddr_t)&recvfd;
+  msg.msg_accrightslen = sizeof recvfd;
+#endif
+
+  len = ba_recvmsg(Int_val(fd_val), &msg, iov_val, flags, "recvmsg");
+
+#if defined(CMSG_SPACE)
+  msg_flags = msg.msg_flags;
+  for (cmsgp = CMSG_FIRSTHDR(&msg); cmsgp != NULL; cmsgp = CMSG_NXTHDR(&msg, cmsgp))
+  {
+    if (cmsgp->cmsg_level == SOL_SOCKET && cmsgp->cmsg_type == SCM_RIGHTS
+        && cmsgp->cmsg_len == CMSG_LEN(sizeof recvfd))
+    {
+      memcpy(&recvfd, CMSG_DATA(cmsgp), sizeof recvfd);
+      have_fd = 1;
+    }
+  }
+#else
+  have_fd = msg.msg_accrightslen == sizeof recvfd;
+#endif
+
+  /* same order as ExtUnix.recv_flag */
+  list = Val_emptylist;
+  if (msg_flags & MSG_CTRUNC)
+  {
+    value cell = caml_alloc_small(2, Tag_cons);
+    Field(cell, 0) = Val_int(1);
+    Field(cell, 1) = list;
+    list = cell;
+  }
+  if (msg_flags & MSG_TRUNC)
+  {
+    value cell = caml_alloc_small(2, Tag_cons);
+    Field(cell, 0) = Val_int(0);
+    Field(cell, 1) = list;
+    list = cell;
+  }
+
+  if (have_fd)
+  {
+    some_fd = caml_alloc(1, 0);
+    Store_field(some_fd, 0, Val_int(recvfd));
+  }
+  else
+    some_fd = Val_none;
+
+  res = caml_alloc_tuple(3);
+  Store_field(res, 0, Val_long(len));
+  Store_field(res, 1, some_fd);
+  Store_field(res, 2, list);
+  CAMLreturn(res);
+}
+
 #endif /* EXTUNIX_HAVE_SENDMSG */
+
+#if defined(EXTUNIX_HAVE_SENDFDS)
+
+/* Kernel limit of descriptors per SCM_RIGHTS message, not exported */
+#ifndef SCM_MAX_FD
+#define SCM_MAX_FD 253
+#endif
+
+/* Sends [v_len] descriptors of [v_fds] starting at [v_ofs] with a one
+   byte message, bounds are checked on the OCaml side */
+CAMLprim value caml_extunix_sendfds(value v_sock, value v_fds, value v_ofs, value v_len)
+{
+  CAMLparam4(v_sock, v_fds, v_ofs, v_len);
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsgp;
+  intnat ofs = Long_val(v_ofs), n = Long_val(v_len), i;
+  char byte = 1;
+  ssize_t ret;
+  int err;
+  union {
+    struct cmsghdr cmsg; /* for alignment */
+    char control[CMSG_SPACE(SCM_MAX_FD * sizeof(int))];
+  } control_un;
+
+  if (n <= 0 || n > SCM_MAX_FD)
+    caml_invalid_argument("sendfds");
+
+  memset(&msg, 0, sizeof msg);
+  memset(&control_un, 0, sizeof control_un);
+  msg.msg_control = control_un.control;
+  msg.msg_controllen = CMSG_SPACE(n * sizeof(int));
+  cmsgp = CMSG_FIRSTHDR(&msg);
+  cmsgp->cmsg_len = CMSG_LEN(n * sizeof(int));
+  cmsgp->cmsg_level = SOL_SOCKET;
+  cmsgp->cmsg_type = SCM_RIGHTS;
+  for (i = 0; i < n; i++)
+  {
+    int fd = Int_val(Field(v_fds, ofs + i));
+    memcpy(CMSG_DATA(cmsgp) + i * sizeof(int), &fd, sizeof fd);
+  }
+
+  iov.iov_base = &byte;
+  iov.iov_len = 1;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  caml_enter_blocking_section();
+  ret = sendmsg(Int_val(v_sock), &msg, 0);
+  err = errno;
+  caml_leave_blocking_section();
+
+  if (ret == -1)
+    caml_unix_error(err, "sendfds", Nothing);
+  CAMLreturn(Val_unit);
+}
+
+/* Receives one message sent by sendfds, returns the descriptors */
+CAMLprim value caml_extunix_recvfds(value v_sock, value v_cloexec)
+{
+  CAMLparam2(v_sock, v_cloexec);
+  CAMLlocal1(v_fds);
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsgp;
+  int fds[SCM_MAX_FD];
+  int n = 0, i, flags = 0, err;
+  char byte;
+  ssize_t ret;
+  union {
+    struct cmsghdr cmsg; /* for alignment */
+    char control[CMSG_SPACE(SCM_MAX_FD * sizeof(int))];
+  } control_un;
+
+  if (Bool_val(v_cloexec))
+    flags |= MSG_CMSG_CLOEXEC;
+
+  memset(&msg, 0, sizeof msg);
+  msg.msg_control = control_un.control;
+  msg.msg_controllen = sizeof control_un.control;
+  /* one byte at a time, so that a stream socket never returns the
+     descriptors of two messages together */
+  iov.iov_base = &byte;
+  iov.iov_len = 1;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  caml_enter_blocking_section();
+  ret = recvmsg(Int_val(v_sock), &msg, flags);
+  err = errno;
+  caml_leave_blocking_section();
+
+  if (ret == -1)
+    caml_unix_error(err, "recvfds", Nothing);
+
+  for (cmsgp = CMSG_FIRSTHDR(&msg); cmsgp != NULL; cmsgp = CMSG_NXTHDR(&msg, cmsgp))
+  {
+    if (cmsgp->cmsg_level == SOL_SOCKET && cmsgp->cmsg_type == SCM_RIGHTS)
+    {
+      int k = (cmsgp->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      if (k > SCM_MAX_FD - n) k = SCM_MAX_FD - n;
+      memcpy(fds + n, CMSG_DATA(cmsgp), k * sizeof(int));
+      n += k;
+    }
+  }
+  /* descriptors were dropped, e.g. because of RLIMIT_NOFILE: do not
+     return a partial set */
+  if (msg.msg_flags & MSG_CTRUNC)
+  {
+    for (i = 0; i < n; i++)
+      close(fds[i]);
+    caml_unix_error(EMFILE, "recvfds", Nothing);
+  }
+  if (ret == 0 && n == 0)
+    caml_raise_end_of_file();
+
+  if (Bool_val(v_cloexec) && MSG_CMSG_CLOEXEC == 0)
+    for (i = 0; i < n; i++)
+      fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+
+  v_fds = caml_alloc_tuple(n);
+  for (i = 0; i < n; i++)
+    Field(v_fds, i) = Val_int(fds[i]);
+  CAMLreturn(v_fds);
+}
+
+#endif /* EXTUNIX_HAVE_SENDFDS */
+
+#if defined(EXTUNIX_HAVE_MMSG)
+
+/*
+ * recvmmsg and sendmmsg over a slab of fixed size slots.
+ * Same field order as ExtUnix.Mmsg.t : buf, slot, lens, addrs, addr_lens,
+ * truncated.
+ * Slot [i] holds datagram [i] at offset [i * slot] of [buf] and, when
+ * [addrs] is not empty, its address at offset [i * sizeof(sockaddr_storage)]
+ * of [addrs].
+ */
+
+#define MMSG_ADDR_SIZE (sizeof(struct sockaddr_storage))
+
+/* Returns the number of slots, raises if the slab is inconsistent */
+static intnat mmsg_check(value v_mm, int *have_addrs, const char *name)
+{
+  struct caml_ba_array *buf = Caml_ba_array_val(Field(v_mm, 0));
+  struct caml_ba_array *addrs = Caml_ba_array_val(Field(v_mm, 3));
+  intnat slot = Long_val(Field(v_mm, 1));
+  intnat count = Wosize_val(Field(v_mm, 2));
+
+  if (slot <= 0 || count > buf->dim[0] / slot || (intnat) Wosize_val(Field(v_mm, 4)) != count
+      || (intnat) Wosize_val(Field(v_mm, 5)) != count)
+    caml_invalid_argument(name);
+  *have_addrs = addrs->dim[0] != 0;
+  if (*have_addrs && count > addrs->dim[0] / (intnat) MMSG_ADDR_SIZE)
+    caml_invalid_argument(name);
+  return count;
+}
+
+/* Builds the headers of slots [ofs, ofs + len), when [sending] the
+   lengths are taken from the slab (after validation) instead of the slot size */
+static struct mmsghdr *mmsg_prepare(value v_mm, intnat ofs, intnat len, int sending, int *have_addrs, const char *name)
+{
+  value v_lens = Field(v_mm, 2), v_addr_lens = Field(v_mm, 4);
+  char *buf = Caml_ba_data_val(Field(v_mm, 0));
+  char *addrs = Caml_ba_data_val(Field(v_mm, 3));
+  intnat slot = Long_val(Field(v_mm, 1));
+  intnat i, j, count;
+  struct mmsghdr *hdrs;
+  struct iovec *iov;
+
+  count = mmsg_check(v_mm, have_addrs, name);
+  if (ofs < 0 || len < 0 || ofs > count - len)
+    caml_invalid_argument(name);
+  if (sending)
+    for (j = ofs; j < ofs + len; j++)
+    {
+      if (Long_val(Field(v_lens, j)) < 0 || Long_val(Field(v_lens, j)) > slot)
+        caml_invalid_argument(name);
+      if (*have_addrs && (Long_val(Field(v_addr_lens, j)) < 0 || Long_val(Field(v_addr_lens, j)) > (intnat) MMSG_ADDR_SIZE))
+        caml_invalid_argument(name);
+    }
+
+  /* one allocation per batch, the iovecs follow the headers */
+  hdrs = caml_stat_alloc((len > 0 ? len : 1) * (sizeof(struct mmsghdr) + sizeof(struct iovec)));
+  iov = (struct iovec *) (hdrs + len);
+  memset(hdrs, 0, len * sizeof(struct mmsghdr));
+  for (i = 0; i < len; i++)
+  {
+    j = ofs + i;
+    iov[i].iov_base = buf + j * slot;
+    iov[i].iov_len = sending ? Long_val(Field(v_lens, j)) : slot;
+    hdrs[i].msg_hdr.msg_iov = &iov[i];
+    hdrs[i].msg_hdr.msg_iovlen = 1;
+    if (*have_addrs)
+    {
+      socklen_t namelen = sending ? (socklen_t) Long_val(Field(v_addr_lens, j)) : (socklen_t) MMSG_ADDR_SIZE;
+      hdrs[i].msg_hdr.msg_name = namelen > 0 ? addrs + j * MMSG_ADDR_SIZE : NULL;
+      hdrs[i].msg_hdr.msg_namelen = namelen;
+    }
+  }
+  return hdrs;
+}
+
+CAMLprim value caml_extunix_mmsg_sockaddr_size(value v_unit)
+{
+  UNUSED(v_unit);
+  return Val_int(MMSG_ADDR_SIZE);
+}
+
+/* Receives up to [v_len] datagrams into slots starting at [v_ofs],
+   stores their lengths (and address lengths) and whether they were
+   truncated, returns their number */
+CAMLprim value caml_extunix_mmsg_recv(value v_fd, value v_mm, value v_ofs, value v_len, value v_flags, value v_waitforone, value v_timeout)
+{
+  CAMLparam5(v_fd, v_mm, v_ofs, v_len, v_flags);
+  CAMLxparam2(v_waitforone, v_timeout);
+  intnat ofs = Long_val(v_ofs), len = Long_val(v_len);
+  int flags = caml_convert_flag_list(v_flags, msg_flag_table);
+  struct timespec ts, *pts = NULL;
+  struct mmsghdr *hdrs;
+  int have_addrs, ret, err, i;
+
+  if (Bool_val(v_waitforone))
+    flags |= MSG_WAITFORONE;
+  if (Is_some(v_timeout))
+  {
+    double t = Double_val(Some_val(v_timeout));
+    if (!(t >= 0.))
+      caml_invalid_argument("Mmsg.recv");
+    ts.tv_sec = (time_t) t;
+    ts.tv_nsec = (long) ((t - (double) ts.tv_sec) * 1e9);
+    pts = &ts;
+  }
+  hdrs = mmsg_prepare(v_mm, ofs, len, 0, &have_addrs, "Mmsg.recv");
+  if (len == 0)
+  {
+    caml_stat_free(hdrs);
+    CAMLreturn(Val_int(0));
+  }
+
+  caml_enter_blocking_section();
+  ret = recvmmsg(Int_val(v_fd), hdrs, len > UINT_MAX ? UINT_MAX : (unsigned int) len, flags, pts);
+  err = errno;
+  caml_leave_blocking_section();
+
+  if (ret == -1)
+  {
+    caml_stat_free(hdrs);
+    caml_unix_error(err, "recvmmsg", Nothing);
+  }
+  for (i = 0; i < ret; i++)
+  {
+    Field(Field(v_mm, 2), ofs + i) = Val_long(hdrs[i].msg_len);
+    Field(Field(v_mm, 5), ofs + i) = Val_bool(hdrs[i].msg_hdr.msg_flags & MSG_TRUNC);
+    if (have_addrs)
+      Field(Field(v_mm, 4), ofs + i) = Val_long(hdrs[i].msg_hdr.msg_namelen);
+  }
+  caml_stat_free(hdrs);
+
+  CAMLreturn(Val_int(ret));
+}
+
+CAMLprim value caml_extunix_mmsg_recv_bytecode(value *argv, int argn)
+{
+  UNUSED(argn);
+  return caml_extunix_mmsg_recv(argv[0], argv[1], argv[2], argv[3], argv[4], argv[5], argv[6]);
+}
+
+/* Sends the datagrams of slots [v_ofs, v_ofs + v_len) with their stored
+   lengths, to their stored addresses if any, returns the number sent */
+CAMLprim value caml_extunix_mmsg_send(value v_fd, value v_mm, value v_ofs, value v_len, value v_flags)
+{
+  CAMLparam5(v_fd, v_mm, v_ofs, v_len, v_flags);
+  intnat len = Long_val(v_len);
+  int flags = caml_convert_flag_list(v_flags, msg_flag_table);
+  struct mmsghdr *hdrs;
+  int have_addrs, ret, err;
+
+  hdrs = mmsg_prepare(v_mm, Long_val(v_ofs), len, 1, &have_addrs, "Mmsg.send");
+  if (len == 0)
+  {
+    caml_stat_free(hdrs);
+    CAMLreturn(Val_int(0));
+  }
+
+  caml_enter_blocking_section();
+  ret = sendmmsg(Int_val(v_fd), hdrs, len > UINT_MAX ? UINT_MAX : (unsigned int) len, flags);
+  err = errno;
+  caml_leave_blocking_section();
+
+  caml_stat_free(hdrs);
+  if (ret == -1)
+    caml_unix_error(err, "sendmmsg", Nothing);
+
+  CAMLreturn(Val_int(ret));
+}
+
+static char *mmsg_addr_slot(value v_mm, value v_i, const char *name)
+{
+  intnat i = Long_val(v_i);
+  int have_addrs;
+  intnat count = mmsg_check(v_mm, &have_addrs, name);
+
+  if (!have_addrs || i < 0 || i >= count)
+    caml_invalid_argument(name);
+  return (char *) Caml_ba_data_val(Field(v_mm, 3)) + i * MMSG_ADDR_SIZE;
+}
+
+/* Decodes the address of slot [v_i] as a Unix.sockaddr */
+CAMLprim value caml_extunix_mmsg_addr(value v_mm, value v_i)
+{
+  CAMLparam2(v_mm, v_i);
+  CAMLlocal2(v_addr, v_res);
+  struct sockaddr_storage ss;
+  socklen_t namelen;
+
+  memcpy(&ss, mmsg_addr_slot(v_mm, v_i, "Mmsg.addr"), sizeof ss);
+  namelen = Long_val(Field(Field(v_mm, 4), Long_val(v_i)));
+
+  if (namelen < offsetof(struct sockaddr, sa_family) + sizeof ss.ss_family)
+    ss.ss_family = AF_UNIX; /* unnamed */
+  switch (ss.ss_family)
+  {
+  case AF_INET:
+  {
+    struct sockaddr_in *sin = (struct sockaddr_in *) &ss;
+    if (namelen < sizeof *sin)
+      caml_unix_error(EINVAL, "Mmsg.addr", Nothing);
+    v_addr = caml_alloc_initialized_string(4, (char *) &sin->sin_addr);
+    v_res = caml_alloc_small(2, 1);
+    Field(v_res, 0) = v_addr;
+    Field(v_res, 1) = Val_int(ntohs(sin->sin_port));
+    break;
+  }
+#if defined(AF_INET6)
+  case AF_INET6:
+  {
+    struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) &ss;
+    if (namelen < sizeof *sin6)
+      caml_unix_error(EINVAL, "Mmsg.addr", Nothing);
+    v_addr = caml_alloc_initialized_string(16, (char *) &sin6->sin6_addr);
+    v_res = caml_alloc_small(2, 1);
+    Field(v_res, 0) = v_addr;
+    Field(v_res, 1) = Val_int(ntohs(sin6->sin6_port));
+    break;
+  }
+#endif
+  case AF_UNIX:
+  {
+    struct sockaddr_un *sa_un = (struct sockaddr_un *) &ss;
+    size_t path_len = namelen > offsetof(struct sockaddr_un, sun_path) ? namelen - offsetof(struct sockaddr_un, sun_path) : 0;
+    if (path_len > sizeof sa_un->sun_path)
+      path_len = sizeof sa_un->sun_path;
+    /* abstract addresses start with a NUL byte and are not terminated */
+    if (path_len > 0 && sa_un->sun_path[0] != '\0')
+      path_len = strnlen(sa_un->sun_path, path_len);
+    v_addr = caml_alloc_initialized_string(path_len, sa_un->sun_path);
+    v_res = caml_alloc_small(1, 0);
+    Field(v_res, 0) = v_addr;
+    break;
+  }
+  default:
+    caml_unix_error(EAFNOSUPPORT, "Mmsg.addr", Nothing);
+  }
+  CAMLreturn(v_res);
+}
+
+/* Stores the Unix.sockaddr [v_addr] as the destination of slot [v_i] */
+CAMLprim value caml_extunix_mmsg_set_addr(value v_mm, value v_i, value v_addr)
+{
+  CAMLparam3(v_mm, v_i, v_addr);
+  struct sockaddr_storage ss;
+  socklen_t namelen;
+  char *slot = mmsg_addr_slot(v_mm, v_i, "Mmsg.set_addr");
+  value v_host;
+
+  memset(&ss, 0, sizeof ss);
+  switch (Tag_val(v_addr))
+  {
+  case 0: /* ADDR_UNIX */
+  {
+    struct sockaddr_un *sa_un = (struct sockaddr_un *) &ss;
+    mlsize_t path_len = caml_string_length(Field(v_addr, 0));
+    if (path_len >= sizeof sa_un->sun_path)
+      caml_unix_error(ENAMETOOLONG, "Mmsg.set_addr", Nothing);
+    sa_un->sun_family = AF_UNIX;
+    memcpy(sa_un->sun_path, String_val(Field(v_addr, 0)), path_len);
+    namelen = offsetof(struct sockaddr_un, sun_path) + path_len;
+    break;
+  }
+  default: /* ADDR_INET */
+    v_host = Field(v_addr, 0);
+    if (caml_string_length(v_host) == 4)
+    {
+      struct sockaddr_in *sin = (struct sockaddr_in *) &ss;
+      sin->sin_family = AF_INET;
+      memcpy(&sin->sin_addr, String_val(v_host), 4);
+      sin->sin_port = htons(Int_val(Field(v_addr, 1)));
+      namelen = sizeof *sin;
+    }
+#if defined(AF_INET6)
+    else if (caml_string_length(v_host) == 16)
+    {
+      struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) &ss;
+      sin6->sin6_family = AF_INET6;
+      memcpy(&sin6->sin6_addr, String_val(v_host), 16);
+      sin6->sin6_port = htons(Int_val(Field(v_addr, 1)));
+      namelen = sizeof *sin6;
+    }
+#endif
+    else
+      caml_unix_error(EAFNOSUPPORT, "Mmsg.set_addr", Nothing);
+    break;
+  }
+  memcpy(slot, &ss, sizeof ss);
+  Field(Field(v_mm, 4), Long_val(v_i)) = Val_long(namelen);
+  CAMLreturn(Val_unit);
+}
+
+#endif /* EXTUNIX_HAVE_MMSG */
+
+#if defined(EXTUNIX_HAVE_UDP_GSO)
+
+/*
+ * UDP generic segmentation and receive offloads: the payload of one
+ * call is a train of datagrams of the segment size (the last one may be
+ * shorter), split by the kernel on send and coalesced on receive.
+ */
+
+CAMLprim value caml_extunixba_sendmsg_gso(value fd_val, value gso_size_val, value iov_val, value flags_val)
+{
+  CAMLparam4(fd_val, gso_size_val, iov_val, flags_val);
+  struct msghdr msg;
+  struct cmsghdr *cmsgp;
+  intnat gso_size = Long_val(gso_size_val);
+  uint16_t segment;
+  int flags = caml_convert_flag_list(flags_val, msg_flag_table);
+  union {
+    struct cmsghdr cmsg; /* for alignment */
+    char control[CMSG_SPACE(sizeof(uint16_t))];
+  } control_un;
+
+  if (gso_size <= 0 || gso_size > UINT16_MAX)
+    caml_invalid_argument("sendmsg_gso");
+  segment = gso_size;
+
+  memset(&msg, 0, sizeof msg);
+  memset(&control_un, 0, sizeof control_un);
+  msg.msg_control = control_un.control;
+  msg.msg_controllen = sizeof control_un.control;
+  cmsgp = CMSG_FIRSTHDR(&msg);
+  cmsgp->cmsg_level = SOL_UDP;
+  cmsgp->cmsg_type = UDP_SEGMENT;
+  cmsgp->cmsg_len = CMSG_LEN(sizeof segment);
+  memcpy(CMSG_DATA(cmsgp), &segment, sizeof segment);
+
+  CAMLreturn(Val_long(ba_sendmsg(Int_val(fd_val), &msg, iov_val, flags, "sendmsg_gso")));
+}
+
+/* Returns (length, segment size), the segment size is 0 unless the
+   kernel coalesced several datagrams (UDP_GRO must be enabled) */
+CAMLprim value caml_extunixba_recvmsg_gro(value fd_val, value iov_val, value flags_val)
+{
+  CAMLparam3(fd_val, iov_val, flags_val);
+  CAMLlocal1(res);
+  struct msghdr msg;
+  struct cmsghdr *cmsgp;
+  int flags = caml_convert_flag_list(flags_val, msg_flag_table);
+  int segment = 0;
+  ssize_t len;
+  union {
+    struct cmsghdr cmsg; /* just for alignment */
+    char control[CMSG_SPACE(sizeof(int))];
+  } control_un;
+
+  memset(&msg, 0, sizeof msg);
+  msg.msg_control = control_un.control;
+  msg.msg_controllen = sizeof control_un.control;
+
+  len = ba_recvmsg(Int_val(fd_val), &msg, iov_val, flags, "recvmsg_gro");
+
+  for (cmsgp = CMSG_FIRSTHDR(&msg); cmsgp != NULL; cmsgp = CMSG_NXTHDR(&msg, cmsgp))
+  {
+    if (cmsgp->cmsg_level == SOL_UDP && cmsgp->cmsg_type == UDP_GRO
+        && cmsgp->cmsg_len >= CMSG_LEN(sizeof segment))
+      memcpy(&segment, CMSG_DATA(cmsgp), sizeof segment);
+  }
+
+  res = caml_alloc_tuple(2);
+  Store_field(res, 0, Val_long(len));
+  Store_field(res, 1, Val_int(segment));
+  CAMLreturn(res);
+}
+
+#endif /* EXTUNIX_HAVE_UDP_GSO */
+
+#if defined(EXTUNIX_HAVE_ZEROCOPY)
+
+/*
+ * MSG_ZEROCOPY transmission: the kernel keeps references to the pages of
+ * the buffers after sendmsg returns and reports on the socket error queue
+ * when it released them. Every successful call is numbered by a 32 bit
+ * counter and notifications carry inclusive ranges of these numbers.
+ */
+
+CAMLprim value caml_extunixba_send_zerocopy(value fd_val, value iov_val, value flags_val)
+{
+  CAMLparam3(fd_val, iov_val, flags_val);
+  struct msghdr msg;
+  int flags = caml_convert_flag_list(flags_val, msg_flag_table) | MSG_ZEROCOPY;
+
+  memset(&msg, 0, sizeof msg);
+  CAMLreturn(Val_long(ba_sendmsg(Int_val(fd_val), &msg, iov_val, flags, "send_zerocopy")));
+}
+
+/* Drains the error queue of [fd_val] without blocking, storing each
+   completion as a (first, last, copied) triple into the int array
+   [res_val] until it is full. Other error queue entries are discarded.
+   Returns the number of triples. */
+CAMLprim value caml_extunix_zerocopy_reap(value fd_val, value res_val)
+{
+  CAMLparam2(fd_val, res_val);
+  long max = Wosize_val(res_val) / 3;
+  long n = 0;
+  struct msghdr msg;
+  struct cmsghdr *cmsgp;
+  struct sock_extended_err serr;
+  union {
+    struct cmsghdr cmsg; /* just for alignment */
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+  } control_un;
+
+  while (n < max)
+  {
+    memset(&msg, 0, sizeof msg);
+    msg.msg_control = control_un.control;
+    msg.msg_controllen = sizeof control_un.control;
+    if (recvmsg(Int_val(fd_val), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK || n > 0)
+        break;
+      caml_uerror("zerocopy_reap", Nothing);
+    }
+    for (cmsgp = CMSG_FIRSTHDR(&msg); cmsgp != NULL; cmsgp = CMSG_NXTHDR(&msg, cmsgp))
+    {
+      if (!((cmsgp->cmsg_level == IPPROTO_IP && cmsgp->cmsg_type == IP_RECVERR)
+            || (cmsgp->cmsg_level == IPPROTO_IPV6 && cmsgp->cmsg_type == IPV6_RECVERR)))
+        continue;
+      memcpy(&serr, CMSG_DATA(cmsgp), sizeof serr);
+      if (serr.ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr.ee_errno != 0)
+        continue;
+      Store_field(res_val, 3 * n, Val_long(serr.ee_info));
+      Store_field(res_val, 3 * n + 1, Val_long(serr.ee_data));
+      Store_field(res_val, 3 * n + 2, Val_bool(serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED));
+      n++;
+    }
+  }
+
+  CAMLreturn(Val_long(n));
+}
+
+#endif /* EXTUNIX_HAVE_ZEROCOPY */
@@ -2,6 +2,8 @@
 #define EXTUNIX_WANT_TCP_KEEPIDLE
 #define EXTUNIX_WANT_TCP_KEEPCNT
 #define EXTUNIX_WANT_TCP_KEEPINTVL
+#define EXTUNIX_WANT_UDP_SEGMENT
+#define EXTUNIX_WANT_UDP_GRO
 #include "config.h"
 
 #if defined(EXTUNIX_HAVE_SOCKOPT)
@@ -46,6 +48,18 @@
 #define SO_LOCK_FILTER (-1)
 #endif
 
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT (-1)
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO (-1)
+#endif
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY (-1)
+#endif
+
 struct option {
   int opt;
   int level;
@@ -61,6 +75,9 @@ static struct option tcp_options[] = {
   { SO_DETACH_FILTER, SOL_SOCKET },
   { SO_DETACH_BPF, SOL_SOCKET },
   { SO_LOCK_FILTER, SOL_SOCKET },
+  { UDP_SEGMENT, IPPROTO_UDP },
+  { UDP_GRO, IPPROTO_UDP },
+  { SO_ZEROCOPY, SOL_SOCKET },
 };
 
 CAMLprim value caml_extunix_have_sockopt(value k)
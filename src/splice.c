@@ -2,6 +2,7 @@
 #define EXTUNIX_WANT_VMSPLICE
 #define EXTUNIX_WANT_SPLICE
 #define EXTUNIX_WANT_TEE
+#define EXTUNIX_WANT_SPLICE_PUMP
 #include "config.h"
 #include "common.h"
 
@@ -16,24 +17,16 @@ static const int splice_flags_table[] =
 #endif
 
 #if defined(EXTUNIX_HAVE_SPLICE)
-CAMLprim value caml_extunix_splice(value v_fd_in, value v_off_in, value v_fd_out, value v_off_out, value v_len, value v_flags)
+static value splice_common(value v_fd_in, loff_t* off_in_p, value v_fd_out, loff_t* off_out_p, value v_len, value v_flags)
 {
-  CAMLparam5(v_fd_in, v_off_in, v_fd_out, v_off_out, v_len);
-  CAMLxparam1(v_flags);
+  CAMLparam4(v_fd_in, v_fd_out, v_len, v_flags);
 
   unsigned int flags = caml_convert_flag_list(v_flags, splice_flags_table);
   int fd_in = Int_val(v_fd_in);
   int fd_out = Int_val(v_fd_out);
-  loff_t off_in;
-  loff_t off_out;
-  loff_t* off_in_p = NULL;
-  loff_t* off_out_p = NULL;
-  size_t len = Int_val(v_len);
+  size_t len = Long_val(v_len);
   ssize_t ret;
 
-  if(Is_some(v_off_in)) { off_in = Int_val(Some_val(v_off_in)); off_in_p = &off_in; }
-  if(Is_some(v_off_out)) { off_out = Int_val(Some_val(v_off_out)); off_out_p = &off_out; }
-
   caml_enter_blocking_section();
   ret = splice(fd_in, off_in_p, fd_out, off_out_p, len, flags);
   caml_leave_blocking_section();
@@ -44,6 +37,19 @@ CAMLprim value caml_extunix_splice(value v_fd_in, value v_off_in, value v_fd_out
   CAMLreturn(Val_long(ret));
 }
 
+CAMLprim value caml_extunix_splice(value v_fd_in, value v_off_in, value v_fd_out, value v_off_out, value v_len, value v_flags)
+{
+  loff_t off_in;
+  loff_t off_out;
+  loff_t* off_in_p = NULL;
+  loff_t* off_out_p = NULL;
+
+  if(Is_some(v_off_in)) { off_in = Long_val(Some_val(v_off_in)); off_in_p = &off_in; }
+  if(Is_some(v_off_out)) { off_out = Long_val(Some_val(v_off_out)); off_out_p = &off_out; }
+
+  return splice_common(v_fd_in, off_in_p, v_fd_out, off_out_p, v_len, v_flags);
+}
+
 CAMLprim value caml_extunix_splice_bytecode(value * argv, int argn)
 {
   (void)argn;
@@ -51,6 +57,26 @@ CAMLprim value caml_extunix_splice_bytecode(value * argv, int argn)
                              argv[3], argv[4], argv[5]);
 }
 
+CAMLprim value caml_extunix_splice64(value v_fd_in, value v_off_in, value v_fd_out, value v_off_out, value v_len, value v_flags)
+{
+  loff_t off_in;
+  loff_t off_out;
+  loff_t* off_in_p = NULL;
+  loff_t* off_out_p = NULL;
+
+  if(Is_some(v_off_in)) { off_in = Int64_val(Some_val(v_off_in)); off_in_p = &off_in; }
+  if(Is_some(v_off_out)) { off_out = Int64_val(Some_val(v_off_out)); off_out_p = &off_out; }
+
+  return splice_common(v_fd_in, off_in_p, v_fd_out, off_out_p, v_len, v_flags);
+}
+
+CAMLprim value caml_extunix_splice64_bytecode(value * argv, int argn)
+{
+  (void)argn;
+  return caml_extunix_splice64(argv[0], argv[1], argv[2],
+                               argv[3], argv[4], argv[5]);
+}
+
 #endif
 
 #if defined(EXTUNIX_HAVE_TEE)
@@ -62,7 +88,7 @@ CAMLprim value caml_extunix_tee(value v_fd_in, value v_fd_out, value v_len, valu
   unsigned int flags = caml_convert_flag_list(v_flags, splice_flags_table);
   int fd_in = Int_val(v_fd_in);
   int fd_out = Int_val(v_fd_out);
-  size_t len = Int_val(v_len);
+  size_t len = Long_val(v_len);
   ssize_t ret;
 
   caml_enter_blocking_section();
@@ -120,3 +146,194 @@ CAMLprim value caml_extunixba_vmsplice(value v_fd_out, value v_iov, value v_flag
 }
 
 #endif
+
+#if defined(EXTUNIX_HAVE_SPLICE_PUMP)
+
+/* One direction of the relay: in -> pipe -> out */
+struct pump {
+  int in, out;
+  int pipe[2];
+  size_t pending; /* bytes sitting in the pipe */
+  uint64_t bytes; /* bytes delivered to out */
+  int eof;
+};
+
+#define PUMP_FLAGS (SPLICE_F_MOVE | SPLICE_F_NONBLOCK)
+
+static int pump_open(struct pump *p, int in, int out, int pipe_size)
+{
+  p->in = in;
+  p->out = out;
+  p->pending = 0;
+  p->bytes = 0;
+  p->eof = 0;
+  if (pipe2(p->pipe, O_NONBLOCK | O_CLOEXEC) == -1)
+    return -1;
+  /* may fail above /proc/sys/fs/pipe-max-size, keep the default then */
+  if (pipe_size > 0)
+    (void) fcntl(p->pipe[1], F_SETPIPE_SZ, pipe_size);
+  return 0;
+}
+
+static void pump_close(struct pump *p)
+{
+  close(p->pipe[0]);
+  close(p->pipe[1]);
+}
+
+/* Moves whatever can be moved without blocking.
+   Returns the number of bytes moved or -1 on error. */
+static ssize_t pump_step(struct pump *p, uint64_t *budget)
+{
+  ssize_t n, moved = 0;
+
+  if (!p->eof && *budget > 0)
+  {
+    size_t len = *budget > (1 << 30) ? (1 << 30) : (size_t) *budget;
+    n = splice(p->in, NULL, p->pipe[1], NULL, len, PUMP_FLAGS);
+    if (n > 0) { p->pending += n; *budget -= n; moved += n; }
+    else if (n == 0) p->eof = 1;
+    else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return -1;
+  }
+  if (p->pending > 0)
+  {
+    n = splice(p->pipe[0], NULL, p->out, NULL, p->pending, PUMP_FLAGS);
+    if (n > 0) { p->pending -= n; p->bytes += n; moved += n; }
+    else if (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return -1;
+  }
+  return moved;
+}
+
+static int pump_finished(struct pump *p)
+{
+  return p->eof && p->pending == 0;
+}
+
+/* SPLICE_F_NONBLOCK only applies to the pipe end, splicing from or to a
+   blocking socket still blocks, so the sockets are switched to
+   non-blocking mode for the duration of the relay. Returns the previous
+   flags or -1 on error. */
+static int pump_set_nonblock(int fd)
+{
+  int flags = fcntl(fd, F_GETFL);
+  if (flags == -1)
+    return -1;
+  if (!(flags & O_NONBLOCK) && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+    return -1;
+  return flags;
+}
+
+static void pump_restore_flags(int fd, int flags)
+{
+  if (!(flags & O_NONBLOCK))
+    (void) fcntl(fd, F_SETFL, flags);
+}
+
+CAMLprim value caml_extunix_splice_pump(value v_fd1, value v_fd2, value v_pipe_size, value v_max_bytes, value v_timeout)
+{
+  CAMLparam5(v_fd1, v_fd2, v_pipe_size, v_max_bytes, v_timeout);
+  CAMLlocal1(v_ret);
+  struct pump p[2];
+  uint64_t budget = Long_val(v_max_bytes);
+  int timeout = -1;
+  int i, r, nfds, err = 0;
+  ssize_t moved;
+  struct pollfd fds[4];
+  int flags1, flags2;
+
+  if (Is_some(v_timeout))
+  {
+    double t = Double_val(Some_val(v_timeout)) * 1000.;
+    timeout = t > 2147483647. ? -1 : (int) t; /* too far away, wait forever */
+  }
+  if ((flags1 = pump_set_nonblock(Int_val(v_fd1))) == -1)
+    caml_uerror("fcntl", Nothing);
+  if ((flags2 = pump_set_nonblock(Int_val(v_fd2))) == -1)
+  {
+    err = errno;
+    pump_restore_flags(Int_val(v_fd1), flags1);
+    caml_unix_error(err, "fcntl", Nothing);
+  }
+  if (pump_open(&p[0], Int_val(v_fd1), Int_val(v_fd2), Int_val(v_pipe_size)) == -1)
+  {
+    err = errno;
+    pump_restore_flags(Int_val(v_fd1), flags1);
+    pump_restore_flags(Int_val(v_fd2), flags2);
+    caml_unix_error(err, "pipe2", Nothing);
+  }
+  if (pump_open(&p[1], Int_val(v_fd2), Int_val(v_fd1), Int_val(v_pipe_size)) == -1)
+  {
+    err = errno;
+    pump_close(&p[0]);
+    pump_restore_flags(Int_val(v_fd1), flags1);
+    pump_restore_flags(Int_val(v_fd2), flags2);
+    caml_unix_error(err, "pipe2", Nothing);
+  }
+
+  caml_enter_blocking_section();
+  while (1)
+  {
+    moved = 0;
+    for (i = 0; i < 2 && err == 0; i++)
+    {
+      ssize_t n = pump_step(&p[i], &budget);
+      if (n == -1) err = errno; else moved += n;
+      /* propagate the end of stream once everything was delivered */
+      if (err == 0 && pump_finished(&p[i]) && p[i].eof == 1)
+      {
+        shutdown(p[i].out, SHUT_WR);
+        p[i].eof = 2;
+      }
+    }
+    if (err != 0) break;
+    if (pump_finished(&p[0]) && pump_finished(&p[1])) break;
+    if (budget == 0 && p[0].pending == 0 && p[1].pending == 0) break;
+    if (moved > 0) continue;
+
+    /* nothing could move, wait. A direction with data in its pipe is
+       blocked on the output, and its input can not make progress until
+       the pipe drains (polling it would spin on a full pipe) */
+    nfds = 0;
+    for (i = 0; i < 2; i++)
+    {
+      if (!p[i].eof && budget > 0 && p[i].pending == 0)
+      {
+        fds[nfds].fd = p[i].in;
+        fds[nfds].events = POLLIN;
+        nfds++;
+      }
+      if (p[i].pending > 0)
+      {
+        fds[nfds].fd = p[i].out;
+        fds[nfds].events = POLLOUT;
+        nfds++;
+      }
+    }
+    /* data in the pipes can not be handed back, so only time out when
+       they are empty */
+    r = poll(fds, nfds, (p[0].pending == 0 && p[1].pending == 0) ? timeout : -1);
+    if (r == 0) break;
+    if (r == -1)
+    {
+      if (errno == EINTR && p[0].pending == 0 && p[1].pending == 0) break;
+      if (errno != EINTR) { err = errno; break; }
+    }
+  }
+  caml_leave_blocking_section();
+
+  pump_close(&p[0]);
+  pump_close(&p[1]);
+  pump_restore_flags(Int_val(v_fd1), flags1);
+  pump_restore_flags(Int_val(v_fd2), flags2);
+  if (err != 0)
+    caml_unix_error(err, "splice", Nothing);
+
+  v_ret = caml_alloc(4, 0);
+  Store_field(v_ret, 0, Val_long(p[0].bytes));
+  Store_field(v_ret, 1, Val_long(p[1].bytes));
+  Store_field(v_ret, 2, Val_bool(p[0].eof));
+  Store_field(v_ret, 3, Val_bool(p[1].eof));
+  CAMLreturn(v_ret);
+}
+
+#endif
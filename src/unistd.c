@@ -9,6 +9,8 @@
 #define EXTUNIX_WANT_PWRITE
 #define EXTUNIX_WANT_READ
 #define EXTUNIX_WANT_WRITE
+#define EXTUNIX_WANT_PREADV2
+#define EXTUNIX_WANT_PTHREAD_KEY
 #define EXTUNIX_WANT_GETTID
 #define EXTUNIX_WANT_CHROOT
 #include "config.h"
@@ -185,6 +187,103 @@ enum mode_bits {
     BIT_NOINTR = 1 << 2
 };
 
+#if defined(EXTUNIX_HAVE_PREAD) || defined(EXTUNIX_HAVE_PWRITE) || defined(EXTUNIX_HAVE_READ) || defined(EXTUNIX_HAVE_WRITE) || defined(EXTUNIX_HAVE_PREADV2)
+
+/* Large transfers go through a heap staging buffer of up to
+   STAGING_MAX bytes, so that a big request costs one system call (and
+   one release of the runtime lock) instead of one per UNIX_BUFFER_SIZE
+   chunk. The largest buffer is kept per thread and reused by the next
+   call, so steady-state transfers do not allocate. A buffer is taken out
+   of the cache while in use, which keeps nested calls (e.g. from signal
+   handlers run on leaving the blocking section) safe. Falls back to the
+   stack buffer if the allocation fails. */
+#define STAGING_MAX (16 * 1024 * 1024)
+
+struct staging {
+    char *buf;
+    size_t size;
+};
+
+#if defined(EXTUNIX_HAVE_PTHREAD_KEY)
+
+static pthread_key_t staging_key;
+static pthread_once_t staging_once = PTHREAD_ONCE_INIT;
+static int staging_key_ok = 0;
+
+static void staging_destroy(void *p)
+{
+    struct staging *s = p;
+    free(s->buf);
+    free(s);
+}
+
+static void staging_init(void)
+{
+    staging_key_ok = (pthread_key_create(&staging_key, staging_destroy) == 0);
+}
+
+static struct staging *staging_get(void)
+{
+    struct staging *s;
+    pthread_once(&staging_once, staging_init);
+    if (!staging_key_ok) return NULL;
+    s = pthread_getspecific(staging_key);
+    if (s == NULL) {
+	s = calloc(1, sizeof(*s));
+	if (s != NULL && pthread_setspecific(staging_key, s) != 0) {
+	    free(s);
+	    s = NULL;
+	}
+    }
+    return s;
+}
+
+#else
+
+static struct staging *staging_get(void) { return NULL; }
+
+#endif
+
+static char *staging_alloc(size_t len, char *stackbuf, size_t *size)
+{
+    char *buf;
+    struct staging *s;
+    if (len > UNIX_BUFFER_SIZE) {
+	if (len > STAGING_MAX) len = STAGING_MAX;
+	s = staging_get();
+	if (s != NULL && s->buf != NULL && s->size >= len) {
+	    buf = s->buf;
+	    *size = s->size;
+	    s->buf = NULL;
+	    s->size = 0;
+	    return buf;
+	}
+	buf = malloc(len);
+	if (buf != NULL) {
+	    *size = len;
+	    return buf;
+	}
+    }
+    *size = UNIX_BUFFER_SIZE;
+    return stackbuf;
+}
+
+static void staging_free(char *buf, char *stackbuf, size_t size)
+{
+    struct staging *s;
+    if (buf == stackbuf) return;
+    s = staging_get();
+    if (s != NULL && s->size < size) {
+	free(s->buf);
+	s->buf = buf;
+	s->size = size;
+    } else {
+	free(buf);
+    }
+}
+
+#endif
+
 #if defined(EXTUNIX_HAVE_PREAD)
 
 /*  Copyright © 2012 Goswin von Brederlow <goswin-v-b@web.de>   */
@@ -192,14 +291,17 @@ enum mode_bits {
 CAMLprim value caml_extunix_pread_common(value v_fd, off_t off, value v_buf, value v_ofs, value v_len, int mode) {
     CAMLparam4(v_fd, v_buf, v_ofs, v_len);
     ssize_t ret;
+    int err;
     size_t fd = Int_val(v_fd);
     size_t ofs = Long_val(v_ofs);
     size_t len = Long_val(v_len);
     size_t processed = 0;
-    char iobuf[UNIX_BUFFER_SIZE];
+    char stackbuf[UNIX_BUFFER_SIZE];
+    size_t bufsize;
+    char *iobuf = staging_alloc(len, stackbuf, &bufsize);
 
     while(len > 0) {
-	size_t numbytes = (len > UNIX_BUFFER_SIZE) ? UNIX_BUFFER_SIZE : len;
+	size_t numbytes = (len > bufsize) ? bufsize : len;
 	caml_enter_blocking_section();
 	ret = pread(fd, iobuf, numbytes, off);
 	caml_leave_blocking_section();
@@ -210,7 +312,9 @@ CAMLprim value caml_extunix_pread_common(value v_fd, off_t off, value v_buf, val
 		if (errno == EAGAIN || errno == EWOULDBLOCK) break;
 		if (mode & BIT_NOERROR) break;
 	    }
-	    caml_uerror("pread", Nothing);
+	    err = errno;
+	    staging_free(iobuf, stackbuf, bufsize);
+	    caml_unix_error(err, "pread", Nothing);
 	}
 	memcpy(&Byte(v_buf, ofs), iobuf, ret);
 	processed += ret;
@@ -220,6 +324,7 @@ CAMLprim value caml_extunix_pread_common(value v_fd, off_t off, value v_buf, val
 	if (mode & BIT_ONCE) break;
     }
 
+    staging_free(iobuf, stackbuf, bufsize);
     CAMLreturn(Val_long(processed));
 }
 
@@ -279,14 +384,17 @@ value caml_extunix_intr_pread64(value v_fd, value v_off, value v_buf, value v_of
 CAMLprim value caml_extunix_pwrite_common(value v_fd, off_t off, value v_buf, value v_ofs, value v_len, int mode) {
     CAMLparam4(v_fd, v_buf, v_ofs, v_len);
     ssize_t ret;
+    int err;
     size_t fd = Int_val(v_fd);
     size_t ofs = Long_val(v_ofs);
     size_t len = Long_val(v_len);
     size_t processed = 0;
-    char iobuf[UNIX_BUFFER_SIZE];
+    char stackbuf[UNIX_BUFFER_SIZE];
+    size_t bufsize;
+    char *iobuf = staging_alloc(len, stackbuf, &bufsize);
 
     while(len > 0) {
-	size_t numbytes = (len > UNIX_BUFFER_SIZE) ? UNIX_BUFFER_SIZE : len;
+	size_t numbytes = (len > bufsize) ? bufsize : len;
 	memcpy(iobuf, &Byte(v_buf, ofs), numbytes);
 	caml_enter_blocking_section();
 	ret = pwrite(fd, iobuf, numbytes, off);
@@ -298,7 +406,9 @@ CAMLprim value caml_extunix_pwrite_common(value v_fd, off_t off, value v_buf, va
 		if (errno == EAGAIN || errno == EWOULDBLOCK) break;
 		if (mode & BIT_NOERROR) break;
 	    }
-	    caml_uerror("pwrite", Nothing);
+	    err = errno;
+	    staging_free(iobuf, stackbuf, bufsize);
+	    caml_unix_error(err, "pwrite", Nothing);
 	}
 	processed += ret;
 	off += ret;
@@ -307,6 +417,7 @@ CAMLprim value caml_extunix_pwrite_common(value v_fd, off_t off, value v_buf, va
 	if (mode & BIT_ONCE) break;
     }
 
+    staging_free(iobuf, stackbuf, bufsize);
     CAMLreturn(Val_long(processed));
 }
 
@@ -366,14 +477,17 @@ value caml_extunix_intr_pwrite64(value v_fd, value v_off, value v_buf, value v_o
 CAMLprim value caml_extunix_read_common(value v_fd, value v_buf, value v_ofs, value v_len, int mode) {
     CAMLparam4(v_fd, v_buf, v_ofs, v_len);
     ssize_t ret;
+    int err;
     size_t fd = Int_val(v_fd);
     size_t ofs = Long_val(v_ofs);
     size_t len = Long_val(v_len);
     size_t processed = 0;
-    char iobuf[UNIX_BUFFER_SIZE];
+    char stackbuf[UNIX_BUFFER_SIZE];
+    size_t bufsize;
+    char *iobuf = staging_alloc(len, stackbuf, &bufsize);
 
     while(len > 0) {
-	size_t numbytes = (len > UNIX_BUFFER_SIZE) ? UNIX_BUFFER_SIZE : len;
+	size_t numbytes = (len > bufsize) ? bufsize : len;
 	caml_enter_blocking_section();
 	ret = read(fd, iobuf, numbytes);
 	caml_leave_blocking_section();
@@ -384,7 +498,9 @@ CAMLprim value caml_extunix_read_common(value v_fd, value v_buf, value v_ofs, va
 		if (errno == EAGAIN || errno == EWOULDBLOCK) break;
 		if (mode & BIT_NOERROR) break;
 	    }
-	    caml_uerror("read", Nothing);
+	    err = errno;
+	    staging_free(iobuf, stackbuf, bufsize);
+	    caml_unix_error(err, "read", Nothing);
 	}
 	memcpy(&Byte(v_buf, ofs), iobuf, ret);
 	processed += ret;
@@ -393,6 +509,7 @@ CAMLprim value caml_extunix_read_common(value v_fd, value v_buf, value v_ofs, va
 	if (mode & BIT_ONCE) break;
     }
 
+    staging_free(iobuf, stackbuf, bufsize);
     CAMLreturn(Val_long(processed));
 }
 
@@ -424,14 +541,17 @@ value caml_extunix_intr_read(value v_fd, value v_buf, value v_ofs, value v_len)
 CAMLprim value caml_extunix_write_common(value v_fd, value v_buf, value v_ofs, value v_len, int mode) {
     CAMLparam4(v_fd, v_buf, v_ofs, v_len);
     ssize_t ret;
+    int err;
     size_t fd = Int_val(v_fd);
     size_t ofs = Long_val(v_ofs);
     size_t len = Long_val(v_len);
     size_t processed = 0;
-    char iobuf[UNIX_BUFFER_SIZE];
+    char stackbuf[UNIX_BUFFER_SIZE];
+    size_t bufsize;
+    char *iobuf = staging_alloc(len, stackbuf, &bufsize);
 
     while(len > 0) {
-	size_t numbytes = (len > UNIX_BUFFER_SIZE) ? UNIX_BUFFER_SIZE : len;
+	size_t numbytes = (len > bufsize) ? bufsize : len;
 	memcpy(iobuf, &Byte(v_buf, ofs), numbytes);
 	caml_enter_blocking_section();
 	ret = write(fd, iobuf, numbytes);
@@ -443,7 +563,9 @@ CAMLprim value caml_extunix_write_common(value v_fd, value v_buf, value v_ofs, v
 		if (errno == EAGAIN || errno == EWOULDBLOCK) break;
 		if (mode & BIT_NOERROR) break;
 	    }
-	    caml_uerror("write", Nothing);
+	    err = errno;
+	    staging_free(iobuf, stackbuf, bufsize);
+	    caml_unix_error(err, "write", Nothing);
 	}
 	processed += ret;
 	ofs += ret;
@@ -451,6 +573,7 @@ CAMLprim value caml_extunix_write_common(value v_fd, value v_buf, value v_ofs, v
 	if (mode & BIT_ONCE) break;
     }
 
+    staging_free(iobuf, stackbuf, bufsize);
     CAMLreturn(Val_long(processed));
 }
 
@@ -475,6 +598,120 @@ value caml_extunix_intr_write(value v_fd, value v_buf, value v_ofs, value v_len)
 }
 #endif
 
+#if defined(EXTUNIX_HAVE_PREADV2)
+
+static const int rwf_flags_table[] = {
+    RWF_HIPRI, RWF_DSYNC, RWF_SYNC, RWF_NOWAIT, RWF_APPEND
+};
+
+/* With RWF_NOWAIT the call does not block, so the runtime lock is kept
+   and the data is transferred directly from/to the OCaml buffer.
+   Otherwise the transfer goes through the staging buffer outside of the
+   blocking section, hence at most STAGING_MAX bytes per call. */
+
+CAMLprim value caml_extunix_preadv2(value v_fd, value v_off, value v_buf, value v_ofs, value v_len, value v_flags)
+{
+    CAMLparam5(v_fd, v_off, v_buf, v_ofs, v_len);
+    CAMLxparam1(v_flags);
+    CAMLlocal1(v_res);
+    ssize_t ret;
+    int fd = Int_val(v_fd);
+    off_t off = Long_val(v_off);
+    size_t ofs = Long_val(v_ofs);
+    size_t len = Long_val(v_len);
+    int flags = caml_convert_flag_list(v_flags, rwf_flags_table);
+    char stackbuf[UNIX_BUFFER_SIZE];
+    char *iobuf;
+    size_t bufsize;
+    struct iovec iov;
+    int err;
+
+    if (flags & RWF_NOWAIT) {
+	iov.iov_base = &Byte(v_buf, ofs);
+	iov.iov_len = len;
+	ret = preadv2(fd, &iov, 1, off, flags);
+	err = errno;
+    } else {
+	iobuf = staging_alloc(len, stackbuf, &bufsize);
+	iov.iov_base = iobuf;
+	iov.iov_len = (len > bufsize) ? bufsize : len;
+	caml_enter_blocking_section();
+	ret = preadv2(fd, &iov, 1, off, flags);
+	err = errno;
+	caml_leave_blocking_section();
+	if (ret > 0)
+	    memcpy(&Byte(v_buf, ofs), iobuf, ret);
+	staging_free(iobuf, stackbuf, bufsize);
+    }
+    if (ret == -1) {
+	if ((flags & RWF_NOWAIT) && (err == EAGAIN || err == EWOULDBLOCK))
+	    CAMLreturn(Val_none);
+	caml_unix_error(err, "preadv2", Nothing);
+    }
+
+    v_res = caml_alloc(1, 0);
+    Store_field(v_res, 0, Val_long(ret));
+    CAMLreturn(v_res);
+}
+
+CAMLprim value caml_extunix_preadv2_bytecode(value *argv, int argn)
+{
+    (void)argn;
+    return caml_extunix_preadv2(argv[0], argv[1], argv[2], argv[3], argv[4], argv[5]);
+}
+
+CAMLprim value caml_extunix_pwritev2(value v_fd, value v_off, value v_buf, value v_ofs, value v_len, value v_flags)
+{
+    CAMLparam5(v_fd, v_off, v_buf, v_ofs, v_len);
+    CAMLxparam1(v_flags);
+    CAMLlocal1(v_res);
+    ssize_t ret;
+    int fd = Int_val(v_fd);
+    off_t off = Long_val(v_off);
+    size_t ofs = Long_val(v_ofs);
+    size_t len = Long_val(v_len);
+    int flags = caml_convert_flag_list(v_flags, rwf_flags_table);
+    char stackbuf[UNIX_BUFFER_SIZE];
+    char *iobuf;
+    size_t bufsize;
+    struct iovec iov;
+    int err;
+
+    if (flags & RWF_NOWAIT) {
+	iov.iov_base = (char *)String_val(v_buf) + ofs;
+	iov.iov_len = len;
+	ret = pwritev2(fd, &iov, 1, off, flags);
+	err = errno;
+    } else {
+	iobuf = staging_alloc(len, stackbuf, &bufsize);
+	iov.iov_base = iobuf;
+	iov.iov_len = (len > bufsize) ? bufsize : len;
+	memcpy(iobuf, String_val(v_buf) + ofs, iov.iov_len);
+	caml_enter_blocking_section();
+	ret = pwritev2(fd, &iov, 1, off, flags);
+	err = errno;
+	caml_leave_blocking_section();
+	staging_free(iobuf, stackbuf, bufsize);
+    }
+    if (ret == -1) {
+	if ((flags & RWF_NOWAIT) && (err == EAGAIN || err == EWOULDBLOCK))
+	    CAMLreturn(Val_none);
+	caml_unix_error(err, "pwritev2", Nothing);
+    }
+
+    v_res = caml_alloc(1, 0);
+    Store_field(v_res, 0, Val_long(ret));
+    CAMLreturn(v_res);
+}
+
+CAMLprim value caml_extunix_pwritev2_bytecode(value *argv, int argn)
+{
+    (void)argn;
+    return caml_extunix_pwritev2(argv[0], argv[1], argv[2], argv[3], argv[4], argv[5]);
+}
+
+#endif
+
 #if defined(EXTUNIX_HAVE_CHROOT)
 
 CAMLprim value caml_extunix_chroot(value v_path)
@@ -0,0 +1,754 @@
+
+#define EXTUNIX_WANT_URING
+#define EXTUNIX_WANT_URING_NET
+#include "config.h"
+
+#if defined(EXTUNIX_HAVE_URING)
+
+/*
+ * io_uring bindings on top of the raw system calls (no liburing).
+ *
+ * Every submission carries a slot number in user_data, the OCaml side
+ * maps slots to user ids and keeps the referenced buffers alive until
+ * the completion is reaped. Memory that must outlive the prep call
+ * (paths, timespecs) is owned by the slot and released on reaping.
+ */
+
+#if OCAML_VERSION < 50100
+#define caml_unix_error_of_code unix_error_of_code
+#endif
+
+#ifndef IORING_CQE_F_MORE
+#define IORING_CQE_F_MORE (1U << 1)
+#endif
+
+struct uring {
+  int fd;
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+  unsigned sq_entries;
+  unsigned sq_local_tail;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  unsigned cq_entries;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ring, *cq_ring;
+  size_t sq_ring_size, cq_ring_size, sqes_size;
+  void **owned;
+};
+
+#define Uring_val(v) (*((struct uring **) Data_custom_val(v)))
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+  return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+  return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args)
+{
+  return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void uring_free(struct uring *r)
+{
+  unsigned i;
+
+  if (r->sqes != NULL) munmap(r->sqes, r->sqes_size);
+  if (r->cq_ring != NULL && r->cq_ring != r->sq_ring) munmap(r->cq_ring, r->cq_ring_size);
+  if (r->sq_ring != NULL) munmap(r->sq_ring, r->sq_ring_size);
+  if (r->fd >= 0) close(r->fd);
+  if (r->owned != NULL)
+  {
+    for (i = 0; i < r->cq_entries; i++)
+      caml_stat_free(r->owned[i]);
+    caml_stat_free(r->owned);
+  }
+  caml_stat_free(r);
+}
+
+static void uring_finalize(value v_ring)
+{
+  if (Uring_val(v_ring) != NULL)
+  {
+    uring_free(Uring_val(v_ring));
+    Uring_val(v_ring) = NULL;
+  }
+}
+
+static struct custom_operations uring_ops = {
+  "extunix.uring",
+  uring_finalize,
+  custom_compare_default, custom_hash_default,
+  custom_serialize_default, custom_deserialize_default,
+#if defined(custom_compare_ext_default)
+  custom_compare_ext_default,
+#endif
+#if defined(custom_fixed_length_default)
+  custom_fixed_length_default,
+#endif
+};
+
+static struct uring *uring_of_value(value v_ring)
+{
+  struct uring *r = Uring_val(v_ring);
+  if (r == NULL)
+    caml_unix_error(EBADF, "io_uring", Nothing);
+  return r;
+}
+
+static void *uring_mmap(int fd, size_t size, off_t offset)
+{
+  void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+  return (ptr == MAP_FAILED) ? NULL : ptr;
+}
+
+CAMLprim value caml_extunix_uring_create(value v_entries)
+{
+  CAMLparam1(v_entries);
+  CAMLlocal1(v_ring);
+  struct io_uring_params p;
+  struct uring *r;
+  char *sq, *cq;
+  int fd, err;
+
+  memset(&p, 0, sizeof p);
+  p.flags = IORING_SETUP_CLAMP;
+  fd = sys_io_uring_setup(Int_val(v_entries), &p);
+  if (fd < 0)
+    caml_uerror("io_uring_setup", Nothing);
+
+  r = caml_stat_alloc(sizeof *r);
+  memset(r, 0, sizeof *r);
+  r->fd = fd;
+  r->sq_entries = p.sq_entries;
+  r->cq_entries = p.cq_entries;
+  r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  r->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (r->cq_ring_size > r->sq_ring_size)
+      r->sq_ring_size = r->cq_ring_size;
+    r->cq_ring_size = r->sq_ring_size;
+  }
+
+  r->sq_ring = uring_mmap(fd, r->sq_ring_size, IORING_OFF_SQ_RING);
+  if (r->sq_ring == NULL) goto error;
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    r->cq_ring = r->sq_ring;
+  else
+    r->cq_ring = uring_mmap(fd, r->cq_ring_size, IORING_OFF_CQ_RING);
+  if (r->cq_ring == NULL) goto error;
+  r->sqes = uring_mmap(fd, r->sqes_size, IORING_OFF_SQES);
+  if (r->sqes == NULL) goto error;
+
+  sq = r->sq_ring;
+  r->sq_head = (unsigned *) (sq + p.sq_off.head);
+  r->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+  r->sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+  r->sq_array = (unsigned *) (sq + p.sq_off.array);
+  r->sq_local_tail = *r->sq_tail;
+  cq = r->cq_ring;
+  r->cq_head = (unsigned *) (cq + p.cq_off.head);
+  r->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+  r->cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+
+  r->owned = caml_stat_alloc(r->cq_entries * sizeof(void *));
+  memset(r->owned, 0, r->cq_entries * sizeof(void *));
+
+  v_ring = caml_alloc_custom(&uring_ops, sizeof(struct uring *), 0, 1);
+  Uring_val(v_ring) = r;
+  CAMLreturn(v_ring);
+
+error:
+  err = errno;
+  uring_free(r);
+  caml_unix_error(err, "io_uring_setup", Nothing);
+}
+
+CAMLprim value caml_extunix_uring_close(value v_ring)
+{
+  uring_finalize(v_ring);
+  return Val_unit;
+}
+
+CAMLprim value caml_extunix_uring_cq_entries(value v_ring)
+{
+  return Val_int(uring_of_value(v_ring)->cq_entries);
+}
+
+/* user_data of the entries that are not tied to a slot (linked timeouts),
+   their completions are not reported */
+#define URING_INTERNAL ((__u64) -1)
+
+static unsigned uring_sq_space(struct uring *r)
+{
+  return r->sq_entries - (r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE));
+}
+
+static struct io_uring_sqe *uring_next_sqe(struct uring *r, __u64 user_data)
+{
+  unsigned idx = r->sq_local_tail & *r->sq_mask;
+  struct io_uring_sqe *sqe = &r->sqes[idx];
+
+  memset(sqe, 0, sizeof *sqe);
+  sqe->user_data = user_data;
+  r->sq_array[idx] = idx;
+  r->sq_local_tail++;
+  return sqe;
+}
+
+/* Raises unless [v_slot] is a valid completion slot */
+static void uring_check_slot(struct uring *r, value v_slot)
+{
+  if ((unsigned) Long_val(v_slot) >= r->cq_entries)
+    caml_invalid_argument("Uring: invalid slot");
+}
+
+/* Returns the next free submission queue entry, or NULL when the queue
+   does not have room for [n] entries (the others are then taken with
+   uring_next_sqe). The entry becomes visible to the kernel on the next
+   enter. */
+static struct io_uring_sqe *uring_get_sqes(struct uring *r, value v_slot, unsigned n)
+{
+  uring_check_slot(r, v_slot);
+  if (uring_sq_space(r) < n)
+    return NULL;
+  return uring_next_sqe(r, Long_val(v_slot));
+}
+
+static struct io_uring_sqe *uring_get_sqe(struct uring *r, value v_slot)
+{
+  return uring_get_sqes(r, v_slot, 1);
+}
+
+static char *uring_slice(value v_iov, const char *name, unsigned *len)
+{
+  value v_buf = Field(v_iov, 0);
+  intnat ofs = Long_val(Field(v_iov, 1));
+  intnat size = Long_val(Field(v_iov, 2));
+
+  if (ofs < 0 || size < 0 || ofs > Caml_ba_array_val(v_buf)->dim[0] - size || size > (intnat) UINT_MAX)
+    caml_invalid_argument(name);
+  *len = size;
+  return (char *) Caml_ba_data_val(v_buf) + ofs;
+}
+
+CAMLprim value caml_extunix_uring_prep_rw(value v_ring, value v_slot, value v_write, value v_fd, value v_iov, value v_off, value v_index)
+{
+  struct uring *r = uring_of_value(v_ring);
+  int write = Bool_val(v_write);
+  int index = Int_val(v_index);
+  unsigned len;
+  char *buf = uring_slice(v_iov, write ? "Uring.prep_write" : "Uring.prep_read", &len);
+  struct io_uring_sqe *sqe = uring_get_sqe(r, v_slot);
+
+  if (sqe == NULL)
+    return Val_false;
+  if (index < 0)
+    sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+  else
+  {
+    sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+    sqe->buf_index = index;
+  }
+  sqe->fd = Int_val(v_fd);
+  sqe->addr = (uintptr_t) buf;
+  sqe->len = len;
+  sqe->off = (__u64) Long_val(v_off);
+  return Val_true;
+}
+
+CAMLprim value caml_extunix_uring_prep_rw_bytecode(value *argv, int argn)
+{
+  (void)argn;
+  return caml_extunix_uring_prep_rw(argv[0], argv[1], argv[2], argv[3], argv[4], argv[5], argv[6]);
+}
+
+CAMLprim value caml_extunix_uring_prep_fsync(value v_ring, value v_slot, value v_fd, value v_datasync)
+{
+  struct uring *r = uring_of_value(v_ring);
+  struct io_uring_sqe *sqe = uring_get_sqe(r, v_slot);
+
+  if (sqe == NULL)
+    return Val_false;
+  sqe->opcode = IORING_OP_FSYNC;
+  sqe->fd = Int_val(v_fd);
+  sqe->fsync_flags = Bool_val(v_datasync) ? IORING_FSYNC_DATASYNC : 0;
+  return Val_true;
+}
+
+CAMLprim value caml_extunix_uring_prep_fallocate(value v_ring, value v_slot, value v_fd, value v_off, value v_len)
+{
+  struct uring *r = uring_of_value(v_ring);
+  struct io_uring_sqe *sqe = uring_get_sqe(r, v_slot);
+
+  if (sqe == NULL)
+    return Val_false;
+  sqe->opcode = IORING_OP_FALLOCATE;
+  sqe->fd = Int_val(v_fd);
+  sqe->off = Long_val(v_off);
+  sqe->addr = Long_val(v_len);
+  sqe->len = 0; /* mode */
+  return Val_true;
+}
+
+/* Queues cancellation of the operation in [v_slot], the completion of
+   the cancel request itself is not reported */
+CAMLprim value caml_extunix_uring_prep_cancel(value v_ring, value v_slot)
+{
+  struct uring *r = uring_of_value(v_ring);
+  struct io_uring_sqe *sqe;
+
+  uring_check_slot(r, v_slot);
+  if (uring_sq_space(r) < 1)
+    return Val_false;
+  sqe = uring_next_sqe(r, URING_INTERNAL);
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = Long_val(v_slot);
+  return Val_true;
+}
+
+CAMLprim value caml_extunix_uring_prep_openat(value v_ring, value v_slot, value v_dirfd, value v_path, value v_flags, value v_perm)
+{
+  struct uring *r = uring_of_value(v_ring);
+  int flags = extunix_open_flags(v_flags);
+  struct io_uring_sqe *sqe;
+  char *path;
+
+  if (!caml_string_is_c_safe(v_path))
+    caml_invalid_argument("Uring.prep_openat");
+  sqe = uring_get_sqe(r, v_slot);
+  if (sqe == NULL)
+    return Val_false;
+  path = caml_stat_strdup(String_val(v_path));
+  caml_stat_free(r->owned[Long_val(v_slot)]);
+  r->owned[Long_val(v_slot)] = path;
+  sqe->opcode = IORING_OP_OPENAT;
+  sqe->fd = Is_some(v_dirfd) ? Int_val(Some_val(v_dirfd)) : AT_FDCWD;
+  sqe->addr = (uintptr_t) path;
+  sqe->len = Int_val(v_perm);
+  sqe->open_flags = flags | O_CLOEXEC;
+  return Val_true;
+}
+
+CAMLprim value caml_extunix_uring_prep_openat_bytecode(value *argv, int argn)
+{
+  (void)argn;
+  return caml_extunix_uring_prep_openat(argv[0], argv[1], argv[2], argv[3], argv[4], argv[5]);
+}
+
+CAMLprim value caml_extunix_uring_prep_statx(value v_ring, value v_slot, value v_dirfd, value v_path, value v_nofollow, value v_buf)
+{
+  struct uring *r = uring_of_value(v_ring);
+  struct io_uring_sqe *sqe;
+  char *path;
+
+  if (!caml_string_is_c_safe(v_path) || caml_ba_byte_size(Caml_ba_array_val(v_buf)) < sizeof(struct statx))
+    caml_invalid_argument("Uring.prep_statx");
+  sqe = uring_get_sqe(r, v_slot);
+  if (sqe == NULL)
+    return Val_false;
+  path = caml_stat_strdup(String_val(v_path));
+  caml_stat_free(r->owned[Long_val(v_slot)]);
+  r->owned[Long_val(v_slot)] = path;
+  sqe->opcode = IORING_OP_STATX;
+  sqe->fd = Is_some(v_dirfd) ? Int_val(Some_val(v_dirfd)) : AT_FDCWD;
+  sqe->addr = (uintptr_t) path;
+  sqe->len = STATX_BASIC_STATS;
+  sqe->off = (uintptr_t) Caml_ba_data_val(v_buf);
+  sqe->statx_flags = Bool_val(v_nofollow) ? AT_SYMLINK_NOFOLLOW : 0;
+  return Val_true;
+}
+
+CAMLprim value caml_extunix_uring_prep_statx_bytecode(value *argv, int argn)
+{
+  (void)argn;
+  return caml_extunix_uring_prep_statx(argv[0], argv[1], argv[2], argv[3], argv[4], argv[5]);
+}
+
+CAMLprim value caml_extunix_uring_submit(value v_ring, value v_wait)
+{
+  CAMLparam2(v_ring, v_wait);
+  struct uring *r = uring_of_value(v_ring);
+  unsigned wait = Int_val(v_wait);
+  unsigned to_submit;
+  int ret;
+
+  __atomic_store_n(r->sq_tail, r->sq_local_tail, __ATOMIC_RELEASE);
+  to_submit = r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+
+  if (wait == 0)
+  {
+    /* submission alone does not block, keep the runtime lock */
+    ret = (to_submit == 0) ? 0 : sys_io_uring_enter(r->fd, to_submit, 0, 0);
+  }
+  else
+  {
+    caml_enter_blocking_section();
+    ret = sys_io_uring_enter(r->fd, to_submit, wait, IORING_ENTER_GETEVENTS);
+    caml_leave_blocking_section();
+  }
+  if (ret < 0)
+    caml_uerror("io_uring_enter", Nothing);
+
+  CAMLreturn(Val_int(ret));
+}
+
+/* Stores (slot, res, flags) triples into the int array [v_res] */
+CAMLprim value caml_extunix_uring_reap(value v_ring, value v_res)
+{
+  struct uring *r = uring_of_value(v_ring);
+  size_t max = Wosize_val(v_res) / 3;
+  size_t n = 0;
+  unsigned head = *r->cq_head;
+  unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+  struct io_uring_cqe *cqe;
+  __u64 slot;
+
+  while (n < max && head != tail)
+  {
+    cqe = &r->cqes[head & *r->cq_mask];
+    slot = cqe->user_data;
+    head++;
+    if (slot == URING_INTERNAL)
+      continue;
+    if (slot < r->cq_entries && !(cqe->flags & IORING_CQE_F_MORE))
+    {
+      caml_stat_free(r->owned[slot]);
+      r->owned[slot] = NULL;
+    }
+    Store_field(v_res, 3 * n, Val_long(slot));
+    Store_field(v_res, 3 * n + 1, Val_long(cqe->res));
+    Store_field(v_res, 3 * n + 2, Val_long(cqe->flags));
+    n++;
+  }
+  __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+
+  return Val_long(n);
+}
+
+CAMLprim value caml_extunix_uring_register_buffers(value v_ring, value v_iov)
+{
+  CAMLparam2(v_ring, v_iov);
+  struct uring *r = uring_of_value(v_ring);
+  size_t count;
+  struct iovec *iov = extunix_iovec_of_array(v_iov, "Uring.register_buffers", &count);
+  int ret, err;
+
+  /* pinning the pages may take a while */
+  caml_enter_blocking_section();
+  ret = sys_io_uring_register(r->fd, IORING_REGISTER_BUFFERS, iov, count);
+  err = errno;
+  caml_leave_blocking_section();
+  caml_stat_free(iov);
+  if (ret < 0)
+    caml_unix_error(err, "io_uring_register", Nothing);
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value caml_extunix_uring_unregister_buffers(value v_ring)
+{
+  CAMLparam1(v_ring);
+  struct uring *r = uring_of_value(v_ring);
+
+  if (sys_io_uring_register(r->fd, IORING_UNREGISTER_BUFFERS, NULL, 0) < 0)
+    caml_uerror("io_uring_register", Nothing);
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value caml_extunix_uring_error_of_result(value v_res)
+{
+  return caml_unix_error_of_code(-Int_val(v_res));
+}
+
+CAMLprim value caml_extunix_uring_statx_of_buffer(value v_buf)
+{
+  CAMLparam1(v_buf);
+  CAMLlocal1(v_st);
+  struct statx *st = Caml_ba_data_val(v_buf);
+
+  if (caml_ba_byte_size(Caml_ba_array_val(v_buf)) < sizeof(struct statx))
+    caml_invalid_argument("Uring.statx_of_buffer");
+
+  v_st = caml_alloc(9, 0);
+  Store_field(v_st, 0, Val_int(st->stx_mask));
+  Store_field(v_st, 1, Val_int(st->stx_mode));
+  Store_field(v_st, 2, Val_int(st->stx_nlink));
+  Store_field(v_st, 3, Val_int(st->stx_uid));
+  Store_field(v_st, 4, Val_int(st->stx_gid));
+  Store_field(v_st, 5, caml_copy_int64(st->stx_ino));
+  Store_field(v_st, 6, caml_copy_int64(st->stx_size));
+  Store_field(v_st, 7, caml_copy_int64(st->stx_blocks));
+  Store_field(v_st, 8, caml_copy_double((double) st->stx_mtime.tv_sec + st->stx_mtime.tv_nsec / 1e9));
+
+  CAMLreturn(v_st);
+}
+
+
+#if defined(EXTUNIX_HAVE_URING_NET)
+
+/* Provided buffer ring: the kernel picks buffers of [buf_size] bytes out
+   of one bigarray for multishot receives, the application hands them
+   back with recycle */
+struct uring_pbuf {
+  struct io_uring_buf_ring *br;
+  size_t size;
+  unsigned mask;
+  unsigned short tail;
+  char *base;
+  unsigned buf_size;
+};
+
+#define Pbuf_val(v) (*((struct uring_pbuf **) Data_custom_val(v)))
+
+static void uring_pbuf_finalize(value v_pbuf)
+{
+  struct uring_pbuf *pb = Pbuf_val(v_pbuf);
+  if (pb != NULL)
+  {
+    munmap(pb->br, pb->size);
+    caml_stat_free(pb);
+    Pbuf_val(v_pbuf) = NULL;
+  }
+}
+
+static struct custom_operations uring_pbuf_ops = {
+  "extunix.uring_pbuf",
+  uring_pbuf_finalize,
+  custom_compare_default, custom_hash_default,
+  custom_serialize_default, custom_deserialize_default,
+#if defined(custom_compare_ext_default)
+  custom_compare_ext_default,
+#endif
+#if defined(custom_fixed_length_default)
+  custom_fixed_length_default,
+#endif
+};
+
+static void uring_pbuf_add(struct uring_pbuf *pb, unsigned bid)
+{
+  struct io_uring_buf *buf = &pb->br->bufs[pb->tail & pb->mask];
+
+  buf->addr = (uintptr_t) (pb->base + (size_t) bid * pb->buf_size);
+  buf->len = pb->buf_size;
+  buf->bid = bid;
+  pb->tail++;
+}
+
+CAMLprim value caml_extunix_uring_register_buf_ring(value v_ring, value v_gid, value v_slab, value v_buf_size)
+{
+  CAMLparam4(v_ring, v_gid, v_slab, v_buf_size);
+  CAMLlocal1(v_pbuf);
+  struct uring *r = uring_of_value(v_ring);
+  intnat buf_size = Long_val(v_buf_size);
+  intnat count;
+  unsigned entries = 1, i;
+  struct io_uring_buf_reg reg;
+  struct uring_pbuf *pb;
+  long page = sysconf(_SC_PAGESIZE);
+  int err;
+
+  if (buf_size <= 0 || buf_size > (intnat) UINT_MAX || Int_val(v_gid) < 0 || Int_val(v_gid) > 0xFFFF)
+    caml_invalid_argument("Uring.setup_buf_ring");
+  count = Caml_ba_array_val(v_slab)->dim[0] / buf_size;
+  if (count == 0)
+    caml_invalid_argument("Uring.setup_buf_ring");
+  /* ring size must be a power of 2, at most 32768 */
+  while (entries * 2 <= count && entries < 32768)
+    entries *= 2;
+
+  pb = caml_stat_alloc(sizeof *pb);
+  pb->size = (entries * sizeof(struct io_uring_buf) + page - 1) & ~(page - 1);
+  pb->br = mmap(NULL, pb->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (pb->br == MAP_FAILED)
+  {
+    err = errno;
+    caml_stat_free(pb);
+    caml_unix_error(err, "mmap", Nothing);
+  }
+  pb->mask = entries - 1;
+  pb->tail = 0;
+  pb->base = Caml_ba_data_val(v_slab);
+  pb->buf_size = buf_size;
+
+  memset(&reg, 0, sizeof reg);
+  reg.ring_addr = (uintptr_t) pb->br;
+  reg.ring_entries = entries;
+  reg.bgid = Int_val(v_gid);
+  if (sys_io_uring_register(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+  {
+    err = errno;
+    munmap(pb->br, pb->size);
+    caml_stat_free(pb);
+    caml_unix_error(err, "io_uring_register", Nothing);
+  }
+
+  for (i = 0; i < entries; i++)
+    uring_pbuf_add(pb, i);
+  __atomic_store_n(&pb->br->tail, pb->tail, __ATOMIC_RELEASE);
+
+  v_pbuf = caml_alloc_custom(&uring_pbuf_ops, sizeof(struct uring_pbuf *), 0, 1);
+  Pbuf_val(v_pbuf) = pb;
+  CAMLreturn(v_pbuf);
+}
+
+CAMLprim value caml_extunix_uring_unregister_buf_ring(value v_ring, value v_gid)
+{
+  CAMLparam2(v_ring, v_gid);
+  struct uring *r = uring_of_value(v_ring);
+  struct io_uring_buf_reg reg;
+
+  memset(&reg, 0, sizeof reg);
+  reg.bgid = Int_val(v_gid);
+  if (sys_io_uring_register(r->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1) < 0)
+    caml_uerror("io_uring_register", Nothing);
+
+  CAMLreturn(Val_unit);
+}
+
+CAMLprim value caml_extunix_uring_buf_ring_entries(value v_pbuf)
+{
+  return Val_int(Pbuf_val(v_pbuf)->mask + 1);
+}
+
+/* noalloc */
+CAMLprim value caml_extunix_uring_recycle(value v_pbuf, value v_bid)
+{
+  struct uring_pbuf *pb = Pbuf_val(v_pbuf);
+
+  uring_pbuf_add(pb, Long_val(v_bid));
+  __atomic_store_n(&pb->br->tail, pb->tail, __ATOMIC_RELEASE);
+  return Val_unit;
+}
+
+CAMLprim value caml_extunix_uring_prep_accept_multishot(value v_ring, value v_slot, value v_fd)
+{
+  struct uring *r = uring_of_value(v_ring);
+  struct io_uring_sqe *sqe = uring_get_sqe(r, v_slot);
+
+  if (sqe == NULL)
+    return Val_false;
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = Int_val(v_fd);
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_CLOEXEC;
+  return Val_true;
+}
+
+CAMLprim value caml_extunix_uring_prep_recv_multishot(value v_ring, value v_slot, value v_fd, value v_gid)
+{
+  struct uring *r = uring_of_value(v_ring);
+  struct io_uring_sqe *sqe = uring_get_sqe(r, v_slot);
+
+  if (sqe == NULL)
+    return Val_false;
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = Int_val(v_fd);
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = Int_val(v_gid);
+  return Val_true;
+}
+
+/* Links a timeout of [v_timeout] seconds (float option) to [sqe], the
+   timespec lives in [ts] which must stay valid until submission */
+static void uring_link_timeout(struct uring *r, struct io_uring_sqe *sqe, value v_timeout, struct __kernel_timespec *ts)
+{
+  double t = Double_val(Some_val(v_timeout));
+  struct io_uring_sqe *tsqe;
+
+  ts->tv_sec = (long long) t;
+  ts->tv_nsec = (long long) ((t - (double) ts->tv_sec) * 1e9);
+  sqe->flags |= IOSQE_IO_LINK;
+  tsqe = uring_next_sqe(r, URING_INTERNAL);
+  tsqe->opcode = IORING_OP_LINK_TIMEOUT;
+  tsqe->fd = -1;
+  tsqe->addr = (uintptr_t) ts;
+  tsqe->len = 1;
+}
+
+static void uring_check_timeout(value v_timeout, const char *name)
+{
+  if (Is_some(v_timeout) && !(Double_val(Some_val(v_timeout)) >= 0.))
+    caml_invalid_argument(name);
+}
+
+CAMLprim value caml_extunix_uring_prep_send(value v_ring, value v_slot, value v_fd, value v_iov, value v_timeout)
+{
+  struct uring *r = uring_of_value(v_ring);
+  unsigned len;
+  char *buf = uring_slice(v_iov, "Uring.prep_send", &len);
+  struct io_uring_sqe *sqe;
+  struct __kernel_timespec *ts;
+
+  uring_check_timeout(v_timeout, "Uring.prep_send");
+  sqe = uring_get_sqes(r, v_slot, Is_some(v_timeout) ? 2 : 1);
+  if (sqe == NULL)
+    return Val_false;
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = Int_val(v_fd);
+  sqe->addr = (uintptr_t) buf;
+  sqe->len = len;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  if (Is_some(v_timeout))
+  {
+    ts = caml_stat_alloc(sizeof *ts);
+    caml_stat_free(r->owned[Long_val(v_slot)]);
+    r->owned[Long_val(v_slot)] = ts;
+    uring_link_timeout(r, sqe, v_timeout, ts);
+  }
+  return Val_true;
+}
+
+struct uring_msg {
+  struct msghdr msg;
+  struct __kernel_timespec ts;
+  struct iovec iov[];
+};
+
+CAMLprim value caml_extunix_uring_prep_sendmsg(value v_ring, value v_slot, value v_fd, value v_iovs, value v_timeout)
+{
+  struct uring *r = uring_of_value(v_ring);
+  size_t count;
+  struct iovec *iov;
+  struct uring_msg *m;
+  struct io_uring_sqe *sqe;
+
+  uring_check_slot(r, v_slot);
+  uring_check_timeout(v_timeout, "Uring.prep_sendmsg");
+  if (uring_sq_space(r) < (Is_some(v_timeout) ? 2u : 1u))
+    return Val_false;
+  iov = extunix_iovec_of_array(v_iovs, "Uring.prep_sendmsg", &count);
+  m = caml_stat_alloc(sizeof *m + count * sizeof(struct iovec));
+  memset(&m->msg, 0, sizeof m->msg);
+  memcpy(m->iov, iov, count * sizeof(struct iovec));
+  caml_stat_free(iov);
+  m->msg.msg_iov = m->iov;
+  m->msg.msg_iovlen = count;
+
+  sqe = uring_get_sqe(r, v_slot);
+  caml_stat_free(r->owned[Long_val(v_slot)]);
+  r->owned[Long_val(v_slot)] = m;
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = Int_val(v_fd);
+  sqe->addr = (uintptr_t) &m->msg;
+  sqe->len = 1;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  if (Is_some(v_timeout))
+    uring_link_timeout(r, sqe, v_timeout, &m->ts);
+  return Val_true;
+}
+
+#endif /* EXTUNIX_HAVE_URING_NET */
+
+#endif
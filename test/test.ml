@@ -345,12 +345,73 @@ let test_endian_string () =
   L.set_int64  l 10 (0x1032547698BADCFEL);
   assert_equal (Bytes.unsafe_to_string l) src
 
+let test_endian_float_string () =
+  require "unsafe_get_float64";
+  require "unsafe_get_int24";
+  let module B = BigEndian in
+  let module L = LittleEndian in
+  let module H = HostEndian in
+  let b = Bytes.make 16 '\000' in
+  B.set_float64 b 1 (-2.25);
+  assert_equal (Bytes.sub_string b 1 2) "\xc0\x02";
+  assert_equal (B.get_float64 (Bytes.unsafe_to_string b) 1) (-2.25);
+  assert_equal (B.get_int64 (Bytes.unsafe_to_string b) 1) (Int64.bits_of_float (-2.25));
+  L.set_float32 b 9 1.5;
+  assert_equal (Bytes.sub_string b 9 4) "\x00\x00\xc0\x3f";
+  assert_equal (L.get_float32 (Bytes.unsafe_to_string b) 9) 1.5;
+  H.set_float64 b 0 Float.pi;
+  assert_equal (H.get_float64 (Bytes.unsafe_to_string b) 0) Float.pi;
+  B.set_int24 b 0 (-2);
+  assert_equal (Bytes.sub_string b 0 3) "\xff\xff\xfe";
+  assert_equal (B.get_uint24 (Bytes.unsafe_to_string b) 0) 0xFFFFFE;
+  assert_equal (B.get_int24 (Bytes.unsafe_to_string b) 0) (-2);
+  assert_equal (L.get_int24 (Bytes.unsafe_to_string b) 0) (-0x10001);
+  H.set_uint24 b 4 0x123456;
+  assert_equal (H.get_int24 (Bytes.unsafe_to_string b) 4) 0x123456;
+  assert_raises (Invalid_argument "index out of bounds") (fun () -> L.get_float64 (Bytes.unsafe_to_string b) 9)
+
 let test_read_credentials () =
   require "read_credentials";
   let (_fd1, fd2) = Unix.socketpair Unix.PF_UNIX Unix.SOCK_STREAM 0 in
   let (pid, uid, gid) = Unix.getpid (), Unix.getuid (), Unix.getgid () in
   assert_equal (read_credentials fd2) (pid, uid, gid)
 
+let test_sendfds () =
+  require "recvfds_";
+  let s1, s2 = Unix.socketpair Unix.PF_UNIX Unix.SOCK_STREAM 0 in
+  let fds = Array.make 300 Unix.stdout in
+  assert_equal (sendfds_batch ~sock:s1 ~fds) 2;
+  sendfds ~sock:s1 ~fds:[| Unix.stdin |];
+  let a = recvfds s2 in
+  let b = recvfds ~cloexec:false s2 in
+  let c = recvfds s2 in
+  assert_equal (Array.length a) scm_max_fd;
+  assert_equal (Array.length b) (300 - scm_max_fd);
+  assert_equal (Array.length c) 1;
+  (* O_CLOEXEC as reported in the flags of /proc/self/fdinfo *)
+  if Sys.file_exists "/proc/self/fdinfo" then begin
+    let cloexec fd =
+      let ic = open_in (sprintf "/proc/self/fdinfo/%d" (int_of_file_descr fd)) in
+      let rec flags () =
+        let line = input_line ic in
+        match String.index_opt line ':' with
+        | Some i when String.sub line 0 i = "flags" ->
+          int_of_string ("0o" ^ String.trim (String.sub line (i + 1) (String.length line - i - 1)))
+        | _ -> flags ()
+      in
+      let flags = Fun.protect ~finally:(fun () -> close_in ic) flags in
+      flags land 0o2000000 <> 0
+    in
+    assert_bool "cloexec by default" (Array.for_all cloexec a && Array.for_all cloexec c);
+    assert_bool "no cloexec" (not (Array.exists cloexec b))
+  end;
+  Array.iter Unix.close a;
+  Array.iter Unix.close b;
+  Array.iter Unix.close c;
+  Unix.close s1;
+  assert_raises End_of_file (fun () -> recvfds s2);
+  Unix.close s2
+
 let test_fexecve () =
   require "fexecve";
   let s1, s2 = Unix.socketpair Unix.PF_UNIX Unix.SOCK_STREAM 0 in
@@ -464,6 +525,27 @@ let test_pwrite () =
     Unix.unlink name
   with exn -> Unix.close fd; Unix.unlink name; raise exn
 
+let test_pread_pwrite_large () =
+  require "unsafe_pread";
+  require "unsafe_pwrite";
+  let name = Filename.temp_file "extunix" "large" in
+  let fd =
+    Unix.openfile name [Unix.O_RDWR] 0
+  in
+  try
+    let size = 20 * 1024 * 1024 + 3 in (* larger than the 16 MiB staging buffer *)
+    let s = String.init size (fun i -> Char.chr (i land 0xff)) in
+    assert_equal (pwrite fd 0 s 0 size) size;
+    let t = Bytes.make size ' ' in
+    assert_equal (pread fd 0 t 0 size) size;
+    assert_bool "pread read bad data" (Bytes.to_string t = s);
+    let t = Bytes.make size ' ' in
+    assert_equal (pread fd 1 t 1 (size - 1)) (size - 1);
+    assert_bool "pread read bad data" (Bytes.sub_string t 1 (size - 1) = String.sub s 1 (size - 1));
+    Unix.close fd;
+    Unix.unlink name
+  with exn -> Unix.close fd; Unix.unlink name; raise exn
+
 let test_read () =
   require "unsafe_read";
   let name = Filename.temp_file "extunix" "read" in
@@ -516,6 +598,51 @@ let test_write () =
     Unix.unlink name
   with exn -> Unix.close fd; Unix.unlink name; raise exn
 
+let test_read_write_large () =
+  require "unsafe_read";
+  require "unsafe_write";
+  let name = Filename.temp_file "extunix" "large" in
+  let fd =
+    Unix.openfile name [Unix.O_RDWR] 0
+  in
+  try
+    let size = 20 * 1024 * 1024 + 3 in (* larger than the 16 MiB staging buffer *)
+    let s = String.init size (fun i -> Char.chr (i land 0xff)) in
+    assert_equal (write fd s 0 size) size;
+    (* repeated calls of decreasing size reuse the cached staging buffer *)
+    List.iter (fun len ->
+      let t = Bytes.make size ' ' in
+      assert_equal (Unix.lseek fd 0 Unix.SEEK_SET) 0;
+      assert_equal (read fd t 1 len) len;
+      assert_bool "read read bad data" (Bytes.sub_string t 1 len = String.sub s 0 len))
+      [size - 1; 1024 * 1024; 65536];
+    Unix.close fd;
+    Unix.unlink name
+  with exn -> Unix.close fd; Unix.unlink name; raise exn
+
+let test_preadv2 () =
+  require "unsafe_preadv2";
+  let name = Filename.temp_file "extunix" "preadv2" in
+  let fd =
+    Unix.openfile name [Unix.O_RDWR] 0
+  in
+  try
+    let size = 4096 in
+    let s = String.make size 'x' in
+    assert_equal (pwritev2 fd 0 s 0 size [RWF_DSYNC]) (Some size);
+    let t = Bytes.make size ' ' in
+    assert_equal (preadv2 fd 0 t 0 size []) (Some size);
+    cmp_bytes t 'x' "preadv2 read bad data";
+    let t = Bytes.make size ' ' in
+    begin match preadv2 fd 0 t 0 size [RWF_NOWAIT] with
+    | None -> ()
+    | Some n -> assert_equal n size; cmp_bytes t 'x' "preadv2 RWF_NOWAIT read bad data"
+    | exception Unix.Unix_error (Unix.EOPNOTSUPP, _, _) -> ()
+    end;
+    Unix.close fd;
+    Unix.unlink name
+  with exn -> Unix.close fd; Unix.unlink name; raise exn
+
 let test_mkstemp () =
   require "internal_mkstemps";
   let (_fd, name) = mkstemp ~suffix:"mkstemp" "extunix" in
@@ -536,18 +663,21 @@ let test_memalign () =
 let test_sockopt () =
   require "setsockopt_int";
   require "getsockopt_int";
-  let fd = Unix.socket Unix.PF_INET Unix.SOCK_STREAM 0 in
-  let test msg opt v =
+  let test fd msg opt v =
     try
       setsockopt_int fd opt v;
       assert_equal ~printer:string_of_int ~msg v (getsockopt_int fd opt)
     with
       Not_available _ -> skip_if true msg
   in
+  let fd = Unix.socket Unix.PF_INET Unix.SOCK_STREAM 0 in
   Unix.setsockopt fd Unix.SO_KEEPALIVE true;
-  test "TCP_KEEPCNT" TCP_KEEPCNT 5;
-  test "TCP_KEEPIDLE" TCP_KEEPIDLE 30;
-  test "TCP_KEEPINTVL" TCP_KEEPINTVL 10;
+  test fd "TCP_KEEPCNT" TCP_KEEPCNT 5;
+  test fd "TCP_KEEPIDLE" TCP_KEEPIDLE 30;
+  test fd "TCP_KEEPINTVL" TCP_KEEPINTVL 10;
+  Unix.close fd;
+  let fd = Unix.socket Unix.PF_INET Unix.SOCK_DGRAM 0 in
+  test fd "UDP_SEGMENT" UDP_SEGMENT 1400;
   Unix.close fd
 
 let test_sendmsg_bin () =
@@ -598,6 +728,158 @@ let test_splice () =
   Unix.close pipe_in;
   ()
 
+let test_splice_pump () =
+  require "unsafe_splice_pump";
+  let (a, a') = Unix.socketpair ~cloexec:true Unix.PF_UNIX Unix.SOCK_STREAM 0 in
+  let (b, b') = Unix.socketpair ~cloexec:true Unix.PF_UNIX Unix.SOCK_STREAM 0 in
+  assert_equal (Unix.write_substring a "request" 0 7) 7;
+  assert_equal (Unix.write_substring b' "response!" 0 9) 9;
+  Unix.shutdown a Unix.SHUTDOWN_SEND;
+  Unix.shutdown b' Unix.SHUTDOWN_SEND;
+  let r = splice_pump a' b ~pipe_size:65536 ~max_bytes:max_int in
+  assert_equal r.fwd_bytes 7;
+  assert_equal r.bwd_bytes 9;
+  assert_bool "eof" (r.fwd_eof && r.bwd_eof);
+  let buf = Bytes.create 16 in
+  assert_equal (Unix.read b' buf 0 16) 7;
+  assert_equal (Bytes.sub_string buf 0 7) "request";
+  assert_equal (Unix.read b' buf 0 16) 0;
+  assert_equal (Unix.read a buf 0 16) 9;
+  assert_equal (Bytes.sub_string buf 0 9) "response!";
+  List.iter Unix.close [a; a'; b; b']
+
+let test_splice_pump_tcp () =
+  require "unsafe_splice_pump";
+  let listen () =
+    let s = Unix.socket ~cloexec:true Unix.PF_INET Unix.SOCK_STREAM 0 in
+    Unix.bind s (Unix.ADDR_INET (Unix.inet_addr_loopback, 0));
+    Unix.listen s 1;
+    s
+  in
+  let connect l =
+    let c = Unix.socket ~cloexec:true Unix.PF_INET Unix.SOCK_STREAM 0 in
+    Unix.connect c (Unix.getsockname l);
+    let (a, _) = Unix.accept ~cloexec:true l in
+    (c, a)
+  in
+  let l1 = listen () and l2 = listen () in
+  (* client -> [c' relay s] -> server' *)
+  let (client, c') = connect l1 in
+  let (s, server) = connect l2 in
+  (* the server speaks first while the blocking client side stays silent *)
+  assert_equal (Unix.write_substring server "hello" 0 5) 5;
+  let r = splice_pump ~timeout:0.2 c' s ~pipe_size:0 ~max_bytes:max_int in
+  assert_equal r.fwd_bytes 0;
+  assert_equal r.bwd_bytes 5;
+  let buf = Bytes.create 16 in
+  assert_equal (Unix.read client buf 0 16) 5;
+  assert_equal (Bytes.sub_string buf 0 5) "hello";
+  assert_equal (Unix.write_substring client "request" 0 7) 7;
+  Unix.shutdown client Unix.SHUTDOWN_SEND;
+  Unix.shutdown server Unix.SHUTDOWN_SEND;
+  let r = splice_pump c' s ~pipe_size:0 ~max_bytes:max_int in
+  assert_equal r.fwd_bytes 7;
+  assert_bool "eof" (r.fwd_eof && r.bwd_eof);
+  assert_equal (Unix.read server buf 0 16) 7;
+  assert_equal (Bytes.sub_string buf 0 7) "request";
+  List.iter Unix.close [client; c'; s; server; l1; l2]
+
+let test_splice_pump_backpressure () =
+  require "unsafe_splice_pump";
+  let listen () =
+    let s = Unix.socket ~cloexec:true Unix.PF_INET Unix.SOCK_STREAM 0 in
+    Unix.bind s (Unix.ADDR_INET (Unix.inet_addr_loopback, 0));
+    Unix.listen s 1;
+    s
+  in
+  let connect l =
+    let c = Unix.socket ~cloexec:true Unix.PF_INET Unix.SOCK_STREAM 0 in
+    Unix.connect c (Unix.getsockname l);
+    let (a, _) = Unix.accept ~cloexec:true l in
+    (c, a)
+  in
+  let l1 = listen () and l2 = listen () in
+  let (client, c') = connect l1 in
+  let (s, server) = connect l2 in
+  (* queue as much as the sockets take, more than the server side can
+     buffer while it is not reading *)
+  Unix.set_nonblock client;
+  let chunk = Bytes.make 65536 'x' in
+  let rec fill total =
+    match Unix.write client chunk 0 (Bytes.length chunk) with
+    | n -> fill (total + n)
+    | exception Unix.Unix_error ((Unix.EAGAIN | Unix.EWOULDBLOCK), _, _) -> total
+  in
+  let total = fill 0 in
+  Unix.shutdown client Unix.SHUTDOWN_SEND;
+  Unix.shutdown server Unix.SHUTDOWN_SEND;
+  match Unix.fork () with
+  | 0 ->
+    (* a slow reader *)
+    Unix.sleepf 0.5;
+    let buf = Bytes.create 65536 in
+    let rec drain n = match Unix.read server buf 0 65536 with 0 -> n | k -> drain (n + k) in
+    exit (if drain 0 = total then 0 else 1)
+  | pid ->
+    Unix.close server;
+    let t = Unix.times () in
+    let r = splice_pump c' s ~pipe_size:0 ~max_bytes:max_int in
+    let t' = Unix.times () in
+    Unix.close s;
+    assert_equal (snd (Unix.waitpid [] pid)) (Unix.WEXITED 0);
+    assert_equal r.fwd_bytes total;
+    assert_bool "eof" (r.fwd_eof && r.bwd_eof);
+    (* waiting for the reader must not spin *)
+    let cpu = t'.Unix.tms_utime -. t.Unix.tms_utime +. t'.Unix.tms_stime -. t.Unix.tms_stime in
+    assert_bool (sprintf "busy loop: %.2fs of CPU" cpu) (cpu < 0.25);
+    List.iter Unix.close [client; c'; l1; l2]
+
+let test_copy_range () =
+  require "unsafe_copy_range";
+  let src = Filename.temp_file "extunix" "copy" in
+  let dst = Filename.temp_file "extunix" "copy" in
+  let fd_in = Unix.openfile src [O_RDWR; O_CLOEXEC] 0 in
+  let fd_out = Unix.openfile dst [O_RDWR; O_CLOEXEC] 0 in
+  let read_all fd len =
+    let b = Bytes.create len in
+    let _ = Unix.lseek fd 0 SEEK_SET in
+    let rec loop off = if off < len then loop (off + Unix.read fd b off (len - off)) in
+    loop 0;
+    Bytes.to_string b
+  in
+  let size = 1024 * 1024 + 17 in
+  let s = String.init size (fun i -> Char.chr (i * 7 land 0xff)) in
+  assert_equal (Unix.write_substring fd_in s 0 size) size;
+  let (_, n) = LargeFile.copy_range fd_in (Some 0L) fd_out (Some 0L) (Int64.of_int size) in
+  assert_equal ~printer:Int64.to_string (Int64.of_int size) n;
+  assert_equal ~printer (read_all fd_out size) s;
+  (* short copy at the end of the input *)
+  let (_, n) = LargeFile.copy_range fd_in (Some 10L) fd_out (Some 0L) 1_000_000_000L in
+  assert_equal ~printer:Int64.to_string (Int64.of_int (size - 10)) n;
+  (* output at the current position, as with a pipe or socket *)
+  let pipe_out, pipe_in = Unix.pipe ~cloexec:true () in
+  let (strategy, n) = LargeFile.copy_range fd_in (Some 4L) pipe_in None 10L in
+  assert_equal n 10L;
+  assert_bool "no offset for sendfile" (strategy <> Reflink);
+  let b = Bytes.create 10 in
+  assert_equal (Unix.read pipe_out b 0 10) 10;
+  assert_equal ~printer (Bytes.to_string b) (String.sub s 4 10);
+  if have "unsafe_copy_file_range" = Some true then
+    begin
+      assert_equal (LargeFile.copy_file_range fd_in (Some 1L) fd_out (Some 0L) 5) 5;
+      assert_raises (Invalid_argument "ExtUnix.LargeFile.copy_file_range")
+        (fun () -> LargeFile.copy_file_range fd_in None fd_out None (-1))
+    end;
+  if have "unsafe_sendfile" = Some true then
+    assert_raises (Invalid_argument "ExtUnix.LargeFile.sendfile")
+      (fun () -> LargeFile.sendfile pipe_in fd_in (Some (-1L)) 5);
+  Unix.close pipe_out;
+  Unix.close pipe_in;
+  Unix.close fd_in;
+  Unix.close fd_out;
+  Unix.unlink src;
+  Unix.unlink dst
+
 let test_wait4 () =
   require "wait4";
   let pid = Unix.fork () in
@@ -630,13 +912,18 @@ let () =
     "mkdtemp" >:: test_mkdtemp;
     "endian" >:: test_endian;
     "endian_string" >:: test_endian_string;
+    "endian_float_string" >:: test_endian_float_string;
     "read_credentials" >:: test_read_credentials;
     "fexecve" >:: test_fexecve;
     "sendmsg" >:: test_sendmsg;
+    "sendfds" >:: test_sendfds;
     "pread" >:: test_pread;
     "pwrite" >:: test_pwrite;
+    "pread_pwrite_large" >:: test_pread_pwrite_large;
     "read" >:: test_read;
     "write" >:: test_write;
+    "read_write_large" >:: test_read_write_large;
+    "preadv2" >:: test_preadv2;
     "mkstemp" >:: test_mkstemp;
     "mkostemp" >:: test_mkostemp;
     "memalign" >:: test_memalign;
@@ -644,6 +931,10 @@ let () =
     "sendmsg_bin" >:: test_sendmsg_bin;
     "sysinfo" >:: test_sysinfo;
     "splice" >:: test_splice;
+    "splice_pump" >:: test_splice_pump;
+    "splice_pump_tcp" >:: test_splice_pump_tcp;
+    "splice_pump_backpressure" >:: test_splice_pump_backpressure;
+    "copy_range" >:: test_copy_range;
     "wait4" >:: test_wait4;
 ]) in
   ignore (run_test_tt_main (test_decorate wrap tests))
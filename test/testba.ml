@@ -89,6 +89,246 @@ let test_endian_bigarray () =
   L.set_int64  l 10 (0x1032547698BADCFEL);
   assert_equal l src
 
+let test_endian_float () =
+  require "unsafe_get_float32";
+  require "unsafe_get_uint24";
+  let module B = BigEndian in
+  let module L = LittleEndian in
+  let b = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout 12 in
+  Bigarray.Array1.fill b 0;
+  B.set_float32 b 3 1.5;
+  assert_equal (B.get_int32 b 3) 0x3fc00000l;
+  assert_equal (B.get_float32 b 3) 1.5;
+  L.set_float64 b 4 1e100;
+  assert_equal (L.get_float64 b 4) 1e100;
+  assert_equal (L.get_int64 b 4) (Int64.bits_of_float 1e100);
+  B.set_uint24 b 0 0xFEDCBA;
+  assert_equal (B.get_uint24 b 0) 0xFEDCBA;
+  assert_equal (B.get_int24 b 0) (0xFEDCBA - 0x1000000);
+  assert_equal (L.get_uint24 b 0) 0xBADCFE;
+  assert_raises (Invalid_argument "index out of bounds") (fun () -> B.get_int24 b 10)
+
+let test_endian_unboxed () =
+  require "unsafe_get_int64";
+  skip_if (Sys.backend_type <> Sys.Native) "boxed in bytecode";
+  let b = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout 16 in
+  (* an int accumulator, so that only the accessors are measured *)
+  let acc = ref 0 in
+  let before = Gc.minor_words () in
+  for i = 0 to 999 do
+    BigEndian.set_int64 b 0 (Int64.of_int i);
+    LittleEndian.set_int32 b 8 (Int32.of_int i);
+    acc := !acc + Int64.to_int (BigEndian.get_int64 b 0);
+    acc := !acc + Int32.to_int (LittleEndian.get_int32 b 8)
+  done;
+  let after = Gc.minor_words () in
+  assert_equal !acc 999000;
+  assert_bool "accessors allocate" (after -. before < 100.)
+
+let test_endian_array () =
+  require "unsafe_get_int16_array";
+  require "unsafe_get_float64_array";
+  let module B = BigEndian in
+  let module L = LittleEndian in
+  let open Bigarray in
+  let n = 37 in
+  let src = Array1.create int8_unsigned c_layout (8 * n + 3) in
+  for i = 0 to Array1.dim src - 1 do src.{i} <- (i * 37 + 11) land 0xFF done;
+  let i32 = Array1.create int32 c_layout (n + 1) in
+  let i64 = Array1.create int64 c_layout (n + 1) in
+  let f64 = Array1.create float64 c_layout (n + 1) in
+  B.get_int16_array src 1 i32 1 n;
+  for i = 0 to n - 1 do assert_equal (Int32.to_int i32.{i+1}) (B.get_int16 src (1 + 2 * i)) done;
+  L.get_int16_array src 1 i32 0 n;
+  for i = 0 to n - 1 do assert_equal (Int32.to_int i32.{i}) (L.get_int16 src (1 + 2 * i)) done;
+  B.get_int32_array src 3 i32 0 n;
+  for i = 0 to n - 1 do assert_equal i32.{i} (B.get_int32 src (3 + 4 * i)) done;
+  L.get_int32_array src 3 i32 1 n;
+  for i = 0 to n - 1 do assert_equal i32.{i+1} (L.get_int32 src (3 + 4 * i)) done;
+  B.get_int64_array src 2 i64 0 n;
+  for i = 0 to n - 1 do assert_equal i64.{i} (B.get_int64 src (2 + 8 * i)) done;
+  L.get_int64_array src 3 i64 1 n;
+  for i = 0 to n - 1 do assert_equal i64.{i+1} (L.get_int64 src (3 + 8 * i)) done;
+  B.get_float32_array src 0 f64 0 n;
+  for i = 0 to n - 1 do
+    let x = Int32.float_of_bits (B.get_int32 src (4 * i)) in
+    assert_bool "float32" (Int64.equal (Int64.bits_of_float f64.{i}) (Int64.bits_of_float x) || (Float.is_nan x && Float.is_nan f64.{i}))
+  done;
+  L.get_float64_array src 3 f64 1 n;
+  for i = 0 to n - 1 do assert_equal (Int64.bits_of_float f64.{i+1}) (L.get_int64 src (3 + 8 * i)) done;
+  assert_raises (Invalid_argument "index out of bounds") (fun () -> B.get_int64_array src 4 i64 0 n);
+  assert_raises (Invalid_argument "index out of bounds") (fun () -> L.get_int32_array src 0 i32 2 n)
+
+let test_cursor () =
+  require "read_uvarint";
+  let module C = ExtUnix.All.Cursor in
+  let buf = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout 64 in
+  let w = C.create ~off:2 ~len:60 buf in
+  C.write_uint8 w 0xFF;
+  C.BE.write_int32 w 0x01020304l;
+  C.LE.write_uint16 w 0xABCD;
+  C.BE.write_float64 w 2.5;
+  List.iter (C.write_varint w) [0; -1; 63; -64; 300; max_int; min_int];
+  C.write_uvarint w 300;
+  C.write_uvarint64 w (-1L);
+  C.write_prefixed_string w "hello";
+  assert_equal (Bigarray.Array1.get buf 3) 0x01;
+  assert_equal (Bigarray.Array1.get buf 7) 0xCD;
+  let r = C.create ~off:2 ~len:(C.consumed w) buf in
+  C.ensure r 15;
+  assert_equal (C.unsafe_read_uint8 r) 0xFF;
+  assert_equal (C.BE.unsafe_read_int32 r) 0x01020304l;
+  assert_equal (C.LE.unsafe_read_uint16 r) 0xABCD;
+  assert_equal (C.BE.unsafe_read_float64 r) 2.5;
+  List.iter (fun x -> assert_equal (C.read_varint r) x) [0; -1; 63; -64; 300; max_int; min_int];
+  assert_equal (C.read_uvarint r) 300;
+  assert_equal (C.read_uvarint64 r) (-1L);
+  assert_equal (C.read_prefixed_string r) "hello";
+  assert_equal (C.remaining r) 0;
+  assert_raises (Invalid_argument "index out of bounds") (fun () -> C.read_uint8 r);
+  (* truncated varint leaves the position alone *)
+  C.seek r 2;
+  C.skip r 1;
+  let p = C.pos r in
+  let t = C.create ~off:p ~len:1 buf in
+  Bigarray.Array1.set buf p 0x80;
+  assert_raises (Invalid_argument "index out of bounds") (fun () -> C.read_uvarint t);
+  assert_equal (C.pos t) p
+
+let test_search () =
+  require "unsafe_index_any_of_set";
+  let s = "GET / HTTP/1.1\r\nHost: x\r\n\r\nbody\n" in
+  let buf = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout (String.length s + 100) in
+  Bigarray.Array1.fill buf (Char.code 'a');
+  set_substr buf 50 s;
+  let len = Bigarray.Array1.dim buf - 50 in
+  assert_equal (index_byte buf 50 len '\n') (50 + String.index s '\n');
+  assert_equal (rindex_byte buf 0 (50 + 30) '\n') (50 + String.rindex_from s 29 '\n');
+  assert_equal (index_byte buf 0 50 '\n') (-1);
+  assert_equal (index_sub buf 50 len "\r\n\r\n") (50 + 23);
+  assert_equal (index_sub buf 50 20 "\r\n\r\n") (-1);
+  let set = byte_set ":\r\xff" in
+  assert_equal (index_any_of_set buf 0 (Bigarray.Array1.dim buf) set) (50 + 14);
+  assert_equal (index_any_of_set buf 0 50 set) (-1);
+  Bigarray.Array1.set buf 120 0xff;
+  assert_equal (index_any_of_set buf 80 52 set) 120;
+  assert_equal (index_any_of_set buf 80 52 (byte_set "")) (-1);
+  assert_raises (Invalid_argument "index out of bounds") (fun () -> index_byte buf 1 (Bigarray.Array1.dim buf) 'a')
+
+let test_sendmsg_bigarray () =
+  require "recvmsg_fd";
+  let open ExtUnix.All in
+  let s1, s2 = Unix.socketpair Unix.PF_UNIX Unix.SOCK_DGRAM 0 in
+  let size = 65536 in
+  let a = Bigarray.Array1.create Bigarray.char Bigarray.c_layout size in
+  Bigarray.Array1.fill a 'x';
+  set_substr a 0 "head";
+  let iovs = [| { iov_buf = a; iov_off = 0; iov_len = 4 }; { iov_buf = a; iov_off = 4; iov_len = 10000 } |] in
+  assert_equal (BA.sendmsg s1 ~sendfd:Unix.stdout iovs []) 10004;
+  let b = Bigarray.Array1.create Bigarray.char Bigarray.c_layout size in
+  let r = BA.recvmsg s2 [| { iov_buf = b; iov_off = 1; iov_len = size - 1 } |] [] in
+  assert_equal r.recv_len 10004;
+  assert_equal r.recv_flags [];
+  assert_equal (get_substr b 1 5) "headx";
+  (match r.recv_fd with Some fd -> Unix.close fd | None -> assert_failure "no descriptor");
+  ignore (BA.sendmsg s1 iovs []);
+  let r = BA.recvmsg s2 [| { iov_buf = b; iov_off = 0; iov_len = 100 } |] [] in
+  assert_equal r.recv_len 100;
+  assert_equal r.recv_fd None;
+  assert_equal r.recv_flags [MSG_TRUNC];
+  let many = Array.make 100_000 { iov_buf = a; iov_off = 0; iov_len = 1 } in
+  assert_raises (Unix.Unix_error (Unix.EMSGSIZE, "sendmsg", "")) (fun () -> BA.sendmsg s1 many []);
+  assert_raises (Unix.Unix_error (Unix.EMSGSIZE, "recvmsg", "")) (fun () -> BA.recvmsg s2 many []);
+  Unix.close s1;
+  Unix.close s2
+
+let test_mmsg () =
+  require "mmsg_recv";
+  let open ExtUnix.All in
+  let udp () =
+    let s = Unix.socket Unix.PF_INET Unix.SOCK_DGRAM 0 in
+    Unix.bind s (Unix.ADDR_INET (Unix.inet_addr_loopback, 0));
+    s
+  in
+  let s1 = udp () and s2 = udp () in
+  let dst = Unix.getsockname s2 in
+  let out = Mmsg.create ~slot:64 8 in
+  for i = 0 to 5 do
+    Bigarray.Array1.fill (Bigarray.Array1.sub out.Mmsg.buf (Mmsg.offset out i) 64) (Char.code 'a' + i);
+    Mmsg.set_length out i (10 + i);
+    Mmsg.set_addr out i dst
+  done;
+  assert_equal (Mmsg.send s1 ~len:6 out) 6;
+  let inp = Mmsg.create ~slot:12 4 in
+  assert_equal (Mmsg.recv s2 ~off:1 ~waitforone:true inp) 3;
+  assert_equal (Array.to_list inp.Mmsg.lens) [0; 10; 11; 12];
+  assert_equal (Array.to_list inp.Mmsg.truncated) [false; false; false; false];
+  assert_equal (Bigarray.Array1.get inp.Mmsg.buf (Mmsg.offset inp 1)) (Char.code 'a');
+  assert_equal (Mmsg.addr inp 1) (Unix.getsockname s1);
+  (* the last datagrams are truncated to the slot size *)
+  assert_equal (Mmsg.recv s2 ~waitforone:true ~timeout:1. inp) 3;
+  assert_equal (Array.to_list inp.Mmsg.lens) [12; 12; 12; 12];
+  assert_equal (Array.to_list inp.Mmsg.truncated) [true; true; true; false];
+  assert_bool "truncated" (Mmsg.truncated inp 0);
+  assert_raises (Invalid_argument "ExtUnix.Mmsg.recv") (fun () -> Mmsg.recv s2 ~off:2 ~len:3 inp);
+  Unix.close s1;
+  Unix.close s2
+
+let test_udp_gso () =
+  require "recvmsg_gro";
+  let open ExtUnix.All in
+  if not (have_sockopt_bool UDP_GRO) then skip_if true "UDP_GRO";
+  let udp () =
+    let s = Unix.socket Unix.PF_INET Unix.SOCK_DGRAM 0 in
+    Unix.bind s (Unix.ADDR_INET (Unix.inet_addr_loopback, 0));
+    s
+  in
+  let s1 = udp () and s2 = udp () and s3 = udp () in
+  setsockopt s2 UDP_GRO true;
+  assert_bool "UDP_GRO" (getsockopt s2 UDP_GRO);
+  let a = Bigarray.Array1.create Bigarray.char Bigarray.c_layout 65536 in
+  Bigarray.Array1.fill a 'x';
+  let b = Bigarray.Array1.create Bigarray.char Bigarray.c_layout 65536 in
+  let whole buf = [| { iov_buf = buf; iov_off = 0; iov_len = 65536 } |] in
+  Unix.connect s1 (Unix.getsockname s2);
+  assert_equal (BA.sendmsg_gso s1 ~gso_size:1000 [| { iov_buf = a; iov_off = 0; iov_len = 20500 } |] []) 20500;
+  assert_equal (BA.recvmsg_gro s2 (whole b) []) (20500, 1000);
+  (* without UDP_GRO the datagrams arrive one by one *)
+  Unix.connect s1 (Unix.getsockname s3);
+  ignore (BA.sendmsg_gso s1 ~gso_size:1000 [| { iov_buf = a; iov_off = 0; iov_len = 2500 } |] []);
+  assert_equal (BA.recvmsg_gro s3 (whole b) []) (1000, 0);
+  List.iter Unix.close [s1; s2; s3]
+
+let test_zerocopy () =
+  require "zerocopy_reap";
+  let open ExtUnix.All in
+  if not (have_sockopt_bool SO_ZEROCOPY) then skip_if true "SO_ZEROCOPY";
+  let l = Unix.socket Unix.PF_INET Unix.SOCK_STREAM 0 in
+  Unix.bind l (Unix.ADDR_INET (Unix.inet_addr_loopback, 0));
+  Unix.listen l 1;
+  let s1 = Unix.socket Unix.PF_INET Unix.SOCK_STREAM 0 in
+  Unix.connect s1 (Unix.getsockname l);
+  let s2, _ = Unix.accept l in
+  let t = Zerocopy.create s1 in
+  let a = Bigarray.Array1.create Bigarray.char Bigarray.c_layout 65536 in
+  Bigarray.Array1.fill a 'x';
+  for i = 1 to 5 do
+    assert_equal (Zerocopy.send t [| { iov_buf = a; iov_off = 0; iov_len = 10000 } |] i) 10000
+  done;
+  assert_equal (Zerocopy.pending t) 5;
+  let b = Bytes.create 65536 in
+  let rec drain n = if n > 0 then drain (n - Unix.read s2 b 0 (Bytes.length b)) in
+  drain 50000;
+  let released = ref [] in
+  let rec wait tries =
+    ignore (Zerocopy.reap t (fun i -> released := i :: !released));
+    if Zerocopy.pending t > 0 && tries > 0 then (ignore (Unix.select [] [] [] 0.01); wait (tries - 1))
+  in
+  wait 500;
+  assert_equal (List.rev !released) [1; 2; 3; 4; 5];
+  assert_equal (Zerocopy.pending t) 0;
+  List.iter Unix.close [s1; s2; l]
+
 let cmp_buf buf c text =
   for i = 0 to Bigarray.Array1.dim buf - 1 do
     if Bigarray.Array1.get buf i <> (int_of_char c)
@@ -230,16 +470,487 @@ let test_write_bigarray () =
     Unix.unlink name
   with exn -> Unix.close fd; Unix.unlink name; raise exn
 
+let test_preadv_pwritev_bigarray () =
+  require "unsafe_preadv";
+  require "unsafe_pwritev";
+  let name = Filename.temp_file "extunix" "preadv" in
+  let fd =
+    Unix.openfile name [Unix.O_RDWR] 0
+  in
+  try
+    let size = 65536 in
+    let a = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout size in
+    let b = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout size in
+    Bigarray.Array1.fill a (int_of_char 'x');
+    Bigarray.Array1.fill b (int_of_char 'y');
+    let iovs = [|
+      { iov_buf = a; iov_off = 0; iov_len = size };
+      { iov_buf = b; iov_off = 100; iov_len = 0 };
+      { iov_buf = b; iov_off = 1; iov_len = size - 1 };
+    |] in
+    assert_equal (pwritev fd 0 iovs) (2 * size - 1);
+    let t = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout (2 * size) in
+    assert_equal (pread fd 0 t) (2 * size - 1);
+    cmp_buf (Bigarray.Array1.sub t 0 size) 'x' "pwritev wrote bad data";
+    cmp_buf (Bigarray.Array1.sub t size (size - 1)) 'y' "pwritev wrote bad data";
+    Bigarray.Array1.fill a 0;
+    Bigarray.Array1.fill b 0;
+    let iovs = [|
+      { iov_buf = b; iov_off = 0; iov_len = size - 1 };
+      { iov_buf = a; iov_off = 0; iov_len = size };
+    |] in
+    assert_equal (preadv fd size iovs) (size - 1);
+    cmp_buf (Bigarray.Array1.sub b 0 (size - 1)) 'y' "preadv read bad data";
+    assert_equal (LargeFile.preadv fd Int64.zero iovs) (2 * size - 1);
+    cmp_buf (Bigarray.Array1.sub b 0 (size - 1)) 'x' "Largefile.preadv read bad data";
+    cmp_buf (Bigarray.Array1.sub a 0 1) 'x' "Largefile.preadv read bad data";
+    cmp_buf (Bigarray.Array1.sub a 1 (size - 1)) 'y' "Largefile.preadv read bad data";
+    assert_raises (Invalid_argument "preadv")
+      (fun () -> preadv fd 0 [| { iov_buf = a; iov_off = 1; iov_len = size } |]);
+    Unix.close fd;
+    Unix.unlink name
+  with exn -> Unix.close fd; Unix.unlink name; raise exn
+
+let test_preadv2_pwritev2_bigarray () =
+  require "unsafe_preadv2";
+  require "unsafe_pwritev2";
+  let name = Filename.temp_file "extunix" "preadv2" in
+  let fd =
+    Unix.openfile name [Unix.O_RDWR] 0
+  in
+  let nowait = [ExtUnix.All.RWF_NOWAIT] in
+  try
+    let size = 65536 in
+    let a = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout size in
+    let b = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout size in
+    Bigarray.Array1.fill a (int_of_char 'x');
+    Bigarray.Array1.fill b (int_of_char 'y');
+    let iovs = [|
+      { iov_buf = a; iov_off = 0; iov_len = size };
+      { iov_buf = b; iov_off = 1; iov_len = size - 1 };
+    |] in
+    assert_equal (pwritev2 fd 0 iovs [ExtUnix.All.RWF_DSYNC]) (Some (2 * size - 1));
+    Bigarray.Array1.fill a 0;
+    Bigarray.Array1.fill b 0;
+    let iovs = [|
+      { iov_buf = b; iov_off = 0; iov_len = size - 1 };
+      { iov_buf = a; iov_off = 0; iov_len = size };
+    |] in
+    assert_equal (preadv2 fd size iovs []) (Some (size - 1));
+    cmp_buf (Bigarray.Array1.sub b 0 (size - 1)) 'y' "preadv2 read bad data";
+    assert_raises (Invalid_argument "ExtUnix.preadv2")
+      (fun () -> preadv2 fd (-1) iovs []);
+    (* the data is in the page cache now, RWF_NOWAIT reads it without blocking *)
+    let iovs = [| { iov_buf = a; iov_off = 0; iov_len = size } |] in
+    Bigarray.Array1.fill a 0;
+    let supported =
+      match preadv2 fd 0 iovs nowait with
+      | None -> cmp_buf a '\000' "preadv2 RWF_NOWAIT touched the buffer"; true
+      | Some n -> assert_equal n size; cmp_buf a 'x' "preadv2 RWF_NOWAIT read bad data"; true
+      | exception Unix.Unix_error (Unix.EOPNOTSUPP, _, _) -> false
+    in
+    (* once evicted from the page cache the data is not immediately
+       available; eviction is best effort, so every outcome is checked
+       but EAGAIN itself is not required *)
+    let rec evict = function
+      | 0 -> ()
+      | n ->
+        ExtUnix.All.fsync fd;
+        ExtUnix.All.fadvise fd 0 0 ExtUnix.All.POSIX_FADV_DONTNEED;
+        Bigarray.Array1.fill a 0;
+        match preadv2 fd 0 iovs nowait with
+        | None -> cmp_buf a '\000' "preadv2 RWF_NOWAIT touched the buffer"
+        | Some n' ->
+          assert_equal n' size;
+          cmp_buf a 'x' "preadv2 RWF_NOWAIT read bad data";
+          evict (n - 1)
+    in
+    if supported then evict 10;
+    Unix.close fd;
+    Unix.unlink name
+  with exn -> Unix.close fd; Unix.unlink name; raise exn
+
+let test_uring () =
+  require "uring_create";
+  let module U = ExtUnix.All.Uring in
+  let ring =
+    try U.create 8 with
+    | Unix.Unix_error ((Unix.EPERM | Unix.EACCES | Unix.ENOSYS), _, _) ->
+      skip_if true "io_uring is not permitted"; assert false
+  in
+  let name = Filename.temp_file "extunix" "uring" in
+  let fd = Unix.openfile name [Unix.O_RDWR] 0 in
+  let results = Array.make 24 0 in
+  let wait n =
+    ignore (U.submit_and_wait ring n);
+    let k = U.reap ring results in
+    assert_equal ~msg:"completions" n k;
+    for i = 0 to k - 1 do
+      if results.(3*i+1) < 0 then
+        raise (Unix.Unix_error (U.error_of_result results.(3*i+1), "uring", string_of_int results.(3*i)))
+    done
+  in
+  try
+    let size = 4096 in
+    let a = ExtUnix.All.memalign 4096 size in
+    Bigarray.Array1.fill a (int_of_char 'x');
+    assert_bool "prep_write" (U.prep_write ring ~id:1 fd { iov_buf = a; iov_off = 0; iov_len = size } 0);
+    wait 1;
+    assert_equal results.(0) 1;
+    assert_equal results.(1) size;
+    assert_bool "prep_fsync" (U.prep_fsync ring ~id:2 ~datasync:true fd);
+    let st = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout U.statx_size in
+    assert_bool "prep_statx" (U.prep_statx ring ~id:3 name st);
+    wait 2;
+    assert_equal (U.statx_of_buffer st).U.stx_size (Int64.of_int size);
+    U.register_buffers ring [| { iov_buf = a; iov_off = 0; iov_len = size } |];
+    Bigarray.Array1.fill a 0;
+    assert_bool "prep_read_fixed" (U.prep_read_fixed ring ~id:4 fd { iov_buf = a; iov_off = 0; iov_len = size } 0 ~index:0);
+    wait 1;
+    assert_equal results.(0) 4;
+    assert_equal results.(1) size;
+    cmp_buf a 'x' "read_fixed read bad data";
+    U.unregister_buffers ring;
+    assert_equal (U.in_flight ring) 0;
+    (* close cancels and reaps the read still waiting for data *)
+    let (r, w) = Unix.pipe ~cloexec:true () in
+    assert_bool "prep_read" (U.prep_read ring ~id:5 r { iov_buf = a; iov_off = 0; iov_len = size } 0);
+    ignore (U.submit ring);
+    assert_equal (U.in_flight ring) 1;
+    U.close ring;
+    assert_equal (U.in_flight ring) 0;
+    assert_equal (Unix.write_substring w "data" 0 4) 4;
+    let buf = Bytes.create 8 in
+    assert_equal (Unix.read r buf 0 8) 4;
+    List.iter Unix.close [r; w];
+    Unix.close fd;
+    Unix.unlink name
+  with exn -> U.close ring; Unix.close fd; Unix.unlink name; raise exn
+
+let test_uring_net () =
+  require "uring_prep_recv_multishot";
+  let module U = ExtUnix.All.Uring in
+  let ring =
+    try U.create 16 with
+    | Unix.Unix_error ((Unix.EPERM | Unix.EACCES | Unix.ENOSYS), _, _) ->
+      skip_if true "io_uring is not permitted"; assert false
+  in
+  let results = Array.make 48 0 in
+  let wait n =
+    ignore (U.submit_and_wait ring n);
+    U.reap ring results
+  in
+  let listen = Unix.socket Unix.PF_INET Unix.SOCK_STREAM 0 in
+  let client = Unix.socket Unix.PF_INET Unix.SOCK_STREAM 0 in
+  try
+    Unix.bind listen (Unix.ADDR_INET (Unix.inet_addr_loopback, 0));
+    Unix.listen listen 8;
+    assert_bool "prep_accept_multishot" (U.prep_accept_multishot ring ~id:1 listen);
+    ignore (U.submit ring);
+    Unix.connect client (Unix.getsockname listen);
+    assert_equal (wait 1) 1;
+    assert_equal results.(0) 1;
+    assert_bool "accept has_more" (U.has_more results.(2));
+    let server = ExtUnix.All.file_descr_of_int results.(1) in
+    Fun.protect ~finally:(fun () -> Unix.close server) (fun () ->
+      let slab = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout (4 * 64) in
+      let g = U.setup_buf_ring ring ~gid:1 slab ~buf_size:64 in
+      assert_equal g.U.count 4;
+      assert_bool "prep_recv_multishot" (U.prep_recv_multishot ring ~id:2 server g);
+      let msg = Bigarray.Array1.create Bigarray.int8_unsigned Bigarray.c_layout 16 in
+      set_substr msg 0 "0123456789abcdef";
+      assert_bool "prep_send" (U.prep_send ring ~id:3 ~timeout:10. client { iov_buf = msg; iov_off = 0; iov_len = 4 });
+      let got = Buffer.create 16 in
+      let sent = ref 0 in
+      let check n =
+        for i = 0 to n - 1 do
+          let id = results.(3*i) and res = results.(3*i+1) and flags = results.(3*i+2) in
+          assert_bool "result" (res >= 0);
+          if id = 2 then begin
+            assert_bool "has_buffer" (U.has_buffer flags);
+            let bid = U.buffer_id flags in
+            Buffer.add_string got (get_substr slab (U.buffer_offset g bid) res);
+            U.recycle g bid
+          end
+          else sent := !sent + res
+        done
+      in
+      check (wait 2);
+      assert_bool "prep_sendmsg" (U.prep_sendmsg ring ~id:4 client
+        [| { iov_buf = msg; iov_off = 4; iov_len = 4 }; { iov_buf = msg; iov_off = 10; iov_len = 6 } |]);
+      while !sent < 14 || Buffer.length got < 14 do check (wait 1) done;
+      assert_equal ~printer:(fun s -> s) "0123456789abcdef" (Buffer.contents got));
+    Unix.close client;
+    Unix.close listen;
+    U.close ring
+  with exn -> Unix.close client; Unix.close listen; U.close ring; raise exn
+
+let test_aio () =
+  require "aio_create";
+  let module A = ExtUnix.All.Aio in
+  let aio =
+    try A.create 4 with
+    | Unix.Unix_error ((Unix.EPERM | Unix.ENOSYS), _, _) ->
+      skip_if true "io_setup is not permitted"; assert false
+  in
+  let name = Filename.temp_file "extunix" "aio" in
+  let fd = Unix.openfile name [Unix.O_RDWR] 0 in
+  try
+    let align = try A.dio_alignment fd with Unix.Unix_error (Unix.EINVAL, _, _) -> 512 in
+    let size = 2 * 4096 in
+    let a = ExtUnix.All.memalign 4096 size in
+    Bigarray.Array1.fill a (int_of_char 'x');
+    let efd = ExtUnix.All.eventfd 0 in
+    assert_bool "prep_pwrite" (A.prep_pwrite aio ~id:1 ~resfd:efd ~align fd { iov_buf = a; iov_off = 0; iov_len = size } 0);
+    assert_raises (Invalid_argument "Aio.prep_pwrite: misaligned")
+      (fun () -> A.prep_pwrite aio ~id:2 ~align:512 fd { iov_buf = a; iov_off = 1; iov_len = 512 } 0);
+    assert_equal (A.submit aio) 1;
+    let results = Array.make 8 0 in
+    assert_equal (A.reap aio 1 results) 1;
+    assert_equal results.(0) 1;
+    assert_equal results.(1) size;
+    assert_equal (ExtUnix.All.eventfd_read efd) 1L;
+    Unix.close efd;
+    Bigarray.Array1.fill a 0;
+    assert_bool "prep_pread" (A.prep_pread aio ~id:3 ~align fd { iov_buf = a; iov_off = 4096; iov_len = 4096 } 4096);
+    assert_equal (A.submit aio) 1;
+    assert_equal (A.reap aio ~timeout:10. 1 results) 1;
+    assert_equal results.(0) 3;
+    assert_equal results.(1) 4096;
+    cmp_buf (Bigarray.Array1.sub a 4096 4096) 'x' "aio read bad data";
+    assert_equal (A.in_flight aio) 0;
+    A.destroy aio;
+    Unix.close fd;
+    Unix.unlink name
+  with exn -> A.destroy aio; Unix.close fd; Unix.unlink name; raise exn
+
+let test_mmap () =
+  require "unsafe_mmap";
+  let module M = ExtUnix.All.Mmap in
+  let name = Filename.temp_file "extunix" "mmap" in
+  let fd = Unix.openfile name [Unix.O_RDWR] 0 in
+  Unix.ftruncate fd 8192;
+  assert_equal (Unix.write_substring fd "0123456789" 0 10) 10;
+  let a = M.map ~fd ~offset:4L ~prot:[M.PROT_READ; M.PROT_WRITE] ~flags:[M.MAP_SHARED; M.MAP_POPULATE] 100 in
+  assert_equal (Bigarray.Array1.dim a) 100;
+  assert_equal (Char.chr a.{0}) '4';
+  Unix.ftruncate fd 65536;
+  let b = M.remap a 60000 in
+  assert_equal (Bigarray.Array1.dim a) 0;
+  assert_equal (Bigarray.Array1.dim b) 60000;
+  assert_equal (Char.chr b.{5}) '9';
+  b.{59999} <- Char.code 'z';
+  let _ = Bigarray.Array1.sub b 0 10 in
+  assert_raises (Invalid_argument "Mmap.remap") (fun () -> M.remap b 100);
+  let buf = Bytes.create 1 in
+  assert_equal (ExtUnix.All.pread fd 60003 buf 0 1) 1;
+  assert_equal (Bytes.get buf 0) 'z';
+  let c = M.map ~prot:[M.PROT_READ; M.PROT_WRITE] ~flags:[M.MAP_PRIVATE] 4096 in
+  c.{4095} <- 1;
+  M.unmap c;
+  assert_equal (Bigarray.Array1.dim c) 0;
+  Unix.close fd;
+  Unix.unlink name
+
+let test_msync_dirty () =
+  require "msync_ranges";
+  let module M = ExtUnix.All.Mmap in
+  let page = M.page_size () in
+  let name = Filename.temp_file "extunix" "msync" in
+  let fd = Unix.openfile name [Unix.O_RDWR] 0 in
+  let size = 3 * page + 100 in
+  Unix.ftruncate fd size;
+  let a = M.map ~fd ~prot:[M.PROT_READ; M.PROT_WRITE] ~flags:[M.MAP_SHARED] size in
+  let d = M.Dirty.create a in
+  assert_bool "clean" (not (M.Dirty.is_dirty d));
+  a.{10} <- 1;
+  M.Dirty.mark d 10 10;
+  a.{page + 1} <- 2;
+  M.Dirty.mark d (page + 1) 1;
+  a.{3 * page + 50} <- 3;
+  M.Dirty.mark d (3 * page + 50) 1;
+  assert_equal (M.Dirty.extents d) [0, 2 * page; 3 * page, 100];
+  assert_equal (M.Dirty.flush ~sync:true d) [0, 2 * page; 3 * page, 100];
+  assert_bool "flushed" (not (M.Dirty.is_dirty d));
+  assert_equal (M.Dirty.flush d) [];
+  assert_raises (Invalid_argument "ExtUnix.Mmap.Dirty.mark") (fun () -> M.Dirty.mark d (size - 1) 2);
+  M.msync a 0 size [M.MS_ASYNC];
+  let buf = Bytes.create 1 in
+  assert_equal (ExtUnix.All.pread fd (page + 1) buf 0 1) 1;
+  assert_equal (Bytes.get buf 0) '\002';
+  M.unmap a;
+  Unix.close fd;
+  Unix.unlink name
+
+let test_memfd () =
+  require "memfd_create";
+  require "sendmsg";
+  let fd = ExtUnix.All.memfd_create "extunix" [ExtUnix.All.MFD_CLOEXEC; ExtUnix.All.MFD_ALLOW_SEALING] in
+  assert_equal (Unix.write_substring fd "frame data" 0 10) 10;
+  assert_raises (Unix.Unix_error (Unix.EPERM, "memfd_map_sealed", "")) (fun () -> ExtUnix.All.memfd_map_sealed fd);
+  ExtUnix.All.(memfd_add_seals fd [F_SEAL_SHRINK; F_SEAL_GROW; F_SEAL_WRITE]);
+  assert_equal (ExtUnix.All.memfd_get_seals fd) ExtUnix.All.[F_SEAL_SHRINK; F_SEAL_GROW; F_SEAL_WRITE];
+  let (s1, s2) = Unix.socketpair Unix.PF_UNIX Unix.SOCK_STREAM 0 in
+  ExtUnix.All.sendfd ~sock:s1 ~fd;
+  let fd' = ExtUnix.All.recvfd s2 in
+  let a = ExtUnix.All.memfd_map_sealed fd' in
+  assert_equal (Bigarray.Array1.dim a) 10;
+  assert_equal (Char.chr a.{6}) 'd';
+  assert_raises (Unix.Unix_error (Unix.EPERM, "write", "")) (fun () -> Unix.write_substring fd "x" 0 1);
+  let fd2 = ExtUnix.All.memfd_create "extunix" [ExtUnix.All.MFD_CLOEXEC; ExtUnix.All.MFD_ALLOW_SEALING] in
+  assert_equal (Unix.write_substring fd2 "frame data" 0 10) 10;
+  ExtUnix.All.(memfd_add_seals fd2 [F_SEAL_SHRINK; F_SEAL_GROW; F_SEAL_FUTURE_WRITE]);
+  assert_raises (Unix.Unix_error (Unix.EPERM, "memfd_map_sealed", "")) (fun () -> ExtUnix.All.memfd_map_sealed fd2);
+  List.iter Unix.close [fd; fd'; fd2; s1; s2]
+
+let test_ring () =
+  require "ring_init";
+  let module R = ExtUnix.All.Ring in
+  let module M = ExtUnix.All.Mmap in
+  let capacity = 4096 in
+  let buf = M.map ~prot:[M.PROT_READ; M.PROT_WRITE] ~flags:[M.MAP_SHARED] (R.size capacity) in
+  let efd = ExtUnix.All.eventfd 0 in
+  let r = R.create ~mode:R.MPSC buf ~capacity efd in
+  assert_bool "empty" (not (R.wait ~timeout:0. r));
+  let payload i = Printf.sprintf "record %d %s" i (String.make (i mod 50) 'x') in
+  let received = ref 0 in
+  let check buf ofs len =
+    let s = String.init len (fun k -> Char.chr buf.{ofs + k}) in
+    assert_equal ~printer:(fun s -> s) (payload !received) s;
+    incr received
+  in
+  let sent = ref 0 in
+  while !sent < 1000 do
+    let p = Bytes.of_string (payload !sent) in
+    if R.push r p 0 (Bytes.length p) then incr sent
+    else begin
+      ignore (R.publish r);
+      assert_bool "wait" (R.wait ~timeout:1. r);
+      ignore (R.consume ~max:10 r check)
+    end
+  done;
+  let pos = R.claim r 3 in
+  assert_bool "claim" (pos >= 0);
+  ignore (R.consume r check);
+  assert_equal !received 1000;
+  buf.{pos} <- 1; buf.{pos + 1} <- 2; buf.{pos + 2} <- 3;
+  R.commit r pos 3;
+  assert_equal (R.consume r (fun buf ofs len -> assert_equal len 3; assert_equal buf.{ofs + 2} 3)) 1;
+  assert_raises (Invalid_argument "ExtUnix.Ring.claim") (fun () -> R.claim r capacity);
+  assert_raises (Invalid_argument "ExtUnix.Ring.commit") (fun () -> R.commit r (pos + 1) 3);
+  assert_raises (Invalid_argument "ExtUnix.Ring.commit") (fun () -> R.commit r 0 3);
+  assert_raises (Invalid_argument "ExtUnix.Ring.commit") (fun () -> R.commit r pos capacity);
+  Unix.close efd;
+  M.unmap buf
+
+let test_atomic () =
+  require "unsafe_load_int32";
+  let module A = ExtUnix.All.BA.Atomic in
+  let buf = ExtUnix.All.memalign 64 64 in
+  Bigarray.Array1.fill buf 0;
+  A.store_int32 buf 4 (-5);
+  assert_equal (A.load_int32 buf 4) (-5);
+  assert_equal (A.fetch_add_int32 buf 4 7) (-5);
+  assert_equal (A.load_int32 buf 4) 2;
+  assert_bool "cas" (A.compare_and_swap_int32 buf 4 2 0x7fffffff);
+  assert_bool "cas fail" (not (A.compare_and_swap_int32 buf 4 2 3));
+  assert_equal (A.fetch_add_int32 buf 4 1) 0x7fffffff;
+  assert_equal (A.load_int32 buf 4) (-0x80000000);
+  assert_equal (A.fetch_or_int64 buf 8 0x10L) 0L;
+  assert_equal (A.exchange_int64 buf 8 (Int64.shift_left 1L 40)) 0x10L;
+  assert_equal (A.load_int64 buf 8) (Int64.shift_left 1L 40);
+  assert_equal (HostEndian.get_int63 buf 8) (1 lsl 40);
+  (* all 64 bits, as written by a C peer *)
+  A.store_int64 buf 8 0x8000_0000_0000_0001L;
+  assert_bool "cas 64" (A.compare_and_swap_int64 buf 8 0x8000_0000_0000_0001L Int64.max_int);
+  assert_equal (A.fetch_add_int64 buf 8 1L) Int64.max_int;
+  assert_equal (A.load_int64 buf 8) Int64.min_int;
+  assert_raises (Invalid_argument "misaligned atomic access") (fun () -> A.load_int32 buf 2);
+  assert_raises (Invalid_argument "index out of bounds") (fun () -> A.load_int64 buf 60)
+
+let test_futex () =
+  require "unsafe_wake";
+  let module F = ExtUnix.All.Futex in
+  let module M = ExtUnix.All.Mmap in
+  let buf = M.map ~prot:[M.PROT_READ; M.PROT_WRITE] ~flags:[M.MAP_SHARED] 4096 in
+  let m = F.Mutex.at buf 0 and l = F.Latch.at buf 4 in
+  F.Mutex.init m;
+  F.Latch.init l 1;
+  HostEndian.set_int63 buf 16 0;
+  assert_bool "timeout" (not (F.wait ~timeout:0.01 buf 8 0));
+  assert_bool "value changed" (F.wait buf 8 1);
+  assert_raises (Invalid_argument "ExtUnix.Futex.Mutex.at") (fun () -> F.Mutex.at buf 2);
+  let incr () =
+    for _ = 1 to 1000 do
+      F.Mutex.lock m;
+      HostEndian.set_int63 buf 16 (HostEndian.get_int63 buf 16 + 1);
+      F.Mutex.unlock m
+    done
+  in
+  match Unix.fork () with
+  | 0 -> incr (); F.Latch.count_down l; exit 0
+  | pid ->
+    incr ();
+    assert_bool "latch" (F.Latch.await ~timeout:10. l);
+    assert_equal (HostEndian.get_int63 buf 16) 2000;
+    assert_bool "try_lock" (F.Mutex.try_lock m);
+    assert_bool "locked" (not (F.Mutex.try_lock m));
+    F.Mutex.unlock m;
+    ignore (Unix.waitpid [] pid);
+    M.unmap buf
+
+let test_madvise () =
+  require "madvise";
+  require "mincore";
+  let module M = ExtUnix.All.Mmap in
+  let page = try Int64.to_int (ExtUnix.All.sysconf ExtUnix.All.PAGESIZE) with ExtUnix.All.Not_available _ -> 4096 in
+  let a = ExtUnix.All.memalign page (4 * page) in
+  Bigarray.Array1.fill a 1;
+  let v = M.mincore a 0 (4 * page) in
+  assert_equal (Bigarray.Array1.dim v) 4;
+  assert_equal v.{1} 1;
+  assert_equal (Bigarray.Array1.dim (M.mincore a 10 page)) 2;
+  M.madvise a page (2 * page) M.MADV_WILLNEED;
+  M.madvise a 0 (4 * page) M.MADV_SEQUENTIAL;
+  assert_raises (Invalid_argument "Mmap.madvise") (fun () -> M.madvise a 1 (4 * page) M.MADV_NORMAL);
+  if ExtUnix.All.have "mlock2" = Some true then begin
+    try
+      M.mlock2 a 0 page [M.MLOCK_ONFAULT];
+      M.munlock a 0 page
+    with Unix.Unix_error ((Unix.EPERM | Unix.ENOMEM | Unix.ENOSYS), _, _) -> ()
+  end
+
 let () =
   let wrap test =
     with_unix_error (fun () -> test (); Gc.compact ())
   in
   let tests = ("tests" >::: [
     "endian_bigrray" >:: test_endian_bigarray;
+    "endian_array" >:: test_endian_array;
+    "endian_float" >:: test_endian_float;
+    "endian_unboxed" >:: test_endian_unboxed;
     "pread_bigarray" >:: test_pread_bigarray;
     "pwrite_bigarray" >:: test_pwrite_bigarray;
     "substr" >:: test_substr;
     "read_bigarray" >:: test_read_bigarray;
     "write_bigarray" >:: test_write_bigarray;
+    "preadv_pwritev_bigarray" >:: test_preadv_pwritev_bigarray;
+    "preadv2_pwritev2_bigarray" >:: test_preadv2_pwritev2_bigarray;
+    "uring" >:: test_uring;
+    "uring_net" >:: test_uring_net;
+    "aio" >:: test_aio;
+    "mmap" >:: test_mmap;
+    "memfd" >:: test_memfd;
+    "madvise" >:: test_madvise;
+    "futex" >:: test_futex;
+    "atomic" >:: test_atomic;
+    "ring" >:: test_ring;
+    "msync_dirty" >:: test_msync_dirty;
+    "cursor" >:: test_cursor;
+    "search" >:: test_search;
+    "sendmsg_bigarray" >:: test_sendmsg_bigarray;
+    "mmsg" >:: test_mmsg;
+    "udp_gso" >:: test_udp_gso;
+    "zerocopy" >:: test_zerocopy;
   ]) in
   ignore (run_test_tt_main (test_decorate wrap tests))